@@ -0,0 +1,697 @@
+/**
+ * @file bench.cpp
+ *
+ * Common benchmark for all ringbuffer implementations.
+ *
+ * The same source is compiled once per implementation
+ * (see BENCH_RINGBUFFER_* in Makefile), as all generations
+ * define lts::ringbuffer and cannot share a translation unit.
+ * Every binary accepts the same parameters and reports
+ * throughput, per-element latency percentiles and dropped elements
+ * as a text, csv or json record.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+extern "C" {
+    #include <unistd.h>
+    #include <getopt.h>
+    #include <pthread.h>
+    #include <sched.h>
+}
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../../utils/strtointeger.hpp"
+
+#if defined(BENCH_RINGBUFFER_V1)
+#include "../v1/ringbuffer.hpp"
+#define BENCH_NAME "v1"
+#elif defined(BENCH_RINGBUFFER_V2)
+#include "../v2/ringbuffer.hpp"
+#define BENCH_NAME "v2"
+#elif defined(BENCH_RINGBUFFER_V3)
+#include "../v3/ringbuffer.hpp"
+#define BENCH_NAME "v3"
+#elif defined(BENCH_RINGBUFFER_V4)
+#include "../v4/ringbuffer.hpp"
+#define BENCH_NAME "v4"
+#elif defined(BENCH_RINGBUFFER_V5)
+#include "../v5/ringbuffer.hpp"
+#define BENCH_NAME "v5"
+#elif defined(BENCH_RINGBUFFER_V5_MPMC)
+#include "../v5/mpmc_ringbuffer.hpp"
+#define BENCH_NAME "v5_mpmc"
+#elif defined(BENCH_RINGBUFFER_V5_SHM)
+#include "../v5/shm_ringbuffer.hpp"
+#define BENCH_NAME "v5_shm"
+#elif defined(BENCH_RINGBUFFER_V5_MAGIC)
+#include "../v5/magic_ringbuffer.hpp"
+#define BENCH_NAME "v5_magic"
+#else
+#error "one of BENCH_RINGBUFFER_* has to be defined"
+#endif
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 10000000
+#define LATENCY_SAMPLES_MAX (1U << 20)
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+enum class bench_format
+{
+    TEXT,
+    CSV,
+    JSON,
+};
+
+struct bench_params
+{
+    std::size_t m_element_size = 16;
+    std::size_t m_capacity = 1024;
+    std::size_t m_batch = 1;
+    bool m_read_non_blocking = false;
+    bool m_write_non_blocking = false;
+    int m_producer_cpu = -1;
+    int m_consumer_cpu = -1;
+    std::size_t m_iterations = ITERATIONS;
+};
+
+struct bench_result
+{
+    std::uint64_t m_duration_ns = 0;
+    std::size_t m_consumed = 0;
+    std::size_t m_dropped = 0;
+    std::size_t m_errors = 0;
+    std::vector<std::uint64_t> m_latencies;
+};
+
+/* Each element carries the time it was handed over to the ringbuffer. */
+template<std::size_t SIZE>
+struct bench_element
+{
+    std::uint64_t m_timestamp;
+    std::uint64_t m_sequence;
+    std::uint8_t m_payload[SIZE - 16];
+};
+
+template<>
+struct bench_element<16>
+{
+    std::uint64_t m_timestamp;
+    std::uint64_t m_sequence;
+};
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+template<typename T> static bool run_ringbuffer(const bench_params& params, bench_result* result);
+template<typename T, typename RB> static void run_bench(RB& rb, const bench_params& params, bench_result* result);
+static void print_result(const bench_params& params, const bench_result& result, bench_format format);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+static inline void bench_usage(const char* progname)
+{
+    std::cerr << "usage: " << progname << " [-e size] [-c capacity] [-b batch] [-R] [-W] [-P cpu] [-C cpu] [-i iterations] [-o format] [-H]" << std::endl;
+    std::cerr << " options: " << std::endl;
+    std::cerr << "  -e size --element-size=size     : size of a single element in bytes" << std::endl;
+    std::cerr << "                                  : (one of 16, 64, 256, 1024; default: 16)" << std::endl;
+    std::cerr << "  -c capacity --capacity=capacity : max number of elements in a ringbuffer (default: 1024)" << std::endl;
+    std::cerr << "  -b batch --batch=batch          : max number of elements transferred by each read/write (default: 1)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -R --read-non-blocking          : switches consumer side to non-blocking semantics" << std::endl;
+    std::cerr << "  -W --write-non-blocking         : switches producer side to non-blocking semantics" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -P cpu --producer-cpu=cpu       : pins producer thread to the given cpu" << std::endl;
+    std::cerr << "  -C cpu --consumer-cpu=cpu       : pins consumer thread to the given cpu" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -i --iterations                 : number of transferred elements (default: " << ITERATIONS << ")" << std::endl;
+    std::cerr << "  -o format --output=format       : text, csv or json (default: text)" << std::endl;
+    std::cerr << "  -H --header                     : prints csv header and exits" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << " exit status is 2 if the implementation does not support given parameters" << std::endl;
+}
+
+static inline std::uint64_t now_ns()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static inline void pin_thread(std::thread& thread, int cpu)
+{
+    cpu_set_t cpuset;
+
+    if (cpu < 0)
+        return;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpuset), &cpuset) != 0)
+        std::cerr << "warning: cannot pin thread to cpu " << cpu << std::endl;
+}
+
+/*===========================================================================*\
+ * adaptation of each implementation to the common write/read/dropped calls
+\*===========================================================================*/
+#if defined(BENCH_RINGBUFFER_V1)
+
+/* v1 takes capacity and blocking semantics as template parameters,
+thus only a fixed set of capacities is supported. */
+template<typename T, std::size_t CAPACITY>
+static bool run_ringbuffer_v1(const bench_params& params, bench_result* result)
+{
+    if (params.m_read_non_blocking) {
+        lts::ringbuffer<T, CAPACITY, true> rb;
+        run_bench<T>(rb, params, result);
+    } else {
+        lts::ringbuffer<T, CAPACITY, false> rb;
+        run_bench<T>(rb, params, result);
+    }
+
+    return true;
+}
+
+template<typename T>
+static bool run_ringbuffer(const bench_params& params, bench_result* result)
+{
+    if (params.m_read_non_blocking != params.m_write_non_blocking)
+        return false;
+
+    switch (params.m_capacity) {
+        case 16:      return run_ringbuffer_v1<T, 16>(params, result);
+        case 64:      return run_ringbuffer_v1<T, 64>(params, result);
+        case 256:     return run_ringbuffer_v1<T, 256>(params, result);
+        case 1024:    return run_ringbuffer_v1<T, 1024>(params, result);
+        case 4096:    return run_ringbuffer_v1<T, 4096>(params, result);
+        case 65536:   return run_ringbuffer_v1<T, 65536>(params, result);
+        case 1048576: return run_ringbuffer_v1<T, 1048576>(params, result);
+        default:      return false;
+    }
+}
+
+#elif defined(BENCH_RINGBUFFER_V2) || defined(BENCH_RINGBUFFER_V3) || defined(BENCH_RINGBUFFER_V4)
+
+/* v2, v3 and v4 share a single blocking flag for both sides. */
+template<typename T>
+static bool run_ringbuffer(const bench_params& params, bench_result* result)
+{
+    if (params.m_read_non_blocking != params.m_write_non_blocking)
+        return false;
+
+    lts::ringbuffer<T> rb(params.m_capacity, params.m_read_non_blocking);
+    run_bench<T>(rb, params, result);
+
+    return true;
+}
+
+#else
+
+static inline std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> bench_flags(const bench_params& params)
+{
+    return std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX>{
+        (params.m_read_non_blocking ? 1U : 0U) << RINGBUFFER_NONBLOCKING_READ_SHIFT |
+        (params.m_write_non_blocking ? 1U : 0U) << RINGBUFFER_NONBLOCKING_WRITE_SHIFT};
+}
+
+#if defined(BENCH_RINGBUFFER_V5)
+
+/* v5 has no pointer/count transfers, the span ones are used instead,
+so a batch is moved with (at most two) memcpy() calls. */
+template<typename T>
+struct bench_v5 : public lts::ringbuffer<T>
+{
+    /* ringbuffer_base is a virtual base, thus it has to be constructed here as well */
+    bench_v5(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags) :
+        lts::ringbuffer_base<T>::ringbuffer_base{capacity, flags},
+        lts::ringbuffer<T>::ringbuffer{capacity, flags}
+    {
+    }
+
+    long write(const T* data, std::size_t count)
+    {
+        return lts::oringbuffer<T>::write_span([data](T* first, std::size_t n1, T* second, std::size_t n2) {
+            std::memcpy(first, data, n1 * sizeof(T));
+            std::memcpy(second, data + n1, n2 * sizeof(T));
+            return n1 + n2;
+        }, count);
+    }
+
+    long read(T* data, std::size_t count)
+    {
+        return lts::iringbuffer<T>::read_span([data](T* first, std::size_t n1, T* second, std::size_t n2) {
+            std::memcpy(data, first, n1 * sizeof(T));
+            std::memcpy(data + n1, second, n2 * sizeof(T));
+            return n1 + n2;
+        }, count);
+    }
+};
+
+template<typename T>
+static bool run_ringbuffer(const bench_params& params, bench_result* result)
+{
+    bench_v5<T> rb(params.m_capacity, bench_flags(params));
+    run_bench<T>(rb, params, result);
+
+    return true;
+}
+
+#elif defined(BENCH_RINGBUFFER_V5_MPMC)
+
+/* Elements are claimed one by one anyway, so the batch is a simple loop
+(a blocking consumer is never asked for more elements than are still to come). */
+template<typename T>
+struct bench_v5_mpmc : public lts::mpmc_ringbuffer<T>
+{
+    using lts::mpmc_ringbuffer<T>::mpmc_ringbuffer;
+
+    long write(const T* data, std::size_t count)
+    {
+        std::size_t i;
+
+        for (i = 0; i < count; ++i) {
+            long status = lts::mpmc_ringbuffer<T>::write(data[i]);
+            if (status < 0)
+                return (0 == i) ? status : static_cast<long>(i);
+        }
+
+        return static_cast<long>(i);
+    }
+
+    long read(T* data, std::size_t count)
+    {
+        std::size_t i;
+
+        for (i = 0; i < count; ++i) {
+            long status = lts::mpmc_ringbuffer<T>::read(data[i]);
+            if (status < 0)
+                return (0 == i) ? status : static_cast<long>(i);
+        }
+
+        return static_cast<long>(i);
+    }
+};
+
+template<typename T>
+static bool run_ringbuffer(const bench_params& params, bench_result* result)
+{
+    bench_v5_mpmc<T> rb(params.m_capacity, bench_flags(params));
+    run_bench<T>(rb, params, result);
+
+    return true;
+}
+
+#elif defined(BENCH_RINGBUFFER_V5_SHM)
+
+template<typename T>
+static bool run_ringbuffer(const bench_params& params, bench_result* result)
+{
+    lts::shm_ringbuffer<T> rb(params.m_capacity, bench_flags(params));
+    if (!rb.is_valid())
+        return false;
+
+    run_bench<T>(rb, params, result);
+
+    return true;
+}
+
+#elif defined(BENCH_RINGBUFFER_V5_MAGIC)
+
+/* Byte ringbuffer, only whole elements are transferred
+(capacity is rounded up to a power of two number of pages). */
+template<typename T>
+struct bench_v5_magic : public lts::magic_ringbuffer
+{
+    using lts::magic_ringbuffer::magic_ringbuffer;
+
+    long write(const T* data, std::size_t count)
+    {
+        std::uint8_t* dst = nullptr;
+        long status = reserve(count * sizeof(T), &dst);
+
+        if (status < 0)
+            return status;
+
+        count = static_cast<std::size_t>(status) / sizeof(T);
+        std::memcpy(dst, data, count * sizeof(T));
+        commit(count * sizeof(T));
+
+        return (count > 0) ? static_cast<long>(count) : static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK);
+    }
+
+    long read(T* data, std::size_t count)
+    {
+        const std::uint8_t* src = nullptr;
+        long status = peek(count * sizeof(T), &src);
+
+        if (status < 0)
+            return status;
+
+        count = static_cast<std::size_t>(status) / sizeof(T);
+        std::memcpy(data, src, count * sizeof(T));
+        release(count * sizeof(T));
+
+        return static_cast<long>(count);
+    }
+
+    lts::ringbuffer_status get_counters(std::size_t* produced, std::size_t* consumed, std::size_t* dropped) const
+    {
+        lts::ringbuffer_status rbs = lts::magic_ringbuffer::get_counters(produced, consumed, dropped);
+
+        if (produced) *produced /= sizeof(T);
+        if (consumed) *consumed /= sizeof(T);
+
+        return rbs;
+    }
+};
+
+template<typename T>
+static bool run_ringbuffer(const bench_params& params, bench_result* result)
+{
+    bench_v5_magic<T> rb(params.m_capacity * sizeof(T), bench_flags(params));
+    if (!rb.is_valid())
+        return false;
+
+    run_bench<T>(rb, params, result);
+
+    return true;
+}
+
+#endif
+
+#endif
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+int main(int argc, char *argv[])
+{
+    bool status;
+    bench_params params;
+    bench_result result;
+    bench_format format = bench_format::TEXT;
+
+    static struct option long_options[] = {
+        {"element-size",       required_argument, 0, 'e'},
+        {"capacity",           required_argument, 0, 'c'},
+        {"batch",              required_argument, 0, 'b'},
+        {"read-non-blocking",  no_argument,       0, 'R'},
+        {"write-non-blocking", no_argument,       0, 'W'},
+        {"producer-cpu",       required_argument, 0, 'P'},
+        {"consumer-cpu",       required_argument, 0, 'C'},
+        {"iterations",         required_argument, 0, 'i'},
+        {"output",             required_argument, 0, 'o'},
+        {"header",             no_argument,       0, 'H'},
+        {0,                    0,                 0,  0 }
+    };
+
+    for (;;) {
+        int c = getopt_long(argc, argv, "e:c:b:RWP:C:i:o:H", long_options, 0);
+        if (-1 == c)
+            break;
+
+        status = true;
+
+        switch(c) {
+            case 'e':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, params.m_element_size));
+                break;
+
+            case 'c':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, params.m_capacity));
+                status = status && (params.m_capacity > 0);
+                break;
+
+            case 'b':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, params.m_batch));
+                status = status && (params.m_batch > 0);
+                break;
+
+            case 'R':
+                params.m_read_non_blocking = true;
+                break;
+
+            case 'W':
+                params.m_write_non_blocking = true;
+                break;
+
+            case 'P':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, params.m_producer_cpu));
+                break;
+
+            case 'C':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, params.m_consumer_cpu));
+                break;
+
+            case 'i':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, params.m_iterations));
+                break;
+
+            case 'o':
+                if (0 == strcmp(optarg, "text"))
+                    format = bench_format::TEXT;
+                else
+                if (0 == strcmp(optarg, "csv"))
+                    format = bench_format::CSV;
+                else
+                if (0 == strcmp(optarg, "json"))
+                    format = bench_format::JSON;
+                else
+                    status = false;
+                break;
+
+            case 'H':
+                std::cout << "implementation,element_size,capacity,batch,read_non_blocking,write_non_blocking,";
+                std::cout << "producer_cpu,consumer_cpu,iterations,duration_ns,elements_per_s,mb_per_s,";
+                std::cout << "latency_p50_ns,latency_p99_ns,latency_p999_ns,latency_max_ns,dropped,errors" << std::endl;
+                return 0;
+
+            default:
+                status = false;
+                break;
+        }
+
+        if (!status) {
+            std::cerr << "error: invalid value '" << (optarg ? optarg : "") << "'" << std::endl;
+            bench_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    switch (params.m_element_size) {
+        case 16:   status = run_ringbuffer<bench_element<16>>(params, &result);   break;
+        case 64:   status = run_ringbuffer<bench_element<64>>(params, &result);   break;
+        case 256:  status = run_ringbuffer<bench_element<256>>(params, &result);  break;
+        case 1024: status = run_ringbuffer<bench_element<1024>>(params, &result); break;
+        default:   status = false; break;
+    }
+
+    if (!status) {
+        std::cerr << BENCH_NAME << ": unsupported parameters" << std::endl;
+        exit(2);
+    }
+
+    print_result(params, result, format);
+
+    return (0 == result.m_errors) ? 0 : EXIT_FAILURE;
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+template<typename T, typename RB>
+static void run_bench(RB& rb, const bench_params& params, bench_result* result)
+{
+    const std::size_t iterations = params.m_iterations;
+    const std::size_t batch = params.m_batch;
+    const std::size_t stride = std::max<std::size_t>(1, iterations / LATENCY_SAMPLES_MAX);
+    std::atomic<bool> start{false};
+    std::uint64_t t1, t2;
+
+    result->m_latencies.reserve(iterations / stride + 1);
+
+    std::thread producer {[&rb, &start, iterations, batch]() {
+        std::vector<T> array(batch);
+        std::size_t produced = 0;
+
+        while (!start.load(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        while (produced < iterations) {
+            std::size_t count = std::min(batch, iterations - produced);
+            std::uint64_t timestamp = now_ns();
+            for (std::size_t i = 0; i < count; ++i) {
+                array[i].m_timestamp = timestamp;
+                array[i].m_sequence = produced + i;
+            }
+            long status = rb.write(array.data(), count);
+            if (status < 0) {
+                if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::cerr << "rb.write() failed with code " << status << std::endl;
+                break;
+            }
+            produced += status;
+        }
+    }};
+
+    std::thread consumer {[&rb, &start, result, iterations, batch, stride]() {
+        std::vector<T> array(batch);
+        std::size_t consumed = 0;
+
+        while (!start.load(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        while (consumed < iterations) {
+            long status = rb.read(array.data(), std::min(batch, iterations - consumed));
+            if (status < 0) {
+                if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::cerr << "rb.read() failed with code " << status << std::endl;
+                break;
+            }
+            std::uint64_t timestamp = now_ns();
+            for (long i = 0; i < status; ++i) {
+                if (array[i].m_sequence != consumed)
+                    result->m_errors++;
+                if (0 == (consumed % stride))
+                    result->m_latencies.push_back(timestamp - array[i].m_timestamp);
+                consumed++;
+            }
+        }
+
+        result->m_consumed = consumed;
+    }};
+
+    pin_thread(producer, params.m_producer_cpu);
+    pin_thread(consumer, params.m_consumer_cpu);
+
+    t1 = now_ns();
+    start.store(true, std::memory_order_release);
+
+    producer.join();
+    consumer.join();
+
+    t2 = now_ns();
+
+    result->m_duration_ns = t2 - t1;
+    rb.get_counters(nullptr, nullptr, &result->m_dropped);
+}
+
+static void print_result(const bench_params& params, const bench_result& result, bench_format format)
+{
+    std::vector<std::uint64_t> latencies = result.m_latencies;
+    std::uint64_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+    double seconds = static_cast<double>(result.m_duration_ns) / 1e9;
+    double elements_per_s = (seconds > 0) ? result.m_consumed / seconds : 0;
+    double mb_per_s = elements_per_s * params.m_element_size / 1e6;
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        p50 = latencies[latencies.size() * 500 / 1000];
+        p99 = latencies[latencies.size() * 990 / 1000];
+        p999 = latencies[latencies.size() * 999 / 1000];
+        max = latencies.back();
+    }
+
+    switch (format) {
+        case bench_format::CSV:
+            std::cout << BENCH_NAME << "," << params.m_element_size << "," << params.m_capacity << ",";
+            std::cout << params.m_batch << "," << params.m_read_non_blocking << "," << params.m_write_non_blocking << ",";
+            std::cout << params.m_producer_cpu << "," << params.m_consumer_cpu << "," << params.m_iterations << ",";
+            std::cout << result.m_duration_ns << "," << static_cast<std::uint64_t>(elements_per_s) << ",";
+            std::cout << static_cast<std::uint64_t>(mb_per_s) << ",";
+            std::cout << p50 << "," << p99 << "," << p999 << "," << max << ",";
+            std::cout << result.m_dropped << "," << result.m_errors << std::endl;
+            break;
+
+        case bench_format::JSON:
+            std::cout << "{\"implementation\": \"" << BENCH_NAME << "\", ";
+            std::cout << "\"element_size\": " << params.m_element_size << ", ";
+            std::cout << "\"capacity\": " << params.m_capacity << ", ";
+            std::cout << "\"batch\": " << params.m_batch << ", ";
+            std::cout << "\"read_non_blocking\": " << (params.m_read_non_blocking ? "true" : "false") << ", ";
+            std::cout << "\"write_non_blocking\": " << (params.m_write_non_blocking ? "true" : "false") << ", ";
+            std::cout << "\"producer_cpu\": " << params.m_producer_cpu << ", ";
+            std::cout << "\"consumer_cpu\": " << params.m_consumer_cpu << ", ";
+            std::cout << "\"iterations\": " << params.m_iterations << ", ";
+            std::cout << "\"duration_ns\": " << result.m_duration_ns << ", ";
+            std::cout << "\"elements_per_s\": " << static_cast<std::uint64_t>(elements_per_s) << ", ";
+            std::cout << "\"mb_per_s\": " << static_cast<std::uint64_t>(mb_per_s) << ", ";
+            std::cout << "\"latency_ns\": {\"p50\": " << p50 << ", \"p99\": " << p99;
+            std::cout << ", \"p999\": " << p999 << ", \"max\": " << max << "}, ";
+            std::cout << "\"dropped\": " << result.m_dropped << ", ";
+            std::cout << "\"errors\": " << result.m_errors << "}" << std::endl;
+            break;
+
+        default:
+            std::cout << BENCH_NAME << " (element size: " << params.m_element_size;
+            std::cout << ", capacity: " << params.m_capacity << ", batch: " << params.m_batch;
+            std::cout << ", read: " << (params.m_read_non_blocking ? "non_blocking" : "blocking");
+            std::cout << ", write: " << (params.m_write_non_blocking ? "non_blocking" : "blocking") << ")" << std::endl;
+            std::cout << "  throughput: " << static_cast<std::uint64_t>(elements_per_s) << " elements/s";
+            std::cout << " (" << static_cast<std::uint64_t>(mb_per_s) << " MB/s)" << std::endl;
+            std::cout << "  latency: p50 " << p50 << "ns, p99 " << p99 << "ns, p999 " << p999 << "ns, max " << max << "ns" << std::endl;
+            std::cout << "  dropped: " << result.m_dropped << ", errors: " << result.m_errors << std::endl;
+            break;
+    }
+}
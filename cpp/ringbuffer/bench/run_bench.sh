@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# Runs every ringbuffer implementation against the same set of parameters
+# and collects the results into a single csv (default) or json file.
+#
+# usage: run_bench.sh [csv|json] [iterations] [producer_cpu] [consumer_cpu]
+
+set -e
+
+format=${1:-csv}
+iterations=${2:-10000000}
+producer_cpu=${3:-0}
+consumer_cpu=${4:-1}
+
+make all > /dev/null
+
+if [ "${format}" == "csv" ]; then
+    ./bench_v1 -H
+fi
+
+for bench in bench_v1 bench_v2 bench_v3 bench_v4 bench_v5 bench_v5_mpmc bench_v5_shm bench_v5_magic
+do
+    for element_size in 16 64 256 1024
+    do
+        for capacity in 64 1024 65536
+        do
+            for batch in 1 16 256
+            do
+                for nonblocking in "" "-R -W"
+                do
+                    # unsupported combinations exit with status 2 and are skipped
+                    ./${bench} -e ${element_size} -c ${capacity} -b ${batch} ${nonblocking} \
+                        -P ${producer_cpu} -C ${consumer_cpu} -i ${iterations} -o ${format} || [ $? -eq 2 ]
+                done
+            done
+        done
+    done
+done
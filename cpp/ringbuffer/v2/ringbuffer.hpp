@@ -235,9 +235,9 @@ public:
     long read(T* data, std::size_t count, ringbuffer_xfer_semantic semantic = ringbuffer_xfer_semantic::COPY)
     {
         if (semantic == ringbuffer_xfer_semantic::COPY)
-            return read(data, 1, copy<T>);
+            return read(data, count, copy<T>);
         else
-            return read(data, 1, move<T>);
+            return read(data, count, move<T>);
     }
 
     long read(T& data, ringbuffer_xfer_semantic semantic = ringbuffer_xfer_semantic::COPY)
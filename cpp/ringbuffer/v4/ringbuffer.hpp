@@ -51,6 +51,10 @@
 /*===========================================================================*\
  * preprocessor #define constants and macros
 \*===========================================================================*/
+/* upper bound of iterations a blocked reader/writer spins (adaptively) before it is parked */
+#if !defined(RINGBUFFER_SPIN_COUNT)
+#define RINGBUFFER_SPIN_COUNT 256
+#endif
 
 /*===========================================================================*\
  * global type definitions
@@ -89,8 +93,8 @@ public:
         m_non_blocking{non_blocking},
         m_counters{},
         m_buffer{nullptr},
-        m_writing_semaphore{true},
-        m_reading_semaphore{false}
+        m_writing_semaphore{true, RINGBUFFER_SPIN_COUNT, true},
+        m_reading_semaphore{false, RINGBUFFER_SPIN_COUNT, true}
     {
         assert(capacity > 0);
         assert(capacity < LONG_MAX);
@@ -236,9 +240,9 @@ public:
     long read(T* data, std::size_t count, ringbuffer_xfer_semantic semantic = ringbuffer_xfer_semantic::COPY)
     {
         if (semantic == ringbuffer_xfer_semantic::COPY)
-            return read(data, 1, copy<T>);
+            return read(data, count, copy<T>);
         else
-            return read(data, 1, move<T>);
+            return read(data, count, move<T>);
     }
 
     long read(T& data, ringbuffer_xfer_semantic semantic = ringbuffer_xfer_semantic::COPY)
@@ -0,0 +1,248 @@
+/**
+ * @file emplace_ringbuffer.hpp
+ *
+ * Definition of single-producer/single-consumer ringbuffer
+ * built on uninitialized storage. Elements are constructed in place
+ * by the producer and destroyed in place by the consumer,
+ * so no slot keeps an object alive once it has been consumed.
+ * Its non-blocking path is completely lockless.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _EMPLACE_RINGBUFFER_HPP_
+#define _EMPLACE_RINGBUFFER_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <bitset>
+#include <new>
+#include <optional>
+#include <utility>
+#include <type_traits>
+
+#if defined(DEBUG_RINGBUFFER)
+#include <iostream>
+#endif
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "ringbuffer_base.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Ringbuffer which does not require T to be default constructible
+ * nor assignable (move constructible is enough).
+ *
+ * emplace() constructs an element directly in its slot,
+ * pop() move constructs it out and destroys it right away
+ * (only pop(T&) needs T to be move assignable). Elements which
+ * are still there when the ringbuffer is destroyed are destroyed as well.
+ */
+template<typename T>
+class emplace_ringbuffer : public ringbuffer_base<T>
+{
+    static_assert(std::is_move_constructible_v<T>, "emplace_ringbuffer requires move constructible elements");
+
+public:
+    typedef T value_type;
+
+    explicit emplace_ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags,
+                                ringbuffer_capacity_policy policy = ringbuffer_capacity_policy::EXACT) :
+        ringbuffer_base<T>::ringbuffer_base{capacity, flags, policy, ringbuffer_storage<T>{allocate, deallocate}}
+    {
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+        std::cout << ringbuffer_base<T>::to_string() << std::endl;
+#endif
+    }
+
+    ~emplace_ringbuffer() override
+    {
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+#endif
+
+        destroy_all();
+    }
+
+    /**
+     * Constructs a new element in place from 'args'.
+     *
+     * @return 1 or negative ringbuffer_status on error.
+     */
+    template<typename... Args>
+    long emplace(Args&&... args)
+    {
+        std::size_t produced;
+        std::size_t free_elements;
+        ringbuffer_status rbs;
+
+        rbs = ringbuffer_base<T>::acquire_free_elements(1, &produced, &free_elements, true);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        ::new (static_cast<void*>(ringbuffer_base<T>::m_buffer + ringbuffer_base<T>::index(produced))) T(std::forward<Args>(args)...);
+
+        ringbuffer_base<T>::publish(produced, 1);
+
+        return 1;
+    }
+
+    long push(const T& data)
+    {
+        return emplace(data);
+    }
+
+    long push(T&& data)
+    {
+        return emplace(std::move(data));
+    }
+
+    /**
+     * Move constructs the oldest element into the returned optional
+     * and destroys it in place.
+     *
+     * @return the element or std::nullopt if there is none (or the wait
+     *         has been cancelled), pop(consumer, 1) tells those apart.
+     */
+    std::optional<T> pop()
+    {
+        std::optional<T> data;
+
+        pop([&data](T&& element) { data.emplace(std::move(element)); }, 1);
+
+        return data;
+    }
+
+    /**
+     * Move assigns the oldest element to 'data' and destroys it in place.
+     * Available only if T is move assignable.
+     *
+     * @return 1 or negative ringbuffer_status on error.
+     */
+    template<typename U = T, typename = std::enable_if_t<std::is_move_assignable_v<U>>>
+    long pop(T& data)
+    {
+        return pop([&data](T&& element) { data = std::move(element); }, 1);
+    }
+
+    /**
+     * Hands up to 'count' of the oldest elements over to 'consumer',
+     * invocable as void(T&&), which may move construct them wherever it wants.
+     * Each element is destroyed in place right after the call.
+     * All of them are released at once.
+     *
+     * @return number of popped elements or negative ringbuffer_status on error.
+     */
+    template<typename F, typename = std::enable_if_t<std::is_invocable_v<F&, T&&>>>
+    long pop(F&& consumer, std::size_t count)
+    {
+        std::size_t consumed;
+        std::size_t available;
+        ringbuffer_status rbs;
+
+        if (0 == count)
+            return 0;
+
+        rbs = ringbuffer_base<T>::acquire_available_elements(count, &consumed, &available);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > available)
+            count = available;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            T* e = element(consumed + i);
+            consumer(std::move(*e));
+            e->~T();
+        }
+
+        ringbuffer_base<T>::retire(consumed, count);
+
+        return count;
+    }
+
+    /* Same as ringbuffer_base::reset(), elements skipped by it are destroyed. */
+    void reset(ringbuffer_role role) override
+    {
+        destroy_all();
+        ringbuffer_base<T>::reset(role);
+    }
+
+private:
+    /* Only slots between consumed and produced hold live objects. */
+    T* element(std::size_t counter) const
+    {
+        return std::launder(ringbuffer_base<T>::m_buffer + ringbuffer_base<T>::index(counter));
+    }
+
+    void destroy_all()
+    {
+        std::size_t produced = ringbuffer_base<T>::m_counters.m_producer.m_produced.load(std::memory_order_acquire);
+        std::size_t consumed = ringbuffer_base<T>::m_counters.m_consumer.m_consumed.load(std::memory_order_acquire);
+
+        for (; consumed != produced; ++consumed)
+            element(consumed)->~T();
+    }
+
+    /* Raw storage, no element is constructed here. */
+    static T* allocate(std::size_t capacity)
+    {
+        return static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t{alignof(T)}));
+    }
+
+    static void deallocate(T* buffer, std::size_t capacity)
+    {
+        UNUSED(capacity);
+        ::operator delete(buffer, std::align_val_t{alignof(T)});
+    }
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _EMPLACE_RINGBUFFER_HPP_ */
@@ -0,0 +1,288 @@
+/**
+ * @file emplace_ringbuffer_test.cpp
+ *
+ * Test procedures for 'emplace_ringbuffer' implementation.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <memory>
+#include <optional>
+#include <string>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "emplace_ringbuffer.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 100000
+
+#define TEST_UNIQUE_PTR(CAPACITY, N, FLAGS, NAME)                                            \
+TEST(emplace_ringbuffer, unique_ptr_capacity_##CAPACITY##_batch_##N##_##NAME)                \
+{                                                                                            \
+    lts::emplace_ringbuffer<std::unique_ptr<std::size_t>> rb(CAPACITY, FLAGS);               \
+                                                                                             \
+    std::thread producer {unique_ptr_producer, std::ref(rb)};                                \
+    std::thread consumer {unique_ptr_consumer<N>, std::ref(rb)};                             \
+                                                                                             \
+    producer.join();                                                                         \
+    consumer.join();                                                                         \
+                                                                                             \
+    std::cout << static_cast<std::string>(rb) << std::endl;                                  \
+}
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+/* Neither default constructible nor assignable, counts its live instances. */
+struct tracked
+{
+    tracked(int value, const std::string& name) :
+        m_value{value},
+        m_name{name}
+    {
+        s_alive++;
+    }
+
+    tracked(tracked&& other) :
+        m_value{other.m_value},
+        m_name{std::move(other.m_name)}
+    {
+        s_alive++;
+    }
+
+    ~tracked()
+    {
+        s_alive--;
+    }
+
+    tracked(const tracked&) = delete;
+    tracked& operator = (const tracked&) = delete;
+    tracked& operator = (tracked&&) = delete;
+
+    int m_value;
+    std::string m_name;
+
+    static int s_alive;
+};
+
+int tracked::s_alive = 0;
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+static void unique_ptr_producer(lts::emplace_ringbuffer<std::unique_ptr<std::size_t>>& rb);
+template<std::size_t N> static void unique_ptr_consumer(lts::emplace_ringbuffer<std::unique_ptr<std::size_t>>& rb);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(emplace_ringbuffer, create)
+{
+    lts::emplace_ringbuffer<tracked> rb1(5, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+    EXPECT_EQ(5U, rb1.capacity());
+    EXPECT_EQ(RINGBUFFER_RD_BLOCKING_WR_BLOCKING, rb1.flags());
+    std::cout << static_cast<std::string>(rb1) << std::endl;
+
+    lts::emplace_ringbuffer<tracked> rb2(5, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING,
+        lts::ringbuffer_capacity_policy::POWER_OF_TWO);
+    EXPECT_EQ(8U, rb2.capacity());
+    std::cout << static_cast<std::string>(rb2) << std::endl;
+
+    /* no slot is constructed up front */
+    EXPECT_EQ(0, tracked::s_alive);
+}
+
+TEST(emplace_ringbuffer, construct_and_destroy_in_place)
+{
+    size_t produced, consumed, dropped;
+
+    {
+        lts::emplace_ringbuffer<tracked> rb(3, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK),
+            rb.pop([](tracked&&) {}, 1));
+
+        EXPECT_EQ(1, rb.emplace(1, "one"));
+        EXPECT_EQ(1, rb.emplace(2, "two"));
+        EXPECT_EQ(1, rb.push(tracked{3, "three"}));
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.emplace(4, "four"));
+        EXPECT_EQ(3, tracked::s_alive);
+
+        /* popped elements are destroyed right away */
+        EXPECT_EQ(2, rb.pop([](tracked&& t) {
+            tracked moved{std::move(t)};
+            EXPECT_EQ(moved.m_name, (moved.m_value == 1) ? "one" : "two");
+        }, 2));
+        EXPECT_EQ(1, tracked::s_alive);
+
+        /* wrap around */
+        EXPECT_EQ(1, rb.emplace(5, "five"));
+        EXPECT_EQ(1, rb.emplace(6, "six"));
+        EXPECT_EQ(3, tracked::s_alive);
+
+        EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+        EXPECT_EQ(5U, produced);
+        EXPECT_EQ(2U, consumed);
+        EXPECT_EQ(1U, dropped);
+
+        /* elements skipped by reset() are destroyed as well */
+        rb.reset(lts::ringbuffer_role::CONSUMER);
+        EXPECT_EQ(0, tracked::s_alive);
+        EXPECT_EQ(1, rb.emplace(7, "seven"));
+        EXPECT_EQ(1, tracked::s_alive);
+
+        /* even when reset through the base */
+        lts::ringbuffer_base<tracked>& base = rb;
+        base.reset(lts::ringbuffer_role::NONE);
+        EXPECT_EQ(0, tracked::s_alive);
+        EXPECT_EQ(1, rb.emplace(8, "eight"));
+        EXPECT_EQ(1, tracked::s_alive);
+    }
+
+    /* elements left in the ringbuffer are destroyed together with it */
+    EXPECT_EQ(0, tracked::s_alive);
+}
+
+TEST(emplace_ringbuffer, pop_into_existing_object)
+{
+    lts::emplace_ringbuffer<std::string> rb(2, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    std::string value;
+
+    EXPECT_EQ(1, rb.emplace(std::size_t{4}, 'x'));
+    EXPECT_EQ(1, rb.pop(value));
+    EXPECT_EQ("xxxx", value);
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.pop(value));
+}
+
+TEST(emplace_ringbuffer, pop_into_optional)
+{
+    lts::emplace_ringbuffer<tracked> rb(2, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+
+    EXPECT_EQ(1, rb.emplace(7, "seven"));
+    {
+        std::optional<tracked> value = rb.pop();
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(7, value->m_value);
+        EXPECT_EQ("seven", value->m_name);
+        EXPECT_EQ(1, tracked::s_alive);
+    }
+    EXPECT_EQ(0, tracked::s_alive);
+
+    EXPECT_FALSE(rb.pop().has_value());
+}
+
+TEST(emplace_ringbuffer, cancel)
+{
+    lts::emplace_ringbuffer<tracked> rb(1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+
+    std::thread consumer {[&rb]() {
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED),
+            rb.pop([](tracked&&) {}, 1));
+    }};
+
+    rb.cancel(lts::ringbuffer_role::CONSUMER);
+    consumer.join();
+}
+
+TEST_UNIQUE_PTR( 1,  1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_UNIQUE_PTR(64,  7, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_UNIQUE_PTR( 1,  1, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+TEST_UNIQUE_PTR(65, 16, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+static void unique_ptr_producer(lts::emplace_ringbuffer<std::unique_ptr<std::size_t>>& rb)
+{
+    long status;
+
+    for (std::size_t produced = 0; produced < ITERATIONS;) {
+        status = rb.emplace(std::make_unique<std::size_t>(produced));
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(1, status);
+        produced++;
+    }
+}
+
+template<std::size_t N>
+static void unique_ptr_consumer(lts::emplace_ringbuffer<std::unique_ptr<std::size_t>>& rb)
+{
+    std::size_t consumed = 0;
+    long status;
+
+    while (consumed < ITERATIONS) {
+        status = rb.pop([&consumed](std::unique_ptr<std::size_t>&& p) {
+            EXPECT_EQ(consumed, *p);
+            consumed++;
+        }, N);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_GT(status, 0);
+    }
+
+    EXPECT_EQ(static_cast<std::size_t>(ITERATIONS), consumed);
+}
@@ -82,14 +82,128 @@ public:
         return read(data, N, ringbuffer_base<T>::template move<T>);
     }
 
-    long read(std::function<bool(T*)> consumer, std::size_t count)
+    /**
+     * Reads up to 'count' elements, each one handed over in place to 'consumer'.
+     *
+     * The consumer may be any callable invocable as bool(T*).
+     * Returning false from it stops the transfer.
+     */
+    template<typename F, typename = std::enable_if_t<std::is_invocable_r_v<bool, F&, T*>>>
+    long read(F&& consumer, std::size_t count)
     {
-        return read(ringbuffer_functor<T>(consumer), count, xfer_consumer<T>);
+        return read(ringbuffer_functor<T, F>{consumer}, count, xfer_consumer<F>);
+    }
+
+    /**
+     * Reads up to 'count' elements directly from the ringbuffer storage.
+     *
+     * The consumer is invoked once as
+     * std::size_t(T* first, std::size_t n1, T* second, std::size_t n2)
+     * with the (at most two) contiguous regions available for reading
+     * and returns number of elements it has actually consumed.
+     * Those elements are released at once.
+     */
+    template<typename F>
+    long read_span(F&& consumer, std::size_t count)
+    {
+        std::size_t consumed;
+        std::size_t available_elements;
+        std::size_t read;
+        ringbuffer_span<T> span;
+        ringbuffer_status rbs;
+
+        if (ringbuffer_base<T>::m_counters.m_consumer.m_peeked > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        if (0 == count)
+            return 0;
+
+        rbs = ringbuffer_base<T>::acquire_available_elements(count, &consumed, &available_elements);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > available_elements)
+            count = available_elements;
+
+        span = ringbuffer_base<T>::make_span(consumed, count);
+
+        read = consumer(span.m_first, span.m_first_count, span.m_second, span.m_second_count);
+        if (read > count)
+            return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
+
+        if (read > 0)
+            ringbuffer_base<T>::retire(consumed, read);
+
+        return read;
+    }
+
+    /**
+     * Gives access to up to 'count' elements available for reading
+     * without consuming them.
+     *
+     * Peeked elements are described by 'span' and remain owned
+     * by the ringbuffer until release() is called. Calling peek() again
+     * before release() replaces the previous one (it starts at the same element).
+     *
+     * @return number of peeked elements (possibly less than 'count')
+     *         or negative ringbuffer_status on error.
+     */
+    long peek(std::size_t count, ringbuffer_span<T>* span)
+    {
+        std::size_t consumed;
+        std::size_t available_elements;
+        ringbuffer_status rbs;
+
+        if (nullptr == span)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        ringbuffer_base<T>::m_counters.m_consumer.m_peeked = 0;
+
+        if (0 == count) {
+            *span = ringbuffer_span<T>{};
+            return 0;
+        }
+
+        rbs = ringbuffer_base<T>::acquire_available_elements(count, &consumed, &available_elements);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > available_elements)
+            count = available_elements;
+
+        *span = ringbuffer_base<T>::make_span(consumed, count);
+        ringbuffer_base<T>::m_counters.m_consumer.m_peeked = count;
+
+        return count;
+    }
+
+    /**
+     * Consumes first 'count' of the peeked elements
+     * with a single release store and (at most) one wake-up of the producer.
+     * Remaining peeked elements (if any) stay in the ringbuffer.
+     *
+     * @return number of consumed elements or negative ringbuffer_status on error.
+     */
+    long release(std::size_t count)
+    {
+        std::size_t consumed;
+
+        if (count > ringbuffer_base<T>::m_counters.m_consumer.m_peeked)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        ringbuffer_base<T>::m_counters.m_consumer.m_peeked = 0;
+
+        if (count > 0) {
+            consumed = ringbuffer_base<T>::m_counters.m_consumer.m_consumed.load(std::memory_order_relaxed);
+            ringbuffer_base<T>::retire(consumed, count);
+        }
+
+        return count;
     }
 
 private:
-    template<typename U>
-    static bool xfer_consumer(ringbuffer_functor<U> dst, U* src, std::size_t count)
+    template<typename F>
+    static bool xfer_consumer(ringbuffer_functor<T, F> dst, T* src, std::size_t count)
     {
         bool status = true;
 
@@ -103,7 +217,6 @@ private:
     template<typename DST, typename SRC>
     long read(DST data, std::size_t count, bool (*xfer)(DST, SRC, std::size_t))
     {
-        std::size_t produced;
         std::size_t consumed;
         std::size_t available_elements;
         std::size_t read_idx;
@@ -111,40 +224,20 @@ private:
         std::size_t remaining;
         ringbuffer_status rbs;
 
+        if (ringbuffer_base<T>::m_counters.m_consumer.m_peeked > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
         if (0 == count)
             return 0;
 
-        if (ringbuffer_base<T>::m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT)) {
-            rbs = ringbuffer_base<T>::get_counters(&produced, &consumed, nullptr);
-            if (rbs != ringbuffer_status::OK)
-                return static_cast<long>(rbs);
-
-            available_elements = produced - consumed;
-            if (0 == available_elements) {
-               return static_cast<long>(ringbuffer_status::WOULD_BLOCK);
-            }
-        } else {
-            for (;;) {
-                rbs = ringbuffer_base<T>::get_counters(&produced, &consumed, nullptr);
-                if (rbs != ringbuffer_status::OK)
-                    return static_cast<long>(rbs);
-
-                available_elements = produced - consumed;
-                if (available_elements > 0)
-                    break; /* leave the loop if we have elements to be read */
-
-                ringbuffer_base<T>::m_reading_semaphore.wait(); /* let's wait until producer will write some data */
-                if (ringbuffer_base<T>::m_is_reading_cancelled) {
-                    ringbuffer_base<T>::m_is_reading_cancelled = false;
-                    return static_cast<long>(ringbuffer_status::OPERATION_CANCELLED);
-                }
-            }
-        }
+        rbs = ringbuffer_base<T>::acquire_available_elements(count, &consumed, &available_elements);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
 
         if (count > available_elements)
             count = available_elements;
 
-        read_idx = consumed % ringbuffer_base<T>::m_capacity;
+        read_idx = ringbuffer_base<T>::index(consumed);
 
         split = ((read_idx + count) > ringbuffer_base<T>::m_capacity) ? (ringbuffer_base<T>::m_capacity - read_idx) : 0;
         remaining = count;
@@ -161,10 +254,7 @@ private:
         if (false == xfer(data, ringbuffer_base<T>::m_buffer + read_idx, remaining))
             return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
 
-        ringbuffer_base<T>::m_counters.m_consumed.store(consumed + count, std::memory_order_relaxed);
-
-        if (!ringbuffer_base<T>::m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT))
-            ringbuffer_base<T>::m_writing_semaphore.post(); /* wake up one thread waiting for some space in the buffer (if any) */
+        ringbuffer_base<T>::retire(consumed, count);
 
         return count;
     }
@@ -0,0 +1,333 @@
+/**
+ * @file magic_ringbuffer.hpp
+ *
+ * Definition of single-producer/single-consumer byte ringbuffer
+ * whose storage is mapped twice, back to back, in the virtual address space.
+ * Thanks to that any window of up to 'capacity' bytes is contiguous,
+ * so neither writes nor reads have to be split at the wrap point
+ * and data may be parsed in place.
+ * Its non-blocking path is completely lockless.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _MAGIC_RINGBUFFER_HPP_
+#define _MAGIC_RINGBUFFER_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <bitset>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(DEBUG_RINGBUFFER)
+#include <iostream>
+#endif
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "ringbuffer_base.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Byte ringbuffer backed by a memfd mapped twice, one mapping right after the other.
+ *
+ * Capacity is rounded up to a power of two, not less than the page size,
+ * thus it is a multiple of the page size (as required by mmap())
+ * and indices are always masked.
+ * reserve() and peek() hand out a single contiguous pointer
+ * even if the window straddles the end of the storage.
+ */
+class magic_ringbuffer : public ringbuffer_base<std::uint8_t>
+{
+public:
+    typedef std::uint8_t value_type;
+
+    explicit magic_ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags) :
+        ringbuffer_base<std::uint8_t>::ringbuffer_base{roundup_capacity(capacity), flags,
+            ringbuffer_capacity_policy::EXACT, ringbuffer_storage<std::uint8_t>{map, unmap}}
+    {
+        assert(capacity > 0);
+        assert(m_capacity < LONG_MAX / 2);
+
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+        std::cout << to_string() << std::endl;
+#endif
+    }
+
+    ~magic_ringbuffer() override
+    {
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+#endif
+    }
+
+    /**
+     * Writes up to 'count' bytes with a single memcpy().
+     * Refused while a reservation is pending.
+     *
+     * @return number of written bytes or negative ringbuffer_status on error.
+     */
+    long write(const std::uint8_t* data, std::size_t count)
+    {
+        std::uint8_t* dst = nullptr;
+        long status;
+
+        if (m_counters.m_producer.m_reserved > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        status = reserve(count, &dst, true);
+
+        if (status > 0) {
+            std::memcpy(dst, data, status);
+            status = commit(status);
+        }
+
+        return status;
+    }
+
+    /**
+     * Reads up to 'count' bytes with a single memcpy().
+     * Refused while a peek is pending.
+     *
+     * @return number of read bytes or negative ringbuffer_status on error.
+     */
+    long read(std::uint8_t* data, std::size_t count)
+    {
+        const std::uint8_t* src = nullptr;
+        long status;
+
+        if (m_counters.m_consumer.m_peeked > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        status = peek(count, &src);
+
+        if (status > 0) {
+            std::memcpy(data, src, status);
+            status = release(status);
+        }
+
+        return status;
+    }
+
+    /**
+     * Reserves up to 'count' contiguous bytes for writing.
+     * None of them is visible to the consumer until commit() is called.
+     * A reservation refused for lack of room is not counted as dropped.
+     *
+     * @return number of reserved bytes (possibly less than 'count')
+     *         or negative ringbuffer_status on error.
+     */
+    long reserve(std::size_t count, std::uint8_t** data)
+    {
+        return reserve(count, data, false);
+    }
+
+    /**
+     * Publishes first 'count' of the reserved bytes.
+     *
+     * @return number of published bytes or negative ringbuffer_status on error.
+     */
+    long commit(std::size_t count)
+    {
+        std::size_t produced;
+
+        if (count > m_counters.m_producer.m_reserved)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_producer.m_reserved = 0;
+
+        if (count > 0) {
+            produced = m_counters.m_producer.m_produced.load(std::memory_order_relaxed);
+            publish(produced, count);
+        }
+
+        return count;
+    }
+
+    /**
+     * Gives access to up to 'count' contiguous bytes available for reading
+     * without consuming them. They stay valid until release() is called.
+     *
+     * @return number of peeked bytes (possibly less than 'count')
+     *         or negative ringbuffer_status on error.
+     */
+    long peek(std::size_t count, const std::uint8_t** data)
+    {
+        std::size_t consumed;
+        std::size_t available_elements;
+        ringbuffer_status rbs;
+
+        if (!is_valid())
+            return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
+
+        if (nullptr == data)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_consumer.m_peeked = 0;
+
+        if (0 == count)
+            return 0;
+
+        rbs = acquire_available_elements(count, &consumed, &available_elements);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > available_elements)
+            count = available_elements;
+
+        *data = m_buffer + index(consumed);
+        m_counters.m_consumer.m_peeked = count;
+
+        return count;
+    }
+
+    /**
+     * Consumes first 'count' of the peeked bytes.
+     *
+     * @return number of consumed bytes or negative ringbuffer_status on error.
+     */
+    long release(std::size_t count)
+    {
+        std::size_t consumed;
+
+        if (count > m_counters.m_consumer.m_peeked)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_consumer.m_peeked = 0;
+
+        if (count > 0) {
+            consumed = m_counters.m_consumer.m_consumed.load(std::memory_order_relaxed);
+            retire(consumed, count);
+        }
+
+        return count;
+    }
+
+private:
+    long reserve(std::size_t count, std::uint8_t** data, bool count_dropped)
+    {
+        std::size_t produced;
+        std::size_t free_elements;
+        ringbuffer_status rbs;
+
+        if (!is_valid())
+            return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
+
+        if (nullptr == data)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_producer.m_reserved = 0;
+
+        if (0 == count)
+            return 0;
+
+        rbs = acquire_free_elements(count, &produced, &free_elements, count_dropped);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > free_elements)
+            count = free_elements;
+
+        *data = m_buffer + index(produced);
+        m_counters.m_producer.m_reserved = count;
+
+        return count;
+    }
+
+    static std::size_t roundup_capacity(std::size_t capacity)
+    {
+        const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+        return (capacity > page_size) ? (std::size_t{1} << ilog2_roundup(capacity)) : page_size;
+    }
+
+    /* Reserves 2 * size bytes of address space and maps the same memfd
+    into both of its halves. Returns nullptr on failure. */
+    static std::uint8_t* map(std::size_t size)
+    {
+        int fd;
+        void* addr;
+        std::uint8_t* base = nullptr;
+
+        fd = ::memfd_create("magic_ringbuffer", MFD_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+
+        if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+            addr = ::mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (addr != MAP_FAILED) {
+                base = static_cast<std::uint8_t*>(addr);
+                if ((::mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+                    (::mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+                    ::munmap(base, 2 * size);
+                    base = nullptr;
+                }
+            }
+        }
+
+        ::close(fd); /* mappings keep the memory alive */
+
+        return base;
+    }
+
+    static void unmap(std::uint8_t* base, std::size_t size)
+    {
+        ::munmap(base, 2 * size);
+    }
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _MAGIC_RINGBUFFER_HPP_ */
@@ -0,0 +1,276 @@
+/**
+ * @file magic_ringbuffer_test.cpp
+ *
+ * Test procedures for 'magic_ringbuffer' implementation.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "magic_ringbuffer.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 20000
+#define PACKET_SIZE 188 /* mpeg2ts packet, does not divide any power of two */
+
+#define TEST_PACKETS(CAPACITY, FLAGS, NAME)                                                  \
+TEST(magic_ringbuffer, packets_capacity_##CAPACITY##_##NAME)                                 \
+{                                                                                            \
+    lts::magic_ringbuffer rb(CAPACITY, FLAGS);                                               \
+    ASSERT_TRUE(rb.is_valid());                                                              \
+                                                                                             \
+    std::thread producer {packet_producer, std::ref(rb)};                                    \
+    std::thread consumer {packet_consumer, std::ref(rb)};                                    \
+                                                                                             \
+    producer.join();                                                                         \
+    consumer.join();                                                                         \
+                                                                                             \
+    std::cout << static_cast<std::string>(rb) << std::endl;                                  \
+}
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+static void packet_producer(lts::magic_ringbuffer& rb);
+static void packet_consumer(lts::magic_ringbuffer& rb);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(magic_ringbuffer, create)
+{
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t capacities[][2] = {{1, page_size}, {page_size, page_size},
+        {page_size + 1, 2 * page_size}, {3 * page_size, 4 * page_size}};
+
+    for (const auto& c : capacities) {
+        lts::magic_ringbuffer rb(c[0], RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+        ASSERT_TRUE(rb.is_valid());
+        EXPECT_EQ(c[1], rb.capacity());
+        EXPECT_EQ(RINGBUFFER_RD_BLOCKING_WR_BLOCKING, rb.flags());
+        std::cout << static_cast<std::string>(rb) << std::endl;
+    }
+}
+
+TEST(magic_ringbuffer, contiguous_across_wrap_point)
+{
+    lts::magic_ringbuffer rb(1, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    const size_t capacity = rb.capacity();
+    std::uint8_t* wr = nullptr;
+    const std::uint8_t* rd = nullptr;
+
+    ASSERT_TRUE(rb.is_valid());
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.reserve(1, nullptr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.peek(1, nullptr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.peek(1, &rd));
+
+    /* move both indices close to the end of the storage */
+    ASSERT_EQ(static_cast<long>(capacity - 10), rb.reserve(capacity - 10, &wr));
+    ASSERT_EQ(static_cast<long>(capacity - 10), rb.commit(capacity - 10));
+    ASSERT_EQ(static_cast<long>(capacity - 10), rb.peek(capacity, &rd));
+    ASSERT_EQ(static_cast<long>(capacity - 10), rb.release(capacity - 10));
+
+    /* the whole buffer is now one contiguous window straddling the wrap point */
+    ASSERT_EQ(static_cast<long>(capacity), rb.reserve(capacity + 1, &wr));
+    for (size_t i = 0; i < capacity; ++i)
+        wr[i] = static_cast<std::uint8_t>(i);
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.commit(capacity + 1));
+    ASSERT_EQ(static_cast<long>(capacity), rb.commit(capacity));
+
+    /* refused reservation is not a drop, refused write is */
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.reserve(1, &wr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.write(wr, 1));
+
+    ASSERT_EQ(static_cast<long>(capacity), rb.peek(capacity, &rd));
+    for (size_t i = 0; i < capacity; ++i)
+        ASSERT_EQ(static_cast<std::uint8_t>(i), rd[i]);
+    ASSERT_EQ(static_cast<long>(capacity), rb.release(capacity));
+
+    /* plain write()/read() do not split either */
+    std::uint8_t in[20], out[20];
+    for (size_t i = 0; i < sizeof(in); ++i)
+        in[i] = static_cast<std::uint8_t>(100 + i);
+    EXPECT_EQ(static_cast<long>(sizeof(in)), rb.write(in, sizeof(in)));
+    EXPECT_EQ(static_cast<long>(sizeof(out)), rb.read(out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+
+    /* write()/read() never hand out the bytes of a pending reserve()/peek() */
+    ASSERT_EQ(5L, rb.reserve(5, &wr));
+    std::memset(wr, 0xAA, 5);
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.write(in, sizeof(in)));
+    ASSERT_EQ(5L, rb.commit(5));
+    ASSERT_EQ(5L, rb.peek(5, &rd));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.read(out, sizeof(out)));
+    for (size_t i = 0; i < 5; ++i)
+        ASSERT_EQ(0xAA, rd[i]);
+    ASSERT_EQ(5L, rb.release(5));
+
+    size_t produced, consumed, dropped;
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(2 * capacity + 15, produced);
+    EXPECT_EQ(2 * capacity + 15, consumed);
+    EXPECT_EQ(1U, dropped);
+}
+
+TEST(magic_ringbuffer, cancel)
+{
+    lts::magic_ringbuffer rb(1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+    ASSERT_TRUE(rb.is_valid());
+
+    std::thread consumer {[&rb]() {
+        const std::uint8_t* rd = nullptr;
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED), rb.peek(1, &rd));
+    }};
+
+    rb.cancel(lts::ringbuffer_role::CONSUMER);
+    consumer.join();
+}
+
+TEST(magic_ringbuffer, invalid)
+{
+    struct rlimit saved, limited;
+    ASSERT_EQ(0, ::getrlimit(RLIMIT_AS, &saved));
+
+    /* make the double mapping fail */
+    limited = saved;
+    limited.rlim_cur = 1UL << 30;
+    ASSERT_EQ(0, ::setrlimit(RLIMIT_AS, &limited));
+    lts::magic_ringbuffer rb(1UL << 31, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    ASSERT_EQ(0, ::setrlimit(RLIMIT_AS, &saved));
+
+    ASSERT_FALSE(rb.is_valid());
+
+    std::uint8_t data[1] = {0};
+    std::uint8_t* wr = nullptr;
+    const std::uint8_t* rd = nullptr;
+    const long error = static_cast<long>(lts::ringbuffer_status::INTERNAL_ERROR);
+
+    EXPECT_EQ(error, rb.write(data, 1));
+    EXPECT_EQ(error, rb.read(data, 1));
+    EXPECT_EQ(error, rb.reserve(1, &wr));
+    EXPECT_EQ(error, rb.peek(1, &rd));
+}
+
+TEST_PACKETS(4096, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_PACKETS(65536, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_PACKETS(4096, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+/* Each packet is built in place and starts with its sequence number. */
+static void packet_producer(lts::magic_ringbuffer& rb)
+{
+    std::uint8_t* packet = nullptr;
+    long status;
+
+    for (std::uint32_t n = 0; n < ITERATIONS;) {
+        status = rb.reserve(PACKET_SIZE, &packet);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_GT(status, 0);
+        if (status < PACKET_SIZE) {
+            std::this_thread::yield(); /* wait for room for the whole packet */
+            continue;
+        }
+        memset(packet, static_cast<int>(n & 0xff), PACKET_SIZE);
+        memcpy(packet, &n, sizeof(n));
+        ASSERT_EQ(PACKET_SIZE, rb.commit(PACKET_SIZE));
+        n++;
+    }
+}
+
+/* Each packet is verified in place, although most of them straddle the wrap point. */
+static void packet_consumer(lts::magic_ringbuffer& rb)
+{
+    const std::uint8_t* packet = nullptr;
+    std::uint32_t seq;
+    long status;
+
+    for (std::uint32_t n = 0; n < ITERATIONS;) {
+        status = rb.peek(PACKET_SIZE, &packet);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_GT(status, 0);
+        if (status < PACKET_SIZE) {
+            std::this_thread::yield(); /* wait for the whole packet */
+            continue;
+        }
+        memcpy(&seq, packet, sizeof(seq));
+        ASSERT_EQ(n, seq);
+        for (size_t i = sizeof(seq); i < PACKET_SIZE; ++i)
+            ASSERT_EQ(n & 0xff, packet[i]);
+        ASSERT_EQ(PACKET_SIZE, rb.release(PACKET_SIZE));
+        n++;
+    }
+}
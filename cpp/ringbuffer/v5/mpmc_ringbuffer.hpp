@@ -0,0 +1,462 @@
+/**
+ * @file mpmc_ringbuffer.hpp
+ *
+ * Definition of multi-producer/multi-consumer bounded ringbuffer.
+ * Based on per-slot sequence numbers (Dmitry Vyukov's bounded MPMC queue).
+ * Its non-blocking path is completely lockless.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _MPMC_RINGBUFFER_HPP_
+#define _MPMC_RINGBUFFER_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <bitset>
+#include <mutex>
+#include <condition_variable>
+#include <iterator>
+#include <utility>
+
+#include <cassert>
+#include <cstdint>
+#include <climits>
+
+#if defined(DEBUG_RINGBUFFER)
+#include <iostream>
+#endif
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "ringbuffer_base.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Bounded ringbuffer which can be written to and read from
+ * by any number of threads at the same time.
+ *
+ * Capacity is always rounded up to the nearest power of two
+ * (not less than 2, as the sequence numbers of a single slot would be ambiguous).
+ * Elements written by one call are claimed slot by slot,
+ * thus they may interleave with elements written concurrently by other producers.
+ */
+template<typename T>
+class mpmc_ringbuffer
+{
+public:
+    typedef T value_type;
+
+    explicit mpmc_ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags) :
+        m_capacity{(capacity > 2) ? (std::size_t{1} << ilog2_roundup(capacity)) : 2},
+        m_mask{m_capacity - 1},
+        m_flags{flags},
+        m_slots{nullptr},
+        m_enqueue_pos{},
+        m_dequeue_pos{},
+        m_dropped{0},
+        m_readers{},
+        m_writers{}
+    {
+        assert(capacity > 0);
+        assert(m_capacity < LONG_MAX);
+
+        m_slots = new slot[m_capacity];
+        for (std::size_t i = 0; i < m_capacity; ++i)
+            m_slots[i].m_sequence.store(i, std::memory_order_relaxed);
+
+        m_enqueue_pos.m_value.store(0U, std::memory_order_relaxed);
+        m_dequeue_pos.m_value.store(0U, std::memory_order_relaxed);
+
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+        std::cout << to_string() << std::endl;
+#endif
+    }
+
+    ~mpmc_ringbuffer()
+    {
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+#endif
+
+        delete [] m_slots;
+    }
+
+    mpmc_ringbuffer(const mpmc_ringbuffer&) = delete;
+    mpmc_ringbuffer(mpmc_ringbuffer&&) = delete;
+    mpmc_ringbuffer& operator = (const mpmc_ringbuffer&) = delete;
+    mpmc_ringbuffer& operator = (mpmc_ringbuffer&&) = delete;
+
+    std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags() const
+    {
+        return m_flags;
+    }
+
+    /* 'produced' and 'consumed' count claimed slots,
+    so they may include elements which are just being transferred. */
+    ringbuffer_status get_counters(std::size_t* produced, std::size_t* consumed, std::size_t* dropped) const
+    {
+        std::size_t l_consumed = m_dequeue_pos.m_value.load(std::memory_order_acquire);
+        std::size_t l_produced = m_enqueue_pos.m_value.load(std::memory_order_acquire);
+
+        if (l_produced < l_consumed)
+            return ringbuffer_status::INTERNAL_ERROR;
+
+        if (produced) *produced = l_produced;
+        if (consumed) *consumed = l_consumed;
+
+        if (dropped)
+            *dropped = m_dropped.load(std::memory_order_relaxed);
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Wakes up all threads blocked (at the moment of this call)
+    in write() (for PRODUCER) or read() (for CONSUMER). */
+    void cancel(ringbuffer_role role)
+    {
+        if (role == ringbuffer_role::PRODUCER) {
+            if (!m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT))
+                m_writers.cancel();
+        }
+        else
+        if (role == ringbuffer_role::CONSUMER) {
+            if (!m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+                m_readers.cancel();
+        }
+        else {
+            /* do noting */
+        }
+    }
+
+    long write(const T& data)
+    {
+        return write(&data, 1);
+    }
+
+    long write(T&& data)
+    {
+        return write(std::make_move_iterator(&data), 1);
+    }
+
+    template<std::size_t N>
+    long write(const T (&data)[N])
+    {
+        return write(data, N);
+    }
+
+    template<std::size_t N>
+    long write(T (&&data)[N])
+    {
+        return write(std::make_move_iterator(data), N);
+    }
+
+    long read(T& data)
+    {
+        return read(&data, 1);
+    }
+
+    template<std::size_t N>
+    long read(T (&data)[N])
+    {
+        return read(data, N);
+    }
+
+    std::string to_string() const
+    {
+        std::ostringstream stream;
+
+        stream << "mpmc_ringbuffer@";
+        stream << std::hex << this;
+        stream << " [capacity: ";
+        stream << std::dec << m_capacity;
+        stream << ", ";
+        stream << "write policy: ";
+        stream << (m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT) ? "non_blocking" : "blocking");
+        stream << ", ";
+        stream << "read policy: ";
+        stream << (m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT) ? "non_blocking" : "blocking");
+        stream << " [";
+        stream << "produced: ";
+        stream << std::dec << m_enqueue_pos.m_value.load(std::memory_order_relaxed);
+        stream << ", ";
+        stream << "consumed: ";
+        stream << std::dec << m_dequeue_pos.m_value.load(std::memory_order_relaxed);
+        stream << ", ";
+        stream << "dropped: ";
+        stream << std::dec << m_dropped.load(std::memory_order_relaxed);
+        stream << "]]";
+
+        return stream.str();
+    }
+
+    operator std::string () const
+    {
+        return to_string();
+    }
+
+private:
+    struct slot
+    {
+        std::atomic<std::size_t> m_sequence;
+        T m_data;
+    };
+
+    struct alignas(CACHELINE_SIZE) position
+    {
+        std::atomic<std::size_t> m_value;
+    };
+
+    /* Threads blocked on either side of the ringbuffer.
+    The opposite side takes the mutex and notifies only when
+    there is at least one registered waiter. */
+    struct alignas(CACHELINE_SIZE) waiters
+    {
+        template<typename P>
+        ringbuffer_status wait(P ready)
+        {
+            std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+            const std::size_t generation = m_cancel_generation;
+
+            m_count.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            while (!ready() && (generation == m_cancel_generation))
+                m_condvar.wait(lock);
+
+            m_count.fetch_sub(1, std::memory_order_relaxed);
+
+            return (generation == m_cancel_generation) ?
+                ringbuffer_status::OK : ringbuffer_status::OPERATION_CANCELLED;
+        }
+
+        void notify(bool all)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (m_count.load(std::memory_order_relaxed) > 0) {
+                do {
+                    std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+                } while (0);
+
+                /* the lock does not need to be held for notification */
+                if (all)
+                    m_condvar.notify_all();
+                else
+                    m_condvar.notify_one();
+            }
+        }
+
+        void cancel()
+        {
+            do {
+                std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+                m_cancel_generation++;
+            } while (0);
+
+            m_condvar.notify_all();
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_condvar;
+        std::atomic<std::size_t> m_count{0};
+        std::size_t m_cancel_generation{0};
+    };
+
+    bool is_writable() const
+    {
+        std::size_t pos = m_enqueue_pos.m_value.load(std::memory_order_relaxed);
+        return m_slots[pos & m_mask].m_sequence.load(std::memory_order_acquire) == pos;
+    }
+
+    bool is_readable() const
+    {
+        std::size_t pos = m_dequeue_pos.m_value.load(std::memory_order_relaxed);
+        return m_slots[pos & m_mask].m_sequence.load(std::memory_order_acquire) == (pos + 1);
+    }
+
+    template<typename SRC>
+    bool try_enqueue(SRC src)
+    {
+        slot* s;
+        std::size_t pos = m_enqueue_pos.m_value.load(std::memory_order_relaxed);
+
+        for (;;) {
+            s = &m_slots[pos & m_mask];
+            std::size_t sequence = s->m_sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+            if (diff == 0) {
+                if (m_enqueue_pos.m_value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else
+            if (diff < 0)
+                return false; /* ringbuffer is full */
+            else
+                pos = m_enqueue_pos.m_value.load(std::memory_order_relaxed);
+        }
+
+        s->m_data = *src;
+        s->m_sequence.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool try_dequeue(T* dst)
+    {
+        slot* s;
+        std::size_t pos = m_dequeue_pos.m_value.load(std::memory_order_relaxed);
+
+        for (;;) {
+            s = &m_slots[pos & m_mask];
+            std::size_t sequence = s->m_sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+
+            if (diff == 0) {
+                if (m_dequeue_pos.m_value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else
+            if (diff < 0)
+                return false; /* ringbuffer is empty */
+            else
+                pos = m_dequeue_pos.m_value.load(std::memory_order_relaxed);
+        }
+
+        *dst = std::move(s->m_data);
+        s->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    template<typename SRC>
+    long write(SRC data, std::size_t count)
+    {
+        std::size_t written;
+        ringbuffer_status rbs;
+
+        if (0 == count)
+            return 0;
+
+        for (;;) {
+            for (written = 0; written < count; ++written, ++data)
+                if (!try_enqueue(data))
+                    break;
+
+            if (written > 0)
+                break;
+
+            if (m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT)) {
+                m_dropped++;
+                return static_cast<long>(ringbuffer_status::WOULD_BLOCK);
+            }
+
+            rbs = m_writers.wait([this]() { return is_writable(); }); /* let's wait until consumers will read some data */
+            if (rbs != ringbuffer_status::OK)
+                return static_cast<long>(rbs);
+        }
+
+        if (!m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+            m_readers.notify(written > 1); /* wake up threads waiting for new data (if any) */
+
+        return written;
+    }
+
+    long read(T* data, std::size_t count)
+    {
+        std::size_t read;
+        ringbuffer_status rbs;
+
+        if (0 == count)
+            return 0;
+
+        for (;;) {
+            for (read = 0; read < count; ++read)
+                if (!try_dequeue(data + read))
+                    break;
+
+            if (read > 0)
+                break;
+
+            if (m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+                return static_cast<long>(ringbuffer_status::WOULD_BLOCK);
+
+            rbs = m_readers.wait([this]() { return is_readable(); }); /* let's wait until producers will write some data */
+            if (rbs != ringbuffer_status::OK)
+                return static_cast<long>(rbs);
+        }
+
+        if (!m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT))
+            m_writers.notify(read > 1); /* wake up threads waiting for some space in the buffer (if any) */
+
+        return read;
+    }
+
+    const std::size_t m_capacity;
+    const std::size_t m_mask;
+    const std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> m_flags;
+    slot* m_slots;
+    position m_enqueue_pos;
+    position m_dequeue_pos;
+    std::atomic<std::size_t> m_dropped;
+    waiters m_readers;
+    waiters m_writers;
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _MPMC_RINGBUFFER_HPP_ */
@@ -0,0 +1,247 @@
+/**
+ * @file mpmc_ringbuffer_test.cpp
+ *
+ * Test procedures for 'mpmc_ringbuffer' implementation.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "mpmc_ringbuffer.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 100000
+
+#define TEST_MPMC(PRODUCERS, CONSUMERS, CAPACITY, FLAGS, NAME)                               \
+TEST(mpmc_ringbuffer, PRODUCERS##in_##CONSUMERS##out_capacity_##CAPACITY##_##NAME)           \
+{                                                                                            \
+    lts::mpmc_ringbuffer<size_t> rb(CAPACITY, FLAGS);                                        \
+                                                                                             \
+    run_mpmc(rb, PRODUCERS, CONSUMERS);                                                      \
+                                                                                             \
+    std::cout << static_cast<std::string>(rb) << std::endl;                                  \
+}
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+template<typename RB> static void run_mpmc(RB& rb, size_t producers, size_t consumers);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(mpmc_ringbuffer, create)
+{
+    const size_t capacities[][2] = {{1, 2}, {2, 2}, {5, 8}, {64, 64}, {65, 128}};
+
+    for (const auto& c : capacities) {
+        lts::mpmc_ringbuffer<size_t> rb(c[0], RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+        EXPECT_EQ(c[1], rb.capacity());
+        EXPECT_EQ(RINGBUFFER_RD_BLOCKING_WR_BLOCKING, rb.flags());
+        std::cout << static_cast<std::string>(rb) << std::endl;
+    }
+}
+
+TEST(mpmc_ringbuffer, write_read_nonblocking)
+{
+    lts::mpmc_ringbuffer<size_t> rb(4, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    size_t produced, consumed, dropped;
+    size_t in[] = {0, 1, 2, 3, 4, 5};
+    size_t out[6] = {};
+    size_t value;
+
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.read(value));
+
+    EXPECT_EQ(4, rb.write(in));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.write(in[4]));
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(4U, produced);
+    EXPECT_EQ(0U, consumed);
+    EXPECT_EQ(1U, dropped);
+
+    EXPECT_EQ(1, rb.read(value));
+    EXPECT_EQ(0U, value);
+    EXPECT_EQ(1, rb.write(in[4]));
+
+    EXPECT_EQ(4, rb.read(out));
+    for (size_t i = 0; i < 4; ++i)
+        EXPECT_EQ(i + 1, out[i]);
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(5U, produced);
+    EXPECT_EQ(5U, consumed);
+}
+
+TEST(mpmc_ringbuffer, cancel)
+{
+    lts::mpmc_ringbuffer<size_t> rb(1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+    std::vector<std::thread> consumers;
+
+    for (size_t i = 0; i < 3; ++i)
+        consumers.emplace_back([&rb]() {
+            size_t value;
+            EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED), rb.read(value));
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    rb.cancel(lts::ringbuffer_role::CONSUMER);
+
+    for (auto& t : consumers)
+        t.join();
+
+    EXPECT_EQ(1, rb.write(size_t{1}));
+    EXPECT_EQ(1, rb.write(size_t{1}));
+
+    std::thread producer {[&rb]() {
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED), rb.write(size_t{2}));
+    }};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    rb.cancel(lts::ringbuffer_role::PRODUCER);
+
+    producer.join();
+}
+
+TEST_MPMC(1, 1,  1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_MPMC(4, 1, 64, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_MPMC(1, 4, 64, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_MPMC(4, 4,  2, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_MPMC(4, 4, 64, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+
+TEST_MPMC(1, 1,  1, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+TEST_MPMC(4, 4,  2, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+TEST_MPMC(4, 4, 64, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+/* Each producer writes values p, p + producers, p + 2 * producers, ...
+so every value in [0, ITERATIONS * producers) shall be consumed exactly once. */
+template<typename RB>
+static void run_mpmc(RB& rb, size_t producers, size_t consumers)
+{
+    const size_t total = ITERATIONS * producers;
+    std::vector<std::atomic<unsigned>> seen(total);
+    std::atomic<size_t> consumed{0};
+    std::atomic<size_t> finished{0};
+    std::vector<std::thread> threads;
+
+    for (auto& s : seen)
+        s.store(0, std::memory_order_relaxed);
+
+    for (size_t p = 0; p < producers; ++p)
+        threads.emplace_back([&rb, p, producers]() {
+            size_t value = p;
+            size_t produced = 0;
+            while (produced < ITERATIONS) {
+                long status = rb.write(value);
+                if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                ASSERT_EQ(1, status);
+                value += producers;
+                produced++;
+            }
+        });
+
+    for (size_t c = 0; c < consumers; ++c)
+        threads.emplace_back([&rb, &seen, &consumed, &finished, total]() {
+            size_t value;
+            while (consumed.load() < total) {
+                long status = rb.read(value);
+                if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED) == status)
+                    continue;
+                ASSERT_EQ(1, status);
+                ASSERT_LT(value, total);
+                seen[value]++;
+                consumed++;
+            }
+            finished++;
+        });
+
+    /* consumers blocked in read() after the last element was taken
+    are released by cancelling them until all of them are done */
+    while (finished.load() < consumers) {
+        if (consumed.load() >= total)
+            rb.cancel(lts::ringbuffer_role::CONSUMER);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    for (size_t i = 0; i < total; ++i)
+        ASSERT_EQ(1U, seen[i].load()) << "value " << i;
+}
@@ -82,14 +82,131 @@ public:
         return write(data, N, ringbuffer_base<T>::template move<T>);
     }
 
-    long write(std::function<bool(T*)> producer, std::size_t count)
+    /**
+     * Writes up to 'count' elements, each one produced in place by 'producer'.
+     *
+     * The producer may be any callable invocable as bool(T*).
+     * Returning false from it stops the transfer.
+     */
+    template<typename F, typename = std::enable_if_t<std::is_invocable_r_v<bool, F&, T*>>>
+    long write(F&& producer, std::size_t count)
     {
-        return write(ringbuffer_functor<T>(producer), count, xfer_producer<T>);
+        return write(ringbuffer_functor<T, F>{producer}, count, xfer_producer<F>);
+    }
+
+    /**
+     * Writes up to 'count' elements directly into the ringbuffer storage.
+     *
+     * The producer is invoked once as
+     * std::size_t(T* first, std::size_t n1, T* second, std::size_t n2)
+     * with the (at most two) contiguous regions available for writing
+     * and returns number of elements it has actually filled in.
+     * Those elements are published at once.
+     */
+    template<typename F>
+    long write_span(F&& producer, std::size_t count)
+    {
+        std::size_t produced;
+        std::size_t free_elements;
+        std::size_t written;
+        ringbuffer_span<T> span;
+        ringbuffer_status rbs;
+
+        if (ringbuffer_base<T>::m_counters.m_producer.m_reserved > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        if (0 == count)
+            return 0;
+
+        rbs = ringbuffer_base<T>::acquire_free_elements(count, &produced, &free_elements, true);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > free_elements)
+            count = free_elements;
+
+        span = ringbuffer_base<T>::make_span(produced, count);
+
+        written = producer(span.m_first, span.m_first_count, span.m_second, span.m_second_count);
+        if (written > count)
+            return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
+
+        if (written > 0)
+            ringbuffer_base<T>::publish(produced, written);
+
+        return written;
+    }
+
+    /**
+     * Reserves up to 'count' elements of the ringbuffer storage for writing.
+     *
+     * Reserved elements are described by 'span' and may be filled in
+     * at the producer's pace. None of them is visible to the consumer
+     * until commit() is called. Calling reserve() again before commit()
+     * replaces the previous reservation (it starts at the same element).
+     * While a reservation is pending, write() and write_span() fail
+     * with INVALID_ARGUMENT, as they would publish the reserved elements.
+     * A reservation refused for lack of room is not counted as dropped.
+     *
+     * @return number of reserved elements (possibly less than 'count')
+     *         or negative ringbuffer_status on error.
+     */
+    long reserve(std::size_t count, ringbuffer_span<T>* span)
+    {
+        std::size_t produced;
+        std::size_t free_elements;
+        ringbuffer_status rbs;
+
+        if (nullptr == span)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        ringbuffer_base<T>::m_counters.m_producer.m_reserved = 0;
+
+        if (0 == count) {
+            *span = ringbuffer_span<T>{};
+            return 0;
+        }
+
+        rbs = ringbuffer_base<T>::acquire_free_elements(count, &produced, &free_elements, false);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > free_elements)
+            count = free_elements;
+
+        *span = ringbuffer_base<T>::make_span(produced, count);
+        ringbuffer_base<T>::m_counters.m_producer.m_reserved = count;
+
+        return count;
+    }
+
+    /**
+     * Publishes first 'count' of the reserved elements
+     * with a single release store and (at most) one wake-up of the consumer.
+     * Remaining reserved elements (if any) are given back to the ringbuffer.
+     *
+     * @return number of published elements or negative ringbuffer_status on error.
+     */
+    long commit(std::size_t count)
+    {
+        std::size_t produced;
+
+        if (count > ringbuffer_base<T>::m_counters.m_producer.m_reserved)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        ringbuffer_base<T>::m_counters.m_producer.m_reserved = 0;
+
+        if (count > 0) {
+            produced = ringbuffer_base<T>::m_counters.m_producer.m_produced.load(std::memory_order_relaxed);
+            ringbuffer_base<T>::publish(produced, count);
+        }
+
+        return count;
     }
 
 private:
-    template<typename U>
-    static bool xfer_producer(U* dst, ringbuffer_functor<U> src, std::size_t count)
+    template<typename F>
+    static bool xfer_producer(T* dst, ringbuffer_functor<T, F> src, std::size_t count)
     {
         bool status = true;
 
@@ -104,48 +221,26 @@ private:
     long write(SRC data, std::size_t count, bool (*xfer)(DST, SRC, std::size_t))
     {
         std::size_t produced;
-        std::size_t consumed;
         std::size_t free_elements;
         std::size_t write_idx;
         std::size_t split;
         std::size_t remaining;
         ringbuffer_status rbs;
 
+        if (ringbuffer_base<T>::m_counters.m_producer.m_reserved > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
         if (0 == count)
             return 0;
 
-        if (ringbuffer_base<T>::m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT)) {
-            rbs = ringbuffer_base<T>::get_counters(&produced, &consumed, nullptr);
-            if (rbs != ringbuffer_status::OK)
-                return static_cast<long>(rbs);
-
-            free_elements = ringbuffer_base<T>::m_capacity - (produced - consumed);
-            if (0 == free_elements) {
-                ringbuffer_base<T>::m_counters.m_dropped++;
-                return static_cast<long>(ringbuffer_status::WOULD_BLOCK);
-            }
-        } else {
-            for (;;) {
-                rbs = ringbuffer_base<T>::get_counters(&produced, &consumed, nullptr);
-                if (rbs != ringbuffer_status::OK)
-                    return static_cast<long>(rbs);
-
-                free_elements = ringbuffer_base<T>::m_capacity - (produced - consumed);
-                if (free_elements > 0)
-                    break; /* leave the loop if we have room for new data */
-
-                ringbuffer_base<T>::m_writing_semaphore.wait(); /* let's wait until consumer will read some data */
-                if (ringbuffer_base<T>::m_is_writing_cancelled) {
-                    ringbuffer_base<T>::m_is_writing_cancelled = false;
-                    return static_cast<long>(ringbuffer_status::OPERATION_CANCELLED);
-                }
-            }
-        }
+        rbs = ringbuffer_base<T>::acquire_free_elements(count, &produced, &free_elements, true);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
 
         if (count > free_elements)
             count = free_elements;
 
-        write_idx = produced % ringbuffer_base<T>::m_capacity;
+        write_idx = ringbuffer_base<T>::index(produced);
 
         split = ((write_idx + count) > ringbuffer_base<T>::m_capacity) ? (ringbuffer_base<T>::m_capacity - write_idx) : 0;
         remaining = count;
@@ -162,10 +257,7 @@ private:
         if (false == xfer(ringbuffer_base<T>::m_buffer + write_idx, data, remaining))
             return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
 
-        ringbuffer_base<T>::m_counters.m_produced.store(produced + count, std::memory_order_relaxed);
-
-        if (!ringbuffer_base<T>::m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
-            ringbuffer_base<T>::m_reading_semaphore.post(); /* wake up one thread waiting for new data (if any) */
+        ringbuffer_base<T>::publish(produced, count);
 
         return count;
     }
@@ -0,0 +1,369 @@
+/**
+ * @file overwrite_ringbuffer.hpp
+ *
+ * Definition of lossy single-producer/single-consumer ringbuffer
+ * which overwrites the oldest unread elements when it is full.
+ * Slots are protected by per-slot sequence numbers (seqlock),
+ * so the consumer never returns an element torn by the producer.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _OVERWRITE_RINGBUFFER_HPP_
+#define _OVERWRITE_RINGBUFFER_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <bitset>
+#include <type_traits>
+
+#include <cassert>
+#include <cstring>
+#include <climits>
+
+#if defined(DEBUG_RINGBUFFER)
+#include <iostream>
+#endif
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "ringbuffer_base.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Ringbuffer which keeps the freshest data. The producer never blocks
+ * nor drops anything (write policy is ignored), it overwrites the oldest
+ * unread elements instead. Elements lost this way are counted as evicted
+ * (by the consumer, when it finds out it has been lapped).
+ *
+ * Elements are copied in and out as raw memory, thus T has to be
+ * trivially copyable. Capacity is always rounded up to the nearest power of two.
+ */
+template<typename T>
+class overwrite_ringbuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>, "overwrite_ringbuffer requires trivially copyable elements");
+
+public:
+    typedef T value_type;
+
+    explicit overwrite_ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags) :
+        m_capacity{(capacity > 1) ? (std::size_t{1} << ilog2_roundup(capacity)) : 1},
+        m_mask{m_capacity - 1},
+        m_flags{flags},
+        m_slots{nullptr},
+        m_producer{},
+        m_consumer{},
+        m_reading_semaphore{false, RINGBUFFER_SPIN_COUNT, false, true},
+        m_is_reading_cancelled{false}
+    {
+        assert(capacity > 0);
+        assert(m_capacity < LONG_MAX);
+
+        m_slots = new slot[m_capacity];
+        for (std::size_t i = 0; i < m_capacity; ++i)
+            m_slots[i].m_sequence.store(0U, std::memory_order_relaxed);
+
+        m_producer.m_produced.store(0U, std::memory_order_relaxed);
+        m_consumer.m_consumed.store(0U, std::memory_order_relaxed);
+        m_consumer.m_evicted.store(0U, std::memory_order_relaxed);
+
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+        std::cout << to_string() << std::endl;
+#endif
+    }
+
+    ~overwrite_ringbuffer()
+    {
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+#endif
+
+        delete [] m_slots;
+    }
+
+    overwrite_ringbuffer(const overwrite_ringbuffer&) = delete;
+    overwrite_ringbuffer(overwrite_ringbuffer&&) = delete;
+    overwrite_ringbuffer& operator = (const overwrite_ringbuffer&) = delete;
+    overwrite_ringbuffer& operator = (overwrite_ringbuffer&&) = delete;
+
+    std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags() const
+    {
+        return m_flags;
+    }
+
+    /* 'dropped' is always 0, as nothing is rejected by the producer.
+    'consumed' is the consumer's position, so it includes 'evicted'
+    and the number of elements actually delivered is 'consumed' - 'evicted'. */
+    ringbuffer_status get_counters(std::size_t* produced, std::size_t* consumed, std::size_t* dropped,
+                                   std::size_t* evicted = nullptr) const
+    {
+        std::size_t l_consumed = m_consumer.m_consumed.load(std::memory_order_acquire);
+        std::size_t l_produced = m_producer.m_produced.load(std::memory_order_acquire);
+
+        if (l_produced < l_consumed)
+            return ringbuffer_status::INTERNAL_ERROR;
+
+        if (produced) *produced = l_produced;
+        if (consumed) *consumed = l_consumed;
+        if (dropped) *dropped = 0;
+
+        if (evicted)
+            *evicted = m_consumer.m_evicted.load(std::memory_order_relaxed);
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Only a blocking consumer can be cancelled, the producer never waits. */
+    void cancel(ringbuffer_role role)
+    {
+        if (role == ringbuffer_role::CONSUMER) {
+            if (!m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT)) {
+                m_is_reading_cancelled = true;
+                m_reading_semaphore.post();
+            }
+        }
+        else {
+            /* do noting */
+        }
+    }
+
+    long write(const T& data)
+    {
+        return write(&data, 1);
+    }
+
+    template<std::size_t N>
+    long write(const T (&data)[N])
+    {
+        return write(data, N);
+    }
+
+    /**
+     * Writes all 'count' elements (only the last 'capacity' of them
+     * survive if 'count' exceeds capacity of the ringbuffer).
+     *
+     * @return number of written elements.
+     */
+    long write(const T* data, std::size_t count)
+    {
+        std::size_t produced = m_producer.m_produced.load(std::memory_order_relaxed);
+
+        if (0 == count)
+            return 0;
+
+        for (std::size_t i = 0; i < count; ++i, ++produced) {
+            slot& s = m_slots[produced & m_mask];
+
+            /* odd sequence marks the slot as being written */
+            s.m_sequence.store(2 * produced + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&s.m_data, data + i, sizeof(T));
+            s.m_sequence.store(2 * produced + 2, std::memory_order_release);
+        }
+
+        m_producer.m_produced.store(produced, std::memory_order_release);
+
+        if (!m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+            m_reading_semaphore.post(); /* wake up the consumer waiting for new data (if any) */
+
+        return count;
+    }
+
+    long read(T& data)
+    {
+        return read(&data, 1);
+    }
+
+    template<std::size_t N>
+    long read(T (&data)[N])
+    {
+        return read(data, N);
+    }
+
+    /**
+     * Reads up to 'count' of the oldest elements which are still there.
+     *
+     * @return number of read elements or negative ringbuffer_status on error.
+     */
+    long read(T* data, std::size_t count)
+    {
+        std::size_t consumed = m_consumer.m_consumed.load(std::memory_order_relaxed);
+        std::size_t evicted = 0;
+        std::size_t read = 0;
+
+        if (0 == count)
+            return 0;
+
+        while (read < count) {
+            std::size_t produced = m_producer.m_produced.load(std::memory_order_acquire);
+
+            if (produced == consumed) {
+                if (read > 0)
+                    break;
+
+                if (m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+                    return static_cast<long>(ringbuffer_status::WOULD_BLOCK);
+
+                m_reading_semaphore.wait(); /* let's wait until producer will write some data */
+                if (m_is_reading_cancelled) {
+                    m_is_reading_cancelled = false;
+                    return static_cast<long>(ringbuffer_status::OPERATION_CANCELLED);
+                }
+                continue;
+            }
+
+            if ((produced - consumed) > m_capacity) {
+                /* we have been lapped, skip straight to the oldest element still there */
+                evicted += produced - m_capacity - consumed;
+                consumed = produced - m_capacity;
+            }
+
+            if (read_slot(consumed, data + read))
+                read++;
+            else
+                evicted++; /* overwritten while (or before) it was being copied out */
+
+            consumed++;
+        }
+
+        if (evicted > 0)
+            m_consumer.m_evicted.store(m_consumer.m_evicted.load(std::memory_order_relaxed) + evicted, std::memory_order_relaxed);
+
+        m_consumer.m_consumed.store(consumed, std::memory_order_release);
+
+        return read;
+    }
+
+    std::string to_string() const
+    {
+        std::ostringstream stream;
+
+        stream << "overwrite_ringbuffer@";
+        stream << std::hex << this;
+        stream << " [capacity: ";
+        stream << std::dec << m_capacity;
+        stream << ", ";
+        stream << "write policy: overwrite";
+        stream << ", ";
+        stream << "read policy: ";
+        stream << (m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT) ? "non_blocking" : "blocking");
+        stream << " [";
+        stream << "produced: ";
+        stream << std::dec << m_producer.m_produced.load(std::memory_order_relaxed);
+        stream << ", ";
+        stream << "consumed: ";
+        stream << std::dec << m_consumer.m_consumed.load(std::memory_order_relaxed);
+        stream << ", ";
+        stream << "evicted: ";
+        stream << std::dec << m_consumer.m_evicted.load(std::memory_order_relaxed);
+        stream << "]]";
+
+        return stream.str();
+    }
+
+    operator std::string () const
+    {
+        return to_string();
+    }
+
+private:
+    /* Element 'n' is stable in its slot when the sequence equals 2n + 2. */
+    struct slot
+    {
+        std::atomic<std::size_t> m_sequence;
+        T m_data;
+    };
+
+    /* Copies element 'counter' out and validates (seqlock style)
+    that the producer has not touched the slot in the meantime. */
+    bool read_slot(std::size_t counter, T* dst) const
+    {
+        const slot& s = m_slots[counter & m_mask];
+        std::size_t sequence = s.m_sequence.load(std::memory_order_acquire);
+
+        if (sequence != (2 * counter + 2))
+            return false;
+
+        std::memcpy(dst, &s.m_data, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return s.m_sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    const std::size_t m_capacity;
+    const std::size_t m_mask;
+    const std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> m_flags;
+    slot* m_slots;
+
+    struct alignas(CACHELINE_SIZE)
+    {
+        std::atomic<std::size_t> m_produced;
+    } m_producer;
+
+    struct alignas(CACHELINE_SIZE)
+    {
+        std::atomic<std::size_t> m_consumed;
+        std::atomic<std::size_t> m_evicted;
+    } m_consumer;
+
+    alignas(CACHELINE_SIZE) futex_binary_semaphore m_reading_semaphore;
+    std::atomic<bool> m_is_reading_cancelled;
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _OVERWRITE_RINGBUFFER_HPP_ */
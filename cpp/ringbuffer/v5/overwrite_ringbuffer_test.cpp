@@ -0,0 +1,233 @@
+/**
+ * @file overwrite_ringbuffer_test.cpp
+ *
+ * Test procedures for 'overwrite_ringbuffer' implementation.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "overwrite_ringbuffer.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 1000000
+
+#define TEST_LOSSY(CAPACITY, N, FLAGS, NAME)                                                 \
+TEST(overwrite_ringbuffer, lossy_capacity_##CAPACITY##_batch_##N##_##NAME)                   \
+{                                                                                            \
+    lts::overwrite_ringbuffer<sample> rb(CAPACITY, FLAGS);                                   \
+                                                                                             \
+    std::thread producer {sample_producer<N>, std::ref(rb)};                                 \
+    std::thread consumer {sample_consumer<N>, std::ref(rb)};                                 \
+                                                                                             \
+    producer.join();                                                                         \
+    consumer.join();                                                                         \
+                                                                                             \
+    std::cout << static_cast<std::string>(rb) << std::endl;                                  \
+}
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+/* All words of a sample carry the same value, so a torn one is easy to spot. */
+struct sample
+{
+    std::size_t m_words[16];
+};
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+template<std::size_t N> static void sample_producer(lts::overwrite_ringbuffer<sample>& rb);
+template<std::size_t N> static void sample_consumer(lts::overwrite_ringbuffer<sample>& rb);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(overwrite_ringbuffer, create)
+{
+    const std::size_t capacities[][2] = {{1, 1}, {2, 2}, {5, 8}, {1000, 1024}};
+
+    for (const auto& c : capacities) {
+        lts::overwrite_ringbuffer<std::size_t> rb(c[0], RINGBUFFER_RD_BLOCKING_WR_NONBLOCKING);
+        EXPECT_EQ(c[1], rb.capacity());
+        EXPECT_EQ(RINGBUFFER_RD_BLOCKING_WR_NONBLOCKING, rb.flags());
+        std::cout << static_cast<std::string>(rb) << std::endl;
+    }
+}
+
+TEST(overwrite_ringbuffer, evicts_oldest)
+{
+    lts::overwrite_ringbuffer<std::size_t> rb(4, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    std::size_t in[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    std::size_t out[10] = {};
+    std::size_t produced, consumed, dropped, evicted;
+
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.read(out[0]));
+
+    /* a full ringbuffer never rejects new elements */
+    EXPECT_EQ(10, rb.write(in));
+    EXPECT_EQ(4, rb.read(out));
+    for (std::size_t i = 0; i < 4; ++i)
+        EXPECT_EQ(6 + i, out[i]);
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.read(out[0]));
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped, &evicted));
+    EXPECT_EQ(10U, produced);
+    EXPECT_EQ(10U, consumed);
+    EXPECT_EQ(0U, dropped);
+    EXPECT_EQ(6U, evicted);
+
+    /* partially lapped consumer */
+    EXPECT_EQ(2, rb.write(in, 2));
+    EXPECT_EQ(1, rb.read(out[0]));
+    EXPECT_EQ(0U, out[0]);
+    EXPECT_EQ(5, rb.write(in + 2, 5));
+    EXPECT_EQ(4, rb.read(out));
+    for (std::size_t i = 0; i < 4; ++i)
+        EXPECT_EQ(3 + i, out[i]);
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped, &evicted));
+    EXPECT_EQ(17U, produced);
+    EXPECT_EQ(17U, consumed);
+    EXPECT_EQ(8U, evicted);
+
+    /* delivered: 4 + 1 + 4 */
+    EXPECT_EQ(9U, consumed - evicted);
+}
+
+TEST(overwrite_ringbuffer, cancel)
+{
+    lts::overwrite_ringbuffer<std::size_t> rb(1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+
+    std::thread consumer {[&rb]() {
+        std::size_t value;
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED), rb.read(value));
+    }};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    rb.cancel(lts::ringbuffer_role::CONSUMER);
+    consumer.join();
+}
+
+TEST_LOSSY(   1,  1, RINGBUFFER_RD_BLOCKING_WR_NONBLOCKING, blocking)
+TEST_LOSSY(  64,  7, RINGBUFFER_RD_BLOCKING_WR_NONBLOCKING, blocking)
+TEST_LOSSY(   1,  1, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+TEST_LOSSY(  64,  7, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+TEST_LOSSY(1024, 16, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+template<std::size_t N>
+static void sample_producer(lts::overwrite_ringbuffer<sample>& rb)
+{
+    sample array[N];
+
+    for (std::size_t produced = 0; produced < ITERATIONS;) {
+        std::size_t count = std::min<std::size_t>(N, ITERATIONS - produced);
+        for (std::size_t i = 0; i < count; ++i)
+            for (auto& word : array[i].m_words)
+                word = produced + i;
+        ASSERT_EQ(static_cast<long>(count), rb.write(array, count));
+        produced += count;
+    }
+}
+
+/* The newest element is never evicted, so the consumer always gets the last one. */
+template<std::size_t N>
+static void sample_consumer(lts::overwrite_ringbuffer<sample>& rb)
+{
+    sample array[N];
+    std::size_t received = 0;
+    std::size_t last = 0;
+    std::size_t produced = 0, consumed = 0, dropped = 0, evicted = 0;
+    long status;
+
+    for (;;) {
+        status = rb.read(array);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_GT(status, 0);
+        for (long i = 0; i < status; ++i) {
+            for (auto word : array[i].m_words)
+                ASSERT_EQ(array[i].m_words[0], word);
+            if (received > 0) {
+                ASSERT_GT(array[i].m_words[0], last);
+            }
+            last = array[i].m_words[0];
+            received++;
+        }
+        if ((ITERATIONS - 1) == last)
+            break;
+    }
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped, &evicted));
+    EXPECT_EQ(static_cast<std::size_t>(ITERATIONS), produced);
+    EXPECT_EQ(static_cast<std::size_t>(ITERATIONS), consumed);
+    EXPECT_EQ(static_cast<std::size_t>(ITERATIONS), received + evicted);
+    EXPECT_EQ(0U, dropped);
+}
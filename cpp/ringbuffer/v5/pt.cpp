@@ -19,11 +19,14 @@
  * system header files
 \*===========================================================================*/
 #include <iostream>
+#include <iomanip>
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include <vector>
 
 #include <cstdlib>
+#include <cstdint>
 
 extern "C" {
     #include <unistd.h>
@@ -36,6 +39,7 @@ extern "C" {
 #include "../../utils/strtointeger.hpp"
 
 #include "ringbuffer.hpp"
+#include "mpmc_ringbuffer.hpp"
 
 /*===========================================================================*\
  * 'using namespace' section
@@ -61,8 +65,17 @@ namespace
 /*===========================================================================*\
  * local function declarations
 \*===========================================================================*/
+template<typename T> static bool run_test(std::size_t batch, std::size_t capacity, bool non_blocking,
+                                          lts::ringbuffer_capacity_policy policy, unsigned int spin, bool reserve, std::size_t iterations);
+template<typename T, std::size_t N> static void run_test(std::size_t capacity, bool non_blocking,
+                                                         lts::ringbuffer_capacity_policy policy, unsigned int spin, bool reserve,
+                                                         std::size_t iterations);
+static void run_mpmc_test(std::size_t capacity, bool non_blocking,
+                          std::size_t producers, std::size_t consumers, std::size_t iterations);
 template<typename RB, std::size_t N> static void producer_function(RB& rb, std::size_t iterations);
 template<typename RB, std::size_t N> static void consumer_function(RB& rb, std::size_t iterations);
+template<typename RB, std::size_t N> static void producer_reserve(RB& rb, std::size_t iterations);
+template<typename RB, std::size_t N> static void consumer_peek(RB& rb, std::size_t iterations);
 
 /*===========================================================================*\
  * local object definitions
@@ -74,13 +87,30 @@ static std::mutex mutex;
 \*===========================================================================*/
 static inline void pt_usage(const char* progname)
 {
-    std::cerr << "usage: " << progname << " -c capacity [-n]" << std::endl;
+    std::cerr << "usage: " << progname << " -c capacity [-n] [-p] [-b batch] [-8] [-s spin] [-r] [-m [-P producers] [-C consumers]] [-i iterations]" << std::endl;
     std::cerr << " options: " << std::endl;
     std::cerr << "  -c capacity --capacity=capacity : sets capacity (max number of elements) of a ringbuffer" << std::endl;
     std::cerr << std::endl;
     std::cerr << "  -n --non-blocking               : switches ringbuffer to non-blocking semantics" << std::endl;
     std::cerr << "                                  : (by default it is blocking)" << std::endl;
     std::cerr << std::endl;
+    std::cerr << "  -p --power-of-two               : rounds capacity up to the nearest power of two" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -b batch --batch=batch          : number of elements transferred by each read/write" << std::endl;
+    std::cerr << "                                  : (one of 1, 16, 256, 1316; default: 1)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -8 --bytes                      : uses uint8_t elements instead of std::size_t ones" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -r --reserve                    : transfers elements in place with reserve()/commit()" << std::endl;
+    std::cerr << "                                  : and peek()/release() instead of write()/read()" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -s spin --spin=spin             : number of spins before a blocked thread is parked" << std::endl;
+    std::cerr << "                                  : (default: " << RINGBUFFER_SPIN_COUNT << ")" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -m --mpmc                       : uses mpmc_ringbuffer (single element transfers)" << std::endl;
+    std::cerr << "  -P producers --producers=n      : number of producer threads (default: 1, requires -m)" << std::endl;
+    std::cerr << "  -C consumers --consumers=n      : number of consumer threads (default: 1, requires -m)" << std::endl;
+    std::cerr << std::endl;
     std::cerr << "  -i --iterations                 : number of iteration (default: " << ITERATIONS << ")" << std::endl;
 }
 
@@ -92,16 +122,33 @@ int main(int argc, char *argv[])
     bool status;
     std::size_t capacity = 0;
     bool non_blocking = false;
+    lts::ringbuffer_capacity_policy policy = lts::ringbuffer_capacity_policy::EXACT;
+    std::size_t batch = 1;
+    bool bytes = false;
+    unsigned int spin = RINGBUFFER_SPIN_COUNT;
+    bool reserve = false;
+    bool mpmc = false;
+    std::size_t producers = 1;
+    std::size_t consumers = 1;
     std::size_t iterations = ITERATIONS;
 
     static struct option long_options[] = {
         {"capacity",     required_argument, 0, 'c'},
         {"non-blocking", no_argument,       0, 'n'},
+        {"power-of-two", no_argument,       0, 'p'},
+        {"batch",        required_argument, 0, 'b'},
+        {"bytes",        no_argument,       0, '8'},
+        {"spin",         required_argument, 0, 's'},
+        {"reserve",      no_argument,       0, 'r'},
+        {"mpmc",         no_argument,       0, 'm'},
+        {"producers",    required_argument, 0, 'P'},
+        {"consumers",    required_argument, 0, 'C'},
+        {"iterations",   required_argument, 0, 'i'},
         {0,              0,                 0,  0 }
     };
 
     for (;;) {
-        int c = getopt_long(argc, argv, "c:ni:", long_options, 0);
+        int c = getopt_long(argc, argv, "c:npb:8s:rmP:C:i:", long_options, 0);
         if (-1 == c)
             break;
 
@@ -119,6 +166,58 @@ int main(int argc, char *argv[])
                 non_blocking = true;
                 break;
 
+            case 'p':
+                policy = lts::ringbuffer_capacity_policy::POWER_OF_TWO;
+                break;
+
+            case 'b':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, batch));
+                if (!status) {
+                    std::cerr << "error: cannot convert '" << optarg << "' to integer" << std::endl;
+                    pt_usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
+            case '8':
+                bytes = true;
+                break;
+
+            case 'r':
+                reserve = true;
+                break;
+
+            case 's':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, spin));
+                if (!status) {
+                    std::cerr << "error: cannot convert '" << optarg << "' to integer" << std::endl;
+                    pt_usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
+            case 'm':
+                mpmc = true;
+                break;
+
+            case 'P':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, producers));
+                if (!status || (0 == producers)) {
+                    std::cerr << "error: cannot convert '" << optarg << "' to positive integer" << std::endl;
+                    pt_usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
+            case 'C':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, consumers));
+                if (!status || (0 == consumers)) {
+                    std::cerr << "error: cannot convert '" << optarg << "' to positive integer" << std::endl;
+                    pt_usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
             case 'i':
                 status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, iterations));
                 if (!status) {
@@ -141,16 +240,80 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    if (mpmc) {
+        run_mpmc_test(capacity, non_blocking, producers, consumers, iterations);
+        return 0;
+    }
+
+    status = bytes ?
+        run_test<uint8_t>(batch, capacity, non_blocking, policy, spin, reserve, iterations) :
+        run_test<std::size_t>(batch, capacity, non_blocking, policy, spin, reserve, iterations);
+    if (!status) {
+        std::cerr << "error: unsupported batch size " << batch << std::endl;
+        pt_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+template<typename T>
+static bool run_test(std::size_t batch, std::size_t capacity, bool non_blocking,
+                     lts::ringbuffer_capacity_policy policy, unsigned int spin, bool reserve, std::size_t iterations)
+{
+    switch (batch) {
+        case 1:
+            run_test<T, 1>(capacity, non_blocking, policy, spin, reserve, iterations);
+            break;
+
+        case 16:
+            run_test<T, 16>(capacity, non_blocking, policy, spin, reserve, iterations);
+            break;
+
+        case 256:
+            run_test<T, 256>(capacity, non_blocking, policy, spin, reserve, iterations);
+            break;
+
+        case 1316: /* 7 mpeg2ts packets */
+            run_test<T, 1316>(capacity, non_blocking, policy, spin, reserve, iterations);
+            break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+template<typename T, std::size_t N>
+static void run_test(std::size_t capacity, bool non_blocking,
+                     lts::ringbuffer_capacity_policy policy, unsigned int spin, bool reserve, std::size_t iterations)
+{
     std::chrono::time_point<std::chrono::high_resolution_clock> t1, t2;
 
-    std::cout << "test started ..." << std::endl;
+    std::cout << "test started (element size: " << sizeof(T) << ", batch: " << N;
+    std::cout << (reserve ? ", reserve/commit" : "") << ") ..." << std::endl;
 
     t1 = std::chrono::high_resolution_clock::now();
 
-    lts::ringbuffer<std::size_t> rb(capacity, non_blocking);
+    lts::ringbuffer<T> rb(capacity, non_blocking, policy);
+    rb.set_spin_count(lts::ringbuffer_role::NONE, spin);
 
-    std::thread producer {producer_function<decltype(rb), 1>, std::ref(rb), iterations};
-    std::thread consumer {consumer_function<decltype(rb), 1>, std::ref(rb), iterations};
+    std::thread producer {reserve ? producer_reserve<decltype(rb), N> : producer_function<decltype(rb), N>,
+                          std::ref(rb), iterations};
+    std::thread consumer {reserve ? consumer_peek<decltype(rb), N> : consumer_function<decltype(rb), N>,
+                          std::ref(rb), iterations};
 
     producer.join();
     consumer.join();
@@ -161,22 +324,83 @@ int main(int argc, char *argv[])
     uint64_t duration = static_cast<uint64_t>(
         std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count());
 
-    std::cout << "test took " << duration << "ms" << std::endl;
+    const double seconds = std::chrono::duration<double>(t2 - t1).count();
 
-    return 0;
+    std::cout << "test took " << duration << "ms" << std::endl;
+    if (seconds > 0) {
+        std::cout << std::fixed << std::setprecision(0);
+        std::cout << "throughput: " << static_cast<double>(iterations) / seconds << " elements/s";
+        std::cout << std::setprecision(1);
+        std::cout << " (" << static_cast<double>(iterations * sizeof(T)) / seconds / 1e6 << " MB/s)" << std::endl;
+        std::cout << std::defaultfloat;
+    }
 }
 
-/*===========================================================================*\
- * protected function definitions
-\*===========================================================================*/
+static void run_mpmc_test(std::size_t capacity, bool non_blocking,
+                          std::size_t producers, std::size_t consumers, std::size_t iterations)
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> t1, t2;
+    std::vector<std::thread> threads;
 
-/*===========================================================================*\
- * private function definitions
-\*===========================================================================*/
+    iterations -= iterations % producers; /* every producer writes the same number of elements */
+
+    std::cout << "test started (producers: " << producers << ", consumers: " << consumers << ") ..." << std::endl;
+
+    t1 = std::chrono::high_resolution_clock::now();
+
+    lts::mpmc_ringbuffer<std::size_t> rb(capacity, non_blocking);
+
+    for (std::size_t p = 0; p < producers; ++p)
+        threads.emplace_back(producer_function<decltype(rb), 1>, std::ref(rb), iterations / producers);
+
+    for (std::size_t c = 0; c < consumers; ++c)
+        threads.emplace_back([&rb](std::size_t quota) {
+            long status;
+            std::size_t consumed = 0;
+            std::size_t wouldblock_cnt = 0;
+            std::size_t value;
+
+            while (consumed < quota) {
+                status = rb.read(value);
+                if (status < 0) {
+                    if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                        wouldblock_cnt++;
+                        continue;
+                    }
+                    else {
+                        std::cout << "rb.read() failed with code " << status << std::endl;
+                        break;
+                    }
+                }
+                consumed += status;
+            }
+            mutex.lock();
+            std::cout << "quota: " << quota;
+            std::cout << " consumed: " << consumed;
+            std::cout << " wouldblock_cnt: " << wouldblock_cnt;
+            std::cout << std::endl;
+            mutex.unlock();
+        }, iterations / consumers + ((c < iterations % consumers) ? 1 : 0));
+
+    for (auto& t : threads)
+        t.join();
+
+    std::cout << static_cast<std::string>(rb) << std::endl;
+
+    t2 = std::chrono::high_resolution_clock::now();
+    uint64_t duration = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count());
+
+    const double seconds = std::chrono::duration<double>(t2 - t1).count();
+
+    std::cout << "test took " << duration << "ms" << std::endl;
+    if (seconds > 0) {
+        std::cout << std::fixed << std::setprecision(0);
+        std::cout << "throughput: " << static_cast<double>(iterations) / seconds << " elements/s" << std::endl;
+        std::cout << std::defaultfloat;
+    }
+}
 
-/*===========================================================================*\
- * local function definitions
-\*===========================================================================*/
 template<typename RB, std::size_t N>
 static void producer_function(RB& rb, std::size_t iterations)
 {
@@ -236,7 +460,7 @@ static void consumer_function(RB& rb, std::size_t iterations)
             }
         }
         for (long i = 0; i < status; ++i) {
-            if (array[i] != consumed + i) {
+            if (array[i] != static_cast<typename RB::value_type>(consumed + i)) {
                 std::cout << "error in order of elements in the array" << std::endl;
                 break;
             }
@@ -251,3 +475,90 @@ static void consumer_function(RB& rb, std::size_t iterations)
     mutex.unlock();
 }
 
+/* Elements are generated directly in the ringbuffer storage
+and up to N of them are published with a single commit(). */
+template<typename RB, std::size_t N>
+static void producer_reserve(RB& rb, std::size_t iterations)
+{
+    long status;
+    std::size_t produced;
+    std::size_t wouldblock_cnt;
+    lts::ringbuffer_span<typename RB::value_type> span;
+
+    produced = 0;
+    wouldblock_cnt = 0;
+    while (produced < iterations) {
+        status = rb.reserve(N, &span);
+        if (status < 0) {
+            if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                wouldblock_cnt++;
+                continue;
+            }
+            else {
+                std::cout << "rb.reserve() failed with code " << status << std::endl;
+                break;
+            }
+        }
+        for (std::size_t j = 0; j < span.m_first_count; ++j)
+            span.m_first[j] = produced + j;
+        for (std::size_t j = 0; j < span.m_second_count; ++j)
+            span.m_second[j] = produced + span.m_first_count + j;
+        status = rb.commit(span.size());
+        if (status < 0) {
+            std::cout << "rb.commit() failed with code " << status << std::endl;
+            break;
+        }
+        produced += status;
+    }
+    mutex.lock();
+    std::cout << "iterations: " << iterations;
+    std::cout << " produced: " << produced;
+    std::cout << " wouldblock_cnt: " << wouldblock_cnt;
+    std::cout << std::endl;
+    mutex.unlock();
+}
+
+/* Elements are verified directly in the ringbuffer storage
+and up to N of them are released with a single release(). */
+template<typename RB, std::size_t N>
+static void consumer_peek(RB& rb, std::size_t iterations)
+{
+    long status;
+    std::size_t consumed;
+    std::size_t wouldblock_cnt;
+    lts::ringbuffer_span<typename RB::value_type> span;
+
+    consumed = 0;
+    wouldblock_cnt = 0;
+    while (consumed < iterations) {
+        status = rb.peek(N, &span);
+        if (status < 0) {
+            if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                wouldblock_cnt++;
+                continue;
+            }
+            else {
+                std::cout << "rb.peek() failed with code " << status << std::endl;
+                break;
+            }
+        }
+        for (std::size_t i = 0; i < span.size(); ++i) {
+            if (span[i] != static_cast<typename RB::value_type>(consumed + i)) {
+                std::cout << "error in order of elements in the span" << std::endl;
+                break;
+            }
+        }
+        status = rb.release(span.size());
+        if (status < 0) {
+            std::cout << "rb.release() failed with code " << status << std::endl;
+            break;
+        }
+        consumed += status;
+    }
+    mutex.lock();
+    std::cout << "iterations: " << iterations;
+    std::cout << " consumed: " << consumed;
+    std::cout << " wouldblock_cnt: " << wouldblock_cnt;
+    std::cout << std::endl;
+    mutex.unlock();
+}
@@ -0,0 +1,452 @@
+/**
+ * @file record_ringbuffer.hpp
+ *
+ * Definition of single-producer/single-consumer ringbuffer
+ * of variable length records (messages) stored inline, each one
+ * preceded by its length. Every record is contiguous in memory,
+ * a record which would straddle the wrap point is preceded by a padding record.
+ * Its non-blocking path is completely lockless.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _RECORD_RINGBUFFER_HPP_
+#define _RECORD_RINGBUFFER_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <bitset>
+#include <algorithm>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#if defined(DEBUG_RINGBUFFER)
+#include <iostream>
+#endif
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "ringbuffer_base.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Byte ringbuffer transferring whole records, so messages of any size
+ * can be queued without allocating a buffer per message.
+ *
+ * Capacity (in bytes) is rounded up to a power of two (not less than 64).
+ * Each record takes an 8 byte header plus its payload rounded up to 8 bytes,
+ * so payloads are 8 byte aligned. A single record may take at most
+ * half of the capacity, which guarantees that a record preceded by
+ * a padding record always fits once the ringbuffer drains.
+ */
+class record_ringbuffer : public ringbuffer_base<std::uint8_t>
+{
+public:
+    typedef std::uint8_t value_type;
+
+    explicit record_ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags) :
+        ringbuffer_base<std::uint8_t>::ringbuffer_base{
+            (capacity > MIN_CAPACITY) ? (std::size_t{1} << ilog2_roundup(capacity)) : MIN_CAPACITY, flags,
+            ringbuffer_capacity_policy::EXACT, ringbuffer_storage<std::uint8_t>{allocate, deallocate}},
+        m_records{}
+    {
+        assert(capacity > 0);
+
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+        std::cout << to_string() << std::endl;
+#endif
+    }
+
+    ~record_ringbuffer() override
+    {
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+#endif
+    }
+
+    /* Max length of a single record's payload. */
+    std::size_t max_record_size() const
+    {
+        return std::min<std::size_t>(m_capacity / 2 - sizeof(header), UINT32_MAX);
+    }
+
+    /**
+     * Writes a single record of 'length' bytes with a single memcpy().
+     * Refused while a reservation is pending.
+     *
+     * @return 'length' or negative ringbuffer_status on error.
+     */
+    long write(const void* data, std::size_t length)
+    {
+        std::uint8_t* dst = nullptr;
+        long status;
+
+        if (m_counters.m_producer.m_reserved > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        status = reserve(length, &dst, true);
+
+        if (status > 0) {
+            std::memcpy(dst, data, length);
+            status = commit(length);
+        }
+
+        return status;
+    }
+
+    /**
+     * Reads a single record into 'data' which can hold up to 'size' bytes.
+     * A record longer than that is left in the ringbuffer.
+     * Refused while a peek is pending.
+     *
+     * @return length of the record or negative ringbuffer_status on error.
+     */
+    long read(void* data, std::size_t size)
+    {
+        const std::uint8_t* src = nullptr;
+        long status;
+
+        if (m_counters.m_consumer.m_peeked > 0)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        status = peek(&src);
+
+        if (status >= 0) {
+            if (static_cast<std::size_t>(status) > size) {
+                m_counters.m_consumer.m_peeked = 0;
+                return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+            }
+            std::memcpy(data, src, status);
+            status = release();
+        }
+
+        return status;
+    }
+
+    /**
+     * Reserves room for a record of up to 'length' bytes (non-zero)
+     * as a single contiguous region. Nothing is visible to the consumer
+     * until commit() is called. Calling reserve() again before commit()
+     * replaces the previous reservation.
+     *
+     * Records are all or nothing, so unlike the other ringbuffers
+     * it never returns less than requested.
+     * A reservation refused for lack of room is not counted as dropped.
+     *
+     * @return 'length' or negative ringbuffer_status on error.
+     */
+    long reserve(std::size_t length, std::uint8_t** data)
+    {
+        return reserve(length, data, false);
+    }
+
+    /**
+     * Publishes the reserved record shrunk to 'length' bytes
+     * (0 gives the reservation back without publishing anything).
+     *
+     * @return 'length' or negative ringbuffer_status on error.
+     */
+    long commit(std::size_t length)
+    {
+        std::size_t produced;
+        std::size_t padding;
+
+        if ((0 == m_counters.m_producer.m_reserved) || (length > m_counters.m_producer.m_reserved))
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_producer.m_reserved = 0;
+
+        if (length > 0) {
+            produced = m_counters.m_producer.m_produced.load(std::memory_order_relaxed);
+            padding = m_records.m_producer.m_padding;
+
+            write_header(index(produced + padding), header{static_cast<std::uint32_t>(length), 0});
+
+            m_records.m_producer.m_produced.store(m_records.m_producer.m_produced.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            publish(produced, padding + record_size(length));
+        }
+
+        return length;
+    }
+
+    /**
+     * Gives access to the oldest record without consuming it.
+     * Its payload stays valid until release() is called.
+     *
+     * @return length of the record or negative ringbuffer_status on error.
+     */
+    long peek(const std::uint8_t** data)
+    {
+        std::size_t consumed;
+        std::size_t available;
+        std::size_t idx;
+        header h;
+        std::size_t skipped = 0;
+        ringbuffer_status rbs;
+
+        if (nullptr == data)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_consumer.m_peeked = 0;
+
+        /* records are published as a whole, so any published byte means a whole record */
+        rbs = acquire_available_elements(1, &consumed, &available);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        idx = index(consumed);
+        h = read_header(idx);
+
+        /* padding is always published together with the record following it */
+        if (h.m_flags & header::PADDING) {
+            skipped = sizeof(header) + h.m_length;
+            idx = 0;
+            h = read_header(idx);
+        }
+
+        *data = m_buffer + idx + sizeof(header);
+        m_counters.m_consumer.m_peeked = skipped + record_size(h.m_length);
+        m_records.m_consumer.m_length = h.m_length;
+
+        return h.m_length;
+    }
+
+    /**
+     * Consumes the peeked record.
+     *
+     * @return length of the record or negative ringbuffer_status on error.
+     */
+    long release()
+    {
+        std::size_t consumed;
+        std::size_t peeked = m_counters.m_consumer.m_peeked;
+
+        if (0 == peeked)
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_consumer.m_peeked = 0;
+
+        consumed = m_counters.m_consumer.m_consumed.load(std::memory_order_relaxed);
+        m_records.m_consumer.m_consumed.store(m_records.m_consumer.m_consumed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        retire(consumed, peeked);
+
+        return m_records.m_consumer.m_length;
+    }
+
+    /* All counters are expressed in records. */
+    ringbuffer_status get_counters(std::size_t* produced, std::size_t* consumed, std::size_t* dropped) const
+    {
+        if (produced) *produced = m_records.m_producer.m_produced.load(std::memory_order_relaxed);
+        if (consumed) *consumed = m_records.m_consumer.m_consumed.load(std::memory_order_relaxed);
+
+        if (dropped)
+            *dropped = m_counters.m_producer.m_dropped.load(std::memory_order_relaxed);
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Same as ringbuffer_base::reset(), record counters included. */
+    void reset(ringbuffer_role role) override
+    {
+        ringbuffer_base<std::uint8_t>::reset(role);
+
+        if (role == ringbuffer_role::PRODUCER) {
+            m_records.m_producer.m_produced.store(m_records.m_consumer.m_consumed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_records.m_producer.m_padding = 0U;
+        }
+        else
+        if (role == ringbuffer_role::CONSUMER) {
+            m_records.m_consumer.m_consumed.store(m_records.m_producer.m_produced.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            m_records.m_consumer.m_length = 0U;
+        }
+        else {
+            m_records.reset();
+        }
+    }
+
+    /* Counters of the base are expressed in bytes, records are appended. */
+    std::string to_string() const
+    {
+        std::ostringstream stream;
+
+        stream << ringbuffer_base<std::uint8_t>::to_string();
+        stream << " [records produced: ";
+        stream << std::dec << m_records.m_producer.m_produced.load(std::memory_order_relaxed);
+        stream << ", records consumed: ";
+        stream << std::dec << m_records.m_consumer.m_consumed.load(std::memory_order_relaxed);
+        stream << "]";
+
+        return stream.str();
+    }
+
+    operator std::string () const
+    {
+        return to_string();
+    }
+
+private:
+    static constexpr std::size_t MIN_CAPACITY = 64;
+
+    struct header
+    {
+        static constexpr std::uint32_t PADDING = 1U << 0; /* fills the storage up to the wrap point */
+
+        std::uint32_t m_length;
+        std::uint32_t m_flags;
+    };
+
+    static_assert(sizeof(header) == sizeof(std::uint64_t), "record header has to keep payloads 8 byte aligned");
+
+    long reserve(std::size_t length, std::uint8_t** data, bool count_dropped)
+    {
+        std::size_t produced;
+        std::size_t free_elements;
+        std::size_t idx;
+        std::size_t padding;
+        ringbuffer_status rbs;
+
+        if ((nullptr == data) || (0 == length) || (length > max_record_size()))
+            return static_cast<long>(ringbuffer_status::INVALID_ARGUMENT);
+
+        m_counters.m_producer.m_reserved = 0;
+
+        produced = m_counters.m_producer.m_produced.load(std::memory_order_relaxed);
+        idx = index(produced);
+        padding = ((m_capacity - idx) < record_size(length)) ? (m_capacity - idx) : 0;
+
+        /* room for the whole record (and its padding) or nothing */
+        rbs = acquire_free_elements(padding + record_size(length), &produced, &free_elements, count_dropped,
+                                    padding + record_size(length));
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (padding > 0) {
+            write_header(idx, header{static_cast<std::uint32_t>(padding - sizeof(header)), header::PADDING});
+            idx = 0;
+        }
+
+        *data = m_buffer + idx + sizeof(header);
+        m_counters.m_producer.m_reserved = length;
+        m_records.m_producer.m_padding = padding;
+
+        return length;
+    }
+
+    /* Number of bytes taken by a record of 'length' bytes (header included). */
+    static std::size_t record_size(std::size_t length)
+    {
+        return sizeof(header) + ((length + sizeof(header) - 1) & ~(sizeof(header) - 1));
+    }
+
+    void write_header(std::size_t idx, const header& h)
+    {
+        std::memcpy(m_buffer + idx, &h, sizeof(h));
+    }
+
+    header read_header(std::size_t idx) const
+    {
+        header h;
+
+        std::memcpy(&h, m_buffer + idx, sizeof(h));
+
+        return h;
+    }
+
+    /* std::uint64_t gives the storage the alignment of record headers */
+    static std::uint8_t* allocate(std::size_t capacity)
+    {
+        return reinterpret_cast<std::uint8_t*>(new std::uint64_t[capacity / sizeof(std::uint64_t)]);
+    }
+
+    static void deallocate(std::uint8_t* buffer, std::size_t capacity)
+    {
+        UNUSED(capacity);
+        delete [] reinterpret_cast<std::uint64_t*>(buffer);
+    }
+
+    /* m_produced/m_consumed of the base count bytes, these count records. */
+    struct record_counters
+    {
+        explicit record_counters()
+        {
+            reset();
+        }
+
+        void reset()
+        {
+            m_producer.m_produced.store(0U, std::memory_order_relaxed);
+            m_producer.m_padding = 0U;
+            m_consumer.m_consumed.store(0U, std::memory_order_relaxed);
+            m_consumer.m_length = 0U;
+        }
+
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::size_t> m_produced;
+            std::size_t m_padding; /* padding preceding the pending reservation */
+        } m_producer;
+
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::size_t> m_consumed;
+            std::size_t m_length; /* payload length of the peeked record */
+        } m_consumer;
+    };
+
+    record_counters m_records;
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _RECORD_RINGBUFFER_HPP_ */
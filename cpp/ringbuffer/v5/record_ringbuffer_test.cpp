@@ -0,0 +1,261 @@
+/**
+ * @file record_ringbuffer_test.cpp
+ *
+ * Test procedures for 'record_ringbuffer' implementation.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "record_ringbuffer.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 100000
+#define MAX_RECORD_LENGTH 1024
+
+#define TEST_RECORDS(CAPACITY, FLAGS, NAME)                                                  \
+TEST(record_ringbuffer, records_capacity_##CAPACITY##_##NAME)                                \
+{                                                                                            \
+    lts::record_ringbuffer rb(CAPACITY, FLAGS);                                              \
+                                                                                             \
+    std::thread producer {record_producer, std::ref(rb)};                                    \
+    std::thread consumer {record_consumer, std::ref(rb)};                                    \
+                                                                                             \
+    producer.join();                                                                         \
+    consumer.join();                                                                         \
+                                                                                             \
+    std::cout << static_cast<std::string>(rb) << std::endl;                                  \
+}
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+static std::size_t record_length(std::uint32_t n, std::size_t max);
+static void record_producer(lts::record_ringbuffer& rb);
+static void record_consumer(lts::record_ringbuffer& rb);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(record_ringbuffer, create)
+{
+    const std::size_t capacities[][2] = {{1, 64}, {64, 64}, {65, 128}, {1000, 1024}};
+
+    for (const auto& c : capacities) {
+        lts::record_ringbuffer rb(c[0], RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+        EXPECT_EQ(c[1], rb.capacity());
+        EXPECT_EQ(c[1] / 2 - 8, rb.max_record_size());
+        EXPECT_EQ(RINGBUFFER_RD_BLOCKING_WR_BLOCKING, rb.flags());
+        std::cout << static_cast<std::string>(rb) << std::endl;
+    }
+}
+
+TEST(record_ringbuffer, padding_at_wrap_point)
+{
+    lts::record_ringbuffer rb(64, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    std::uint8_t* wr = nullptr;
+    const std::uint8_t* rd = nullptr;
+    std::uint8_t in[24], out[24];
+    std::size_t produced, consumed, dropped;
+
+    for (std::size_t i = 0; i < sizeof(in); ++i)
+        in[i] = static_cast<std::uint8_t>(i);
+
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.reserve(1, nullptr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.reserve(0, &wr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.reserve(25, &wr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.commit(1));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.release());
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.peek(&rd));
+
+    /* 24 + 8 and 17 + 8 (rounded up to 32) bytes */
+    EXPECT_EQ(24, rb.write(in, 24));
+    EXPECT_EQ(17, rb.write(in, 17));
+
+    /* refused reservation is not a drop, refused write is */
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.reserve(1, &wr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.write(in, 1));
+
+    /* a record longer than the given buffer stays in place */
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.read(out, 23));
+    EXPECT_EQ(24, rb.read(out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(in, out, 24));
+    EXPECT_EQ(17, rb.read(out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(in, out, 17));
+
+    /* 8 + 8 bytes, so only 16 bytes are left in front of the wrap point */
+    EXPECT_EQ(8, rb.write(in, 8));
+    EXPECT_EQ(8, rb.read(out, sizeof(out)));
+
+    /* 16 + 8 bytes do not fit there, so the record goes to the beginning */
+    EXPECT_EQ(20, rb.reserve(20, &wr));
+    EXPECT_EQ(0U, reinterpret_cast<std::uintptr_t>(wr) % 8);
+    memcpy(wr, in, 16);
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.write(in, 8));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.commit(21));
+    EXPECT_EQ(16, rb.commit(16));
+
+    /* the padding record is skipped transparently */
+    EXPECT_EQ(16, rb.peek(&rd));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.read(out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(in, rd, 16));
+    EXPECT_EQ(16, rb.release());
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.release());
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.peek(&rd));
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(4U, produced);
+    EXPECT_EQ(4U, consumed);
+    EXPECT_EQ(1U, dropped);
+
+    /* resetting takes the record counters along */
+    EXPECT_EQ(8, rb.write(in, 8));
+    rb.reset(lts::ringbuffer_role::CONSUMER);
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.peek(&rd));
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(5U, produced);
+    EXPECT_EQ(5U, consumed);
+    rb.reset(lts::ringbuffer_role::NONE);
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(0U, produced);
+    EXPECT_EQ(0U, consumed);
+    EXPECT_EQ(0U, dropped);
+}
+
+TEST(record_ringbuffer, cancel)
+{
+    lts::record_ringbuffer rb(64, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+
+    std::thread consumer {[&rb]() {
+        const std::uint8_t* rd = nullptr;
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED), rb.peek(&rd));
+    }};
+
+    rb.cancel(lts::ringbuffer_role::CONSUMER);
+    consumer.join();
+}
+
+TEST_RECORDS(  256, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_RECORDS(65536, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_RECORDS(  256, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+TEST_RECORDS(65536, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+/* Lengths vary from record to record, so they hit the wrap point at different offsets. */
+static std::size_t record_length(std::uint32_t n, std::size_t max)
+{
+    max = std::min<std::size_t>(max, MAX_RECORD_LENGTH);
+
+    return sizeof(n) + (n * 7919U) % (max - sizeof(n) + 1);
+}
+
+/* Each record is built in place and starts with its sequence number. */
+static void record_producer(lts::record_ringbuffer& rb)
+{
+    std::uint8_t* record = nullptr;
+    long status;
+
+    for (std::uint32_t n = 0; n < ITERATIONS;) {
+        std::size_t length = record_length(n, rb.max_record_size());
+        status = rb.reserve(length, &record);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(static_cast<long>(length), status);
+        memset(record, static_cast<int>(n & 0xff), length);
+        memcpy(record, &n, sizeof(n));
+        ASSERT_EQ(static_cast<long>(length), rb.commit(length));
+        n++;
+    }
+}
+
+static void record_consumer(lts::record_ringbuffer& rb)
+{
+    const std::uint8_t* record = nullptr;
+    std::uint32_t seq;
+    long mismatches;
+    long status;
+
+    for (std::uint32_t n = 0; n < ITERATIONS;) {
+        status = rb.peek(&record);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(static_cast<long>(record_length(n, rb.max_record_size())), status);
+        memcpy(&seq, record, sizeof(seq));
+        ASSERT_EQ(n, seq);
+        mismatches = 0;
+        for (long i = sizeof(seq); i < status; ++i)
+            mismatches += (record[i] != (n & 0xff));
+        ASSERT_EQ(0, mismatches);
+        ASSERT_EQ(status, rb.release());
+        n++;
+    }
+}
@@ -48,8 +48,9 @@ class ringbuffer : public iringbuffer<T>, public oringbuffer<T>
 public:
     typedef T value_type;
 
-    explicit ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags) :
-        ringbuffer_base<T>::ringbuffer_base{capacity, flags}
+    explicit ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags,
+                        ringbuffer_capacity_policy policy = ringbuffer_capacity_policy::EXACT) :
+        ringbuffer_base<T>::ringbuffer_base{capacity, flags, policy}
     {
 #if defined(DEBUG_RINGBUFFER)
         std::cout << __PRETTY_FUNCTION__ << std::endl;
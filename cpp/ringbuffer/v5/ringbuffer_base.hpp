@@ -25,8 +25,8 @@
 #include <atomic>
 #include <string>
 #include <sstream>
-#include <functional>
 #include <bitset>
+#include <type_traits>
 
 #include <cassert>
 #include <cstring>
@@ -36,15 +36,42 @@
 #include <iostream>
 #endif
 
+#if defined(RINGBUFFER_INSTRUMENTATION)
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#endif
+
+extern "C" {
+    #include <unistd.h>
+    #include <sys/eventfd.h>
+    #include <sys/syscall.h>
+    #include <linux/membarrier.h>
+}
+
 #if !defined(CACHELINE_SIZE)
 #define CACHELINE_SIZE 64
 #endif
 
+/* upper bound of iterations a blocked reader/writer spins (adaptively) before it is parked */
+#if !defined(RINGBUFFER_SPIN_COUNT)
+#define RINGBUFFER_SPIN_COUNT 256
+#endif
+
+/* number of power of two buckets of the queue depth histogram
+(only with RINGBUFFER_INSTRUMENTATION defined) */
+#if !defined(RINGBUFFER_DEPTH_HISTOGRAM_SIZE)
+#define RINGBUFFER_DEPTH_HISTOGRAM_SIZE 32
+#endif
+
 /*===========================================================================*\
  * project header files
 \*===========================================================================*/
 #include "../../utils/utilities.hpp"
-#include "../../semaphores/binary/binary_semaphore.hpp"
+#include "../../utils/power_of_two.hpp"
+#include "../../utils/ilog2.hpp"
+#include "../../semaphores/binary/futex_binary_semaphore.hpp"
+#include "../../semaphores/waiter/waiter.hpp"
 
 /*===========================================================================*\
  * preprocessor #define constants and macros
@@ -85,6 +112,7 @@ enum class ringbuffer_status
     INTERNAL_ERROR = -1,
     WOULD_BLOCK = -2,
     OPERATION_CANCELLED = -3,
+    INVALID_ARGUMENT = -4,
 };
 
 enum class ringbuffer_role
@@ -100,14 +128,18 @@ enum class ringbuffer_xfer_semantic
     MOVE,
 };
 
-template<typename T>
-struct ringbuffer_functor
+enum class ringbuffer_capacity_policy
 {
-    ringbuffer_functor(std::function<bool(T*)> f) :
-        m_function{f}
-    {
-    }
+    EXACT,        /* capacity is taken as it is */
+    POWER_OF_TWO, /* capacity is rounded up to the nearest power of two */
+};
 
+/* Adapts any callable invocable as bool(T*) to the contract
+of the template write and read functions. It is passed by value
+but only refers to the callable, so no copy nor allocation is involved. */
+template<typename T, typename F>
+struct ringbuffer_functor
+{
     bool operator()(T* arg)
     {
         return m_function(arg);
@@ -120,28 +152,118 @@ struct ringbuffer_functor
         UNUSED(count);
     }
 
-    std::function<bool(T*)> m_function;
+    F& m_function;
+};
+
+/* At most two contiguous regions of the ringbuffer storage
+handed out by oringbuffer::reserve() and iringbuffer::peek(). */
+template<typename T>
+struct ringbuffer_span
+{
+    std::size_t size() const
+    {
+        return m_first_count + m_second_count;
+    }
+
+    T& operator[](std::size_t i) const
+    {
+        return (i < m_first_count) ? m_first[i] : m_second[i - m_first_count];
+    }
+
+    T* m_first = nullptr;
+    std::size_t m_first_count = 0;
+    T* m_second = nullptr;
+    std::size_t m_second_count = 0;
+};
+
+/* Allocates and releases the storage of a ringbuffer ('capacity' elements).
+Allocation may fail by returning nullptr, which makes the ringbuffer invalid. */
+template<typename T>
+struct ringbuffer_storage
+{
+    T* (*m_allocate)(std::size_t capacity);
+    void (*m_deallocate)(T* buffer, std::size_t capacity);
+};
+
+#if defined(RINGBUFFER_INSTRUMENTATION)
+/**
+ * Snapshot of the instrumentation of a single ringbuffer.
+ *
+ * m_depth_histogram[i] counts writes after which the ringbuffer held
+ * [2^i, 2^(i+1)) elements (the last bucket takes everything above).
+ * Queueing delay is measured only with RINGBUFFER_INSTRUMENTATION_DELAY defined.
+ */
+struct ringbuffer_statistics
+{
+    std::size_t m_high_water;
+    std::uint64_t m_depth_histogram[RINGBUFFER_DEPTH_HISTOGRAM_SIZE];
+    std::uint64_t m_writer_blocked_count;
+    std::uint64_t m_writer_blocked_ns;
+    std::uint64_t m_reader_blocked_count;
+    std::uint64_t m_reader_blocked_ns;
+    std::uint64_t m_delay_count;
+    std::uint64_t m_delay_total_ns;
+    std::uint64_t m_delay_max_ns;
+
+    std::string to_string() const
+    {
+        std::ostringstream stream;
+
+        stream << "[high water: " << m_high_water;
+        stream << ", depth histogram: {";
+        for (std::size_t i = 0, n = 0; i < RINGBUFFER_DEPTH_HISTOGRAM_SIZE; ++i)
+            if (m_depth_histogram[i] > 0)
+                stream << (n++ ? ", " : "") << (std::size_t{1} << i) << ": " << m_depth_histogram[i];
+        stream << "}";
+        stream << ", writer blocked: " << m_writer_blocked_count << " times/" << m_writer_blocked_ns << "ns";
+        stream << ", reader blocked: " << m_reader_blocked_count << " times/" << m_reader_blocked_ns << "ns";
+        stream << ", delay: " << m_delay_count << " elements";
+        stream << "/avg " << (m_delay_count ? m_delay_total_ns / m_delay_count : 0) << "ns";
+        stream << "/max " << m_delay_max_ns << "ns";
+        stream << "]";
+
+        return stream.str();
+    }
+
+    operator std::string () const
+    {
+        return to_string();
+    }
 };
+#endif
 
 template<typename T>
 class ringbuffer_base
 {
 protected:
     explicit ringbuffer_base(std::size_t capacity = 0,
-                             std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags = RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING) :
-        m_capacity{capacity},
+                             std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags = RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING,
+                             ringbuffer_capacity_policy policy = ringbuffer_capacity_policy::EXACT,
+                             ringbuffer_storage<T> storage = ringbuffer_storage<T>{heap_allocate, heap_deallocate}) :
+        m_capacity{policy == ringbuffer_capacity_policy::POWER_OF_TWO ? roundup_power_of_two(capacity) : capacity},
+        m_mask{is_power_of_two(m_capacity) ? m_capacity - 1 : 0},
         m_flags{flags},
         m_counters{},
+        m_storage{storage},
         m_buffer{nullptr},
-        m_writing_semaphore{true},
-        m_reading_semaphore{false},
+        m_writing_semaphore{true, RINGBUFFER_SPIN_COUNT, false, true},
+        m_reading_semaphore{false, RINGBUFFER_SPIN_COUNT, false, true},
         m_is_writing_cancelled{false},
-        m_is_reading_cancelled{false}
+        m_is_reading_cancelled{false},
+        m_readable_fd{-1},
+        m_writable_fd{-1},
+        m_readable_waiters{},
+        m_is_watched{!is_membarrier_supported()}
     {
-        assert(capacity > 0);
-        assert(capacity < LONG_MAX);
+        assert(m_capacity > 0);
+        assert(m_capacity < LONG_MAX);
 
-        m_buffer = new T[capacity];
+        m_buffer = m_storage.m_allocate(m_capacity);
+
+#if defined(RINGBUFFER_INSTRUMENTATION) && defined(RINGBUFFER_INSTRUMENTATION_DELAY)
+        if (m_buffer)
+            m_timestamps = new std::uint64_t[m_capacity];
+#endif
 
 #if defined(DEBUG_RINGBUFFER)
         std::cout << __PRETTY_FUNCTION__ << std::endl;
@@ -155,7 +277,18 @@ protected:
         std::cout << __PRETTY_FUNCTION__ << std::endl;
 #endif
 
-        delete [] m_buffer;
+        if (m_readable_fd >= 0)
+            close(m_readable_fd);
+
+        if (m_writable_fd >= 0)
+            close(m_writable_fd);
+
+#if defined(RINGBUFFER_INSTRUMENTATION) && defined(RINGBUFFER_INSTRUMENTATION_DELAY)
+        delete [] m_timestamps;
+#endif
+
+        if (m_buffer)
+            m_storage.m_deallocate(m_buffer, m_capacity);
     }
 
     ringbuffer_base(const ringbuffer_base&) = delete;
@@ -164,6 +297,12 @@ protected:
     ringbuffer_base& operator = (ringbuffer_base&&) = delete;
 
 public:
+    /* Tells whether the storage has been allocated. */
+    bool is_valid() const
+    {
+        return m_buffer != nullptr;
+    }
+
     std::size_t capacity() const
     {
         return m_capacity;
@@ -176,8 +315,8 @@ public:
 
     ringbuffer_status get_counters(std::size_t* produced, std::size_t* consumed, std::size_t* dropped) const
     {
-        std::size_t l_produced = m_counters.m_produced.load(std::memory_order_relaxed);
-        std::size_t l_consumed = m_counters.m_consumed.load(std::memory_order_relaxed);
+        std::size_t l_produced = m_counters.m_producer.m_produced.load(std::memory_order_acquire);
+        std::size_t l_consumed = m_counters.m_consumer.m_consumed.load(std::memory_order_acquire);
 
         if (l_produced < l_consumed)
             return ringbuffer_status::INTERNAL_ERROR;
@@ -189,22 +328,30 @@ public:
         if (consumed) *consumed = l_consumed;
 
         if (dropped)
-            *dropped = m_counters.m_dropped.load(std::memory_order_relaxed);
+            *dropped = m_counters.m_producer.m_dropped.load(std::memory_order_relaxed);
 
         return ringbuffer_status::OK;
     }
 
-    void reset(ringbuffer_role role)
+    /* Resetting is not synchronized with the opposite side,
+    thus it shall be done only when the other side is quiescent.
+    Virtual, as derived ringbuffers may have to dispose of the skipped elements. */
+    virtual void reset(ringbuffer_role role)
     {
         if (role == ringbuffer_role::PRODUCER) {
-            std::size_t consumed = m_counters.m_consumed.load(std::memory_order_relaxed);
-            m_counters.m_produced.store(consumed, std::memory_order_relaxed);
-            m_counters.m_dropped.store(0U, std::memory_order_relaxed);
+            std::size_t consumed = m_counters.m_consumer.m_consumed.load(std::memory_order_acquire);
+            m_counters.m_producer.m_produced.store(consumed, std::memory_order_release);
+            m_counters.m_producer.m_dropped.store(0U, std::memory_order_relaxed);
+            m_counters.m_producer.m_consumed_cache = consumed;
+            m_counters.m_producer.m_reserved = 0U;
+            m_counters.m_consumer.m_produced_cache = consumed;
         }
         else
         if (role == ringbuffer_role::CONSUMER) {
-            std::size_t produced = m_counters.m_produced.load(std::memory_order_relaxed);
-            m_counters.m_consumed.store(produced, std::memory_order_relaxed);
+            std::size_t produced = m_counters.m_producer.m_produced.load(std::memory_order_acquire);
+            m_counters.m_consumer.m_consumed.store(produced, std::memory_order_release);
+            m_counters.m_consumer.m_produced_cache = produced;
+            m_counters.m_consumer.m_peeked = 0U;
         }
         else {
             m_counters.reset();
@@ -231,6 +378,136 @@ public:
         }
     }
 
+    /* Sets number of iterations a blocked producer/consumer spins
+    waiting for the opposite side before it is put to sleep. */
+    void set_spin_count(ringbuffer_role role, unsigned int spin_count)
+    {
+        if (role == ringbuffer_role::PRODUCER)
+            m_writing_semaphore.set_spin_count(spin_count);
+        else
+        if (role == ringbuffer_role::CONSUMER)
+            m_reading_semaphore.set_spin_count(spin_count);
+        else {
+            m_writing_semaphore.set_spin_count(spin_count);
+            m_reading_semaphore.set_spin_count(spin_count);
+        }
+    }
+
+    /**
+     * Creates an eventfd which is signalled whenever the ringbuffer
+     * goes empty -> non-empty (for CONSUMER) or full -> not-full (for PRODUCER),
+     * so that side can wait for it in poll()/epoll()/io_uring together with other fds.
+     * It shall be called before the ringbuffer is used by any thread.
+     */
+    ringbuffer_status enable_notification(ringbuffer_role role)
+    {
+        int* fd = notification_fd_ptr(role);
+
+        if (nullptr == fd)
+            return ringbuffer_status::INVALID_ARGUMENT;
+
+        if (*fd < 0) {
+            *fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (*fd < 0)
+                return ringbuffer_status::INTERNAL_ERROR;
+        }
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Returns eventfd created by enable_notification() or -1. */
+    int notification_fd(ringbuffer_role role) const
+    {
+        if (role == ringbuffer_role::PRODUCER)
+            return m_writable_fd;
+        else
+        if (role == ringbuffer_role::CONSUMER)
+            return m_readable_fd;
+        else
+            return -1;
+    }
+
+    /* Consumes pending notification. To not miss an edge, it shall be
+    followed by another read()/write() attempt before waiting for the fd again. */
+    void clear_notification(ringbuffer_role role)
+    {
+        int fd = notification_fd(role);
+        eventfd_t value;
+
+        if (fd >= 0)
+            UNUSED(eventfd_read(fd, &value));
+    }
+
+    /* Tells the consumer whether there is anything to read. */
+    bool is_readable() const
+    {
+        return m_counters.m_producer.m_produced.load(std::memory_order_acquire) !=
+            m_counters.m_consumer.m_consumed.load(std::memory_order_relaxed);
+    }
+
+    /* Attaches/detaches a waiter notified whenever the ringbuffer goes empty -> non-empty
+    (see readable() and wait_any()). The first attach turns the notification path
+    of the producer on and the last detach turns it off again, no eventfd is needed for that.
+    Where membarrier() is not available that path is on for good, so the producer always fences. */
+    void attach_waiter(waiter* w)
+    {
+        m_readable_waiters.attach(w, [this]() {
+            if (!is_membarrier_supported())
+                return;
+
+            m_is_watched.store(true);
+
+            /* The producer checks the flag without a fence. Make it execute one,
+            so either its last publication is visible to the caller's next check
+            or it sees the flag (and thus fences and notifies) from now on.
+            The attaches that follow wait for it on the lock of the list. */
+            long status = syscall(SYS_membarrier, MEMBARRIER_CMD_GLOBAL, 0, 0);
+
+            /* It is not refused once the query allowed it. Should it be nevertheless,
+            the flag stays set, so the producer fences from now on and only
+            a publication racing with this very attach may go unnoticed. */
+            assert(0 == status);
+            UNUSED(status);
+        });
+    }
+
+    void detach_waiter(waiter* w)
+    {
+        m_readable_waiters.detach(w, [this]() {
+            if (is_membarrier_supported())
+                m_is_watched.store(false, std::memory_order_relaxed);
+        });
+    }
+
+    /* Tells whether the producer currently runs its notification path for waiters. */
+    bool is_watched() const
+    {
+        return m_is_watched.load(std::memory_order_relaxed);
+    }
+
+#if defined(RINGBUFFER_INSTRUMENTATION)
+    /* Fields are read one by one, so the snapshot is consistent
+    only when both sides are quiescent. */
+    ringbuffer_status get_statistics(ringbuffer_statistics* statistics) const
+    {
+        if (nullptr == statistics)
+            return ringbuffer_status::INVALID_ARGUMENT;
+
+        statistics->m_high_water = m_statistics.m_producer.m_high_water.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < RINGBUFFER_DEPTH_HISTOGRAM_SIZE; ++i)
+            statistics->m_depth_histogram[i] = m_statistics.m_producer.m_depth_histogram[i].load(std::memory_order_relaxed);
+        statistics->m_writer_blocked_count = m_statistics.m_producer.m_blocked_count.load(std::memory_order_relaxed);
+        statistics->m_writer_blocked_ns = m_statistics.m_producer.m_blocked_ns.load(std::memory_order_relaxed);
+        statistics->m_reader_blocked_count = m_statistics.m_consumer.m_blocked_count.load(std::memory_order_relaxed);
+        statistics->m_reader_blocked_ns = m_statistics.m_consumer.m_blocked_ns.load(std::memory_order_relaxed);
+        statistics->m_delay_count = m_statistics.m_consumer.m_delay_count.load(std::memory_order_relaxed);
+        statistics->m_delay_total_ns = m_statistics.m_consumer.m_delay_total_ns.load(std::memory_order_relaxed);
+        statistics->m_delay_max_ns = m_statistics.m_consumer.m_delay_max_ns.load(std::memory_order_relaxed);
+
+        return ringbuffer_status::OK;
+    }
+#endif
+
     std::string to_string() const
     {
         std::ostringstream stream;
@@ -239,6 +516,8 @@ public:
         stream << std::hex << this;
         stream << " [capacity: ";
         stream << std::dec << m_capacity;
+        stream << (m_mask != 0 ? " (power of two)" : "");
+        stream << (is_valid() ? "" : " (invalid)");
         stream << ", ";
         stream << "write policy: ";
         stream << (m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT) ? "non_blocking" : "blocking");
@@ -247,6 +526,12 @@ public:
         stream << (m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT) ? "non_blocking" : "blocking");
         stream << " ";
         stream << static_cast<std::string>(m_counters);
+#if defined(RINGBUFFER_INSTRUMENTATION)
+        ringbuffer_statistics statistics;
+        get_statistics(&statistics);
+        stream << " ";
+        stream << static_cast<std::string>(statistics);
+#endif
         stream << "]";
 
         return stream.str();
@@ -258,11 +543,43 @@ public:
     }
 
 protected:
+    /* Converts produced/consumed counter into buffer index.
+    Power of two capacities are handled with a mask instead of a division. */
+    std::size_t index(std::size_t counter) const
+    {
+        if (likely(m_mask != 0))
+            return counter & m_mask;
+        else
+            return counter % m_capacity;
+    }
+
+    static std::size_t roundup_power_of_two(std::size_t capacity)
+    {
+        return (capacity > 1) ? (std::size_t{1} << ilog2_roundup(capacity)) : capacity;
+    }
+
+    static T* heap_allocate(std::size_t capacity)
+    {
+        return new T[capacity];
+    }
+
+    static void heap_deallocate(T* buffer, std::size_t capacity)
+    {
+        UNUSED(capacity);
+        delete [] buffer;
+    }
+
+    /* Trivially copyable elements are transferred with memcpy(),
+    which gets vectorized by the compiler/libc, instead of one by one. */
     template<typename U>
     static bool copy(U* dst, const U* src, std::size_t count)
     {
-        while (count-- > 0)
-            *dst++ = *src++;
+        if constexpr (std::is_trivially_copyable_v<U>) {
+            std::memcpy(dst, src, count * sizeof(U));
+        } else {
+            while (count-- > 0)
+                *dst++ = *src++;
+        }
 
         return true;
     }
@@ -270,13 +587,277 @@ protected:
     template<typename U>
     static bool move(U* dst, U* src, std::size_t count)
     {
-        while (count-- > 0)
-            *dst++ = std::move(*src++);
+        if constexpr (std::is_trivially_copyable_v<U>) {
+            std::memcpy(dst, src, count * sizeof(U));
+        } else {
+            while (count-- > 0)
+                *dst++ = std::move(*src++);
+        }
 
         return true;
     }
 
-    struct alignas(CACHELINE_SIZE) counters
+    /* Called by the producer only.
+    The consumer index is re-read (and the cached copy refreshed)
+    only when the cached one does not give enough room for 'count' elements. */
+    ringbuffer_status get_free_elements(std::size_t count, std::size_t* produced, std::size_t* free_elements)
+    {
+        std::size_t l_produced = m_counters.m_producer.m_produced.load(std::memory_order_relaxed);
+        std::size_t l_consumed = m_counters.m_producer.m_consumed_cache;
+
+        if ((m_capacity - (l_produced - l_consumed)) < count) {
+            l_consumed = m_counters.m_consumer.m_consumed.load(std::memory_order_acquire);
+
+            if (l_produced < l_consumed)
+                return ringbuffer_status::INTERNAL_ERROR;
+
+            if ((l_produced - l_consumed) > m_capacity)
+                return ringbuffer_status::INTERNAL_ERROR;
+
+            m_counters.m_producer.m_consumed_cache = l_consumed;
+        }
+
+        *produced = l_produced;
+        *free_elements = m_capacity - (l_produced - l_consumed);
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Describes 'count' elements starting at 'counter' as (at most) two contiguous regions. */
+    ringbuffer_span<T> make_span(std::size_t counter, std::size_t count) const
+    {
+        std::size_t idx = index(counter);
+        std::size_t n1 = ((idx + count) > m_capacity) ? (m_capacity - idx) : count;
+
+        return ringbuffer_span<T>{m_buffer + idx, n1, m_buffer, count - n1};
+    }
+
+    /* Blocks the producer until the consumer frees some room. */
+    void wait_for_room()
+    {
+#if defined(RINGBUFFER_INSTRUMENTATION)
+        std::uint64_t t = now_ns();
+        m_writing_semaphore.wait();
+        add(m_statistics.m_producer.m_blocked_count, 1);
+        add(m_statistics.m_producer.m_blocked_ns, now_ns() - t);
+#else
+        m_writing_semaphore.wait();
+#endif
+    }
+
+    /* Blocks the consumer until the producer publishes some data. */
+    void wait_for_data()
+    {
+#if defined(RINGBUFFER_INSTRUMENTATION)
+        std::uint64_t t = now_ns();
+        m_reading_semaphore.wait();
+        add(m_statistics.m_consumer.m_blocked_count, 1);
+        add(m_statistics.m_consumer.m_blocked_ns, now_ns() - t);
+#else
+        m_reading_semaphore.wait();
+#endif
+    }
+
+    /* Called by the producer right before 'count' elements following 'produced' are published.
+    Without RINGBUFFER_INSTRUMENTATION it compiles to nothing. */
+    void instrument_write(std::size_t produced, std::size_t count)
+    {
+#if defined(RINGBUFFER_INSTRUMENTATION)
+        std::size_t depth = produced + count - m_counters.m_consumer.m_consumed.load(std::memory_order_relaxed);
+        std::size_t bucket = std::min<std::size_t>(ilog2(depth), RINGBUFFER_DEPTH_HISTOGRAM_SIZE - 1);
+
+        add(m_statistics.m_producer.m_depth_histogram[bucket], 1);
+        if (depth > m_statistics.m_producer.m_high_water.load(std::memory_order_relaxed))
+            m_statistics.m_producer.m_high_water.store(depth, std::memory_order_relaxed);
+
+#if defined(RINGBUFFER_INSTRUMENTATION_DELAY)
+        std::uint64_t t = now_ns();
+        for (std::size_t i = 0; i < count; ++i)
+            m_timestamps[index(produced + i)] = t;
+#endif
+#else
+        UNUSED(produced);
+        UNUSED(count);
+#endif
+    }
+
+    /* Called by the consumer right before 'count' elements following 'consumed' are retired. */
+    void instrument_read(std::size_t consumed, std::size_t count)
+    {
+#if defined(RINGBUFFER_INSTRUMENTATION) && defined(RINGBUFFER_INSTRUMENTATION_DELAY)
+        std::uint64_t t = now_ns();
+        std::uint64_t max = m_statistics.m_consumer.m_delay_max_ns.load(std::memory_order_relaxed);
+        std::uint64_t total = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint64_t delay = t - m_timestamps[index(consumed + i)];
+            total += delay;
+            if (delay > max)
+                max = delay;
+        }
+
+        add(m_statistics.m_consumer.m_delay_count, count);
+        add(m_statistics.m_consumer.m_delay_total_ns, total);
+        m_statistics.m_consumer.m_delay_max_ns.store(max, std::memory_order_relaxed);
+#else
+        UNUSED(consumed);
+        UNUSED(count);
+#endif
+    }
+
+    /* Called by the producer right after elements following 'produced' were published.
+    Together with notify_writable() it forms a store-fence-load pair on each side,
+    so either the opposite side sees the new index or the transition is signalled. */
+    void notify_readable(std::size_t produced)
+    {
+        if ((m_readable_fd < 0) && (m_writable_fd < 0) && !m_is_watched.load(std::memory_order_relaxed))
+            return;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (m_counters.m_consumer.m_consumed.load(std::memory_order_relaxed) == produced) {
+            /* it was empty */
+            if (m_readable_fd >= 0)
+                UNUSED(eventfd_write(m_readable_fd, 1));
+            m_readable_waiters.notify();
+        }
+    }
+
+    /* Called by the consumer right after elements following 'consumed' were retired. */
+    void notify_writable(std::size_t consumed)
+    {
+        if ((m_readable_fd < 0) && (m_writable_fd < 0))
+            return;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if ((m_writable_fd >= 0) && ((m_counters.m_producer.m_produced.load(std::memory_order_relaxed) - consumed) == m_capacity))
+            UNUSED(eventfd_write(m_writable_fd, 1)); /* it was full */
+    }
+
+    /* Called by the consumer only.
+    The producer index is re-read (and the cached copy refreshed)
+    only when the cached one does not give 'count' elements to be read. */
+    ringbuffer_status get_available_elements(std::size_t count, std::size_t* consumed, std::size_t* available_elements)
+    {
+        std::size_t l_consumed = m_counters.m_consumer.m_consumed.load(std::memory_order_relaxed);
+        std::size_t l_produced = m_counters.m_consumer.m_produced_cache;
+
+        if ((l_produced - l_consumed) < count) {
+            l_produced = m_counters.m_producer.m_produced.load(std::memory_order_acquire);
+
+            if (l_produced < l_consumed)
+                return ringbuffer_status::INTERNAL_ERROR;
+
+            if ((l_produced - l_consumed) > m_capacity)
+                return ringbuffer_status::INTERNAL_ERROR;
+
+            m_counters.m_consumer.m_produced_cache = l_produced;
+        }
+
+        *consumed = l_consumed;
+        *available_elements = l_produced - l_consumed;
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Called by the producer only. Waits (unless non-blocking) until there is room
+    for at least 'required' elements. With 'count_dropped' a refused (non-blocking)
+    attempt counts as dropped data. */
+    ringbuffer_status acquire_free_elements(std::size_t count, std::size_t* produced, std::size_t* free_elements,
+                                            bool count_dropped, std::size_t required = 1)
+    {
+        ringbuffer_status rbs;
+
+        if (m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT)) {
+            rbs = get_free_elements(count, produced, free_elements);
+            if (rbs != ringbuffer_status::OK)
+                return rbs;
+
+            if (*free_elements < required) {
+                if (count_dropped)
+                    m_counters.m_producer.m_dropped++;
+                return ringbuffer_status::WOULD_BLOCK;
+            }
+        } else {
+            for (;;) {
+                rbs = get_free_elements(count, produced, free_elements);
+                if (rbs != ringbuffer_status::OK)
+                    return rbs;
+
+                if (*free_elements >= required)
+                    break; /* leave the loop if we have room for new data */
+
+                wait_for_room(); /* let's wait until consumer will read some data */
+                if (m_is_writing_cancelled) {
+                    m_is_writing_cancelled = false;
+                    return ringbuffer_status::OPERATION_CANCELLED;
+                }
+            }
+        }
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Called by the consumer only. Waits (unless non-blocking) until there is anything to read. */
+    ringbuffer_status acquire_available_elements(std::size_t count, std::size_t* consumed, std::size_t* available_elements)
+    {
+        ringbuffer_status rbs;
+
+        if (m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT)) {
+            rbs = get_available_elements(count, consumed, available_elements);
+            if (rbs != ringbuffer_status::OK)
+                return rbs;
+
+            if (0 == *available_elements) {
+               return ringbuffer_status::WOULD_BLOCK;
+            }
+        } else {
+            for (;;) {
+                rbs = get_available_elements(count, consumed, available_elements);
+                if (rbs != ringbuffer_status::OK)
+                    return rbs;
+
+                if (*available_elements > 0)
+                    break; /* leave the loop if we have elements to be read */
+
+                wait_for_data(); /* let's wait until producer will write some data */
+                if (m_is_reading_cancelled) {
+                    m_is_reading_cancelled = false;
+                    return ringbuffer_status::OPERATION_CANCELLED;
+                }
+            }
+        }
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Makes 'count' elements following 'produced' visible to the consumer. */
+    void publish(std::size_t produced, std::size_t count)
+    {
+        instrument_write(produced, count);
+        m_counters.m_producer.m_produced.store(produced + count, std::memory_order_release);
+        notify_readable(produced);
+
+        if (!m_flags.test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+            m_reading_semaphore.post(); /* wake up one thread waiting for new data (if any) */
+    }
+
+    /* Gives 'count' elements following 'consumed' back to the producer. */
+    void retire(std::size_t consumed, std::size_t count)
+    {
+        instrument_read(consumed, count);
+        m_counters.m_consumer.m_consumed.store(consumed + count, std::memory_order_release);
+        notify_writable(consumed);
+
+        if (!m_flags.test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT))
+            m_writing_semaphore.post(); /* wake up one thread waiting for some space in the buffer (if any) */
+    }
+
+    /* Producer and consumer owned indices are kept on separate cache lines.
+    Each side also keeps a cached copy of the other side's index,
+    so in a steady state none of them touches the other's cache line. */
+    struct counters
     {
         explicit counters()
         {
@@ -285,9 +866,13 @@ protected:
 
         void reset()
         {
-            m_produced.store(0U, std::memory_order_relaxed);
-            m_consumed.store(0U, std::memory_order_relaxed);
-            m_dropped.store(0U, std::memory_order_relaxed);
+            m_producer.m_produced.store(0U, std::memory_order_relaxed);
+            m_producer.m_dropped.store(0U, std::memory_order_relaxed);
+            m_producer.m_consumed_cache = 0U;
+            m_producer.m_reserved = 0U;
+            m_consumer.m_consumed.store(0U, std::memory_order_relaxed);
+            m_consumer.m_produced_cache = 0U;
+            m_consumer.m_peeked = 0U;
         }
 
         std::string to_string() const
@@ -296,13 +881,13 @@ protected:
 
             stream << "[";
             stream << "produced: ";
-            stream << std::dec << m_produced.load(std::memory_order_relaxed);
+            stream << std::dec << m_producer.m_produced.load(std::memory_order_relaxed);
             stream << ", ";
             stream << "consumed: ";
-            stream << std::dec << m_consumed.load(std::memory_order_relaxed);
+            stream << std::dec << m_consumer.m_consumed.load(std::memory_order_relaxed);
             stream << ", ";
             stream << "dropped: ";
-            stream << std::dec << m_dropped.load(std::memory_order_relaxed);
+            stream << std::dec << m_producer.m_dropped.load(std::memory_order_relaxed);
             stream << "]";
 
             return stream.str();
@@ -313,19 +898,134 @@ protected:
             return to_string();
         }
 
-        std::atomic<std::size_t> m_produced;
-        std::atomic<std::size_t> m_consumed;
-        std::atomic<std::size_t> m_dropped;
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::size_t> m_produced;
+            std::atomic<std::size_t> m_dropped;
+            std::size_t m_consumed_cache;
+            std::size_t m_reserved; /* elements handed out by reserve() but not committed yet */
+        } m_producer;
+
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::size_t> m_consumed;
+            std::size_t m_produced_cache;
+            std::size_t m_peeked; /* elements handed out by peek() but not released yet */
+        } m_consumer;
     };
 
     std::size_t m_capacity;
+    std::size_t m_mask; /* m_capacity - 1 for power of two capacities, 0 otherwise */
     std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> m_flags;
     counters m_counters;
+    ringbuffer_storage<T> m_storage;
     T* m_buffer;
-    binary_semaphore m_writing_semaphore;
-    binary_semaphore m_reading_semaphore;
+    /* post() on these is lock free and enters the kernel only if the other side sleeps */
+    alignas(CACHELINE_SIZE) futex_binary_semaphore m_writing_semaphore;
+    alignas(CACHELINE_SIZE) futex_binary_semaphore m_reading_semaphore;
     std::atomic<bool> m_is_writing_cancelled;
     std::atomic<bool> m_is_reading_cancelled;
+    int m_readable_fd; /* eventfd signalled on empty -> non-empty transition (if enabled) */
+    int m_writable_fd; /* eventfd signalled on full -> not-full transition (if enabled) */
+    waiter_list m_readable_waiters; /* multi-waiters (wait_any()) */
+    std::atomic<bool> m_is_watched; /* set while waiters are attached (or for good without membarrier()) */
+
+#if defined(RINGBUFFER_INSTRUMENTATION)
+    /* Each side updates only its own part, so plain load/store is enough. */
+    struct statistics
+    {
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::size_t> m_high_water{0};
+            std::atomic<std::uint64_t> m_depth_histogram[RINGBUFFER_DEPTH_HISTOGRAM_SIZE]{};
+            std::atomic<std::uint64_t> m_blocked_count{0};
+            std::atomic<std::uint64_t> m_blocked_ns{0};
+        } m_producer;
+
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::uint64_t> m_blocked_count{0};
+            std::atomic<std::uint64_t> m_blocked_ns{0};
+            std::atomic<std::uint64_t> m_delay_count{0};
+            std::atomic<std::uint64_t> m_delay_total_ns{0};
+            std::atomic<std::uint64_t> m_delay_max_ns{0};
+        } m_consumer;
+    };
+
+    statistics m_statistics;
+#if defined(RINGBUFFER_INSTRUMENTATION_DELAY)
+    std::uint64_t* m_timestamps = nullptr; /* publication time of each slot */
+#endif
+#endif
+
+private:
+#if defined(RINGBUFFER_INSTRUMENTATION)
+    static std::uint64_t now_ns()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static void add(std::atomic<std::uint64_t>& counter, std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+#endif
+
+    /* MEMBARRIER_CMD_GLOBAL is refused e.g. by seccomp filters
+    or with nohz_full CPUs, the query tells it in advance. */
+    static bool is_membarrier_supported()
+    {
+        static const bool supported = []() {
+            long commands = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0, 0);
+            return (commands > 0) && ((commands & MEMBARRIER_CMD_GLOBAL) != 0);
+        }();
+
+        return supported;
+    }
+
+    int* notification_fd_ptr(ringbuffer_role role)
+    {
+        if (role == ringbuffer_role::PRODUCER)
+            return &m_writable_fd;
+        else
+        if (role == ringbuffer_role::CONSUMER)
+            return &m_readable_fd;
+        else
+            return nullptr;
+    }
+};
+
+/**
+ * Makes readability of a ringbuffer a waitable for wait_any().
+ * Taking it does not consume anything, the caller reads afterwards.
+ */
+template<typename T>
+class ringbuffer_readable
+{
+public:
+    explicit ringbuffer_readable(ringbuffer_base<T>& rb) :
+        m_rb{rb}
+    {
+    }
+
+    bool try_wait()
+    {
+        return m_rb.is_readable();
+    }
+
+    void attach_waiter(waiter* w)
+    {
+        m_rb.attach_waiter(w);
+    }
+
+    void detach_waiter(waiter* w)
+    {
+        m_rb.detach_waiter(w);
+    }
+
+private:
+    ringbuffer_base<T>& m_rb;
 };
 
 } /* end of namespace lts */
@@ -336,6 +1036,12 @@ protected:
 namespace lts
 {
 
+template<typename T>
+inline ringbuffer_readable<T> readable(ringbuffer_base<T>& rb)
+{
+    return ringbuffer_readable<T>{rb};
+}
+
 } /* end of namespace lts */
 
 /*===========================================================================*\
@@ -0,0 +1,215 @@
+/**
+ * @file ringbuffer_statistics_test.cpp
+ *
+ * Test procedures for 'ringbuffer' instrumentation
+ * (built with RINGBUFFER_INSTRUMENTATION and RINGBUFFER_INSTRUMENTATION_DELAY defined).
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "ringbuffer.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 100000
+
+#if !defined(RINGBUFFER_INSTRUMENTATION) || !defined(RINGBUFFER_INSTRUMENTATION_DELAY)
+#error "ringbuffer_statistics_test requires RINGBUFFER_INSTRUMENTATION and RINGBUFFER_INSTRUMENTATION_DELAY"
+#endif
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(ringbuffer_statistics, initial)
+{
+    lts::ringbuffer<std::size_t> rb(8, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    lts::ringbuffer_statistics statistics;
+
+    EXPECT_EQ(lts::ringbuffer_status::INVALID_ARGUMENT, rb.get_statistics(nullptr));
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_statistics(&statistics));
+    EXPECT_EQ(0U, statistics.m_high_water);
+    for (auto bucket : statistics.m_depth_histogram)
+        EXPECT_EQ(0U, bucket);
+    EXPECT_EQ(0U, statistics.m_writer_blocked_count);
+    EXPECT_EQ(0U, statistics.m_reader_blocked_count);
+    EXPECT_EQ(0U, statistics.m_delay_count);
+    EXPECT_EQ(0U, statistics.m_delay_max_ns);
+
+    std::cout << static_cast<std::string>(rb) << std::endl;
+}
+
+TEST(ringbuffer_statistics, occupancy)
+{
+    lts::ringbuffer<std::size_t> rb(8, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    lts::ringbuffer_statistics statistics;
+    std::size_t in3[] = {1, 2, 3};
+    std::size_t in2[] = {4, 5};
+    std::size_t out[6];
+
+    /* depths after each write: 1, 4, 6 and after the last one 2 */
+    EXPECT_EQ(1, rb.write(std::size_t{0}));
+    EXPECT_EQ(3, rb.write(in3));
+    EXPECT_EQ(2, rb.write(in2));
+    EXPECT_EQ(6, rb.read(out));
+    EXPECT_EQ(2, rb.write(in2));
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_statistics(&statistics));
+    EXPECT_EQ(6U, statistics.m_high_water);
+    EXPECT_EQ(1U, statistics.m_depth_histogram[0]);
+    EXPECT_EQ(1U, statistics.m_depth_histogram[1]);
+    EXPECT_EQ(2U, statistics.m_depth_histogram[2]);
+    EXPECT_EQ(0U, statistics.m_depth_histogram[3]);
+
+    /* no thread was ever parked */
+    EXPECT_EQ(0U, statistics.m_writer_blocked_count);
+    EXPECT_EQ(0U, statistics.m_reader_blocked_count);
+
+    EXPECT_EQ(6U, statistics.m_delay_count);
+    EXPECT_GE(statistics.m_delay_total_ns, statistics.m_delay_max_ns);
+
+    std::cout << static_cast<std::string>(statistics) << std::endl;
+}
+
+TEST(ringbuffer_statistics, queueing_delay)
+{
+    lts::ringbuffer<std::size_t> rb(4, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    lts::ringbuffer_statistics statistics;
+    std::size_t value;
+
+    EXPECT_EQ(1, rb.write(std::size_t{1}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(1, rb.read(value));
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_statistics(&statistics));
+    EXPECT_EQ(1U, statistics.m_delay_count);
+    EXPECT_GE(statistics.m_delay_max_ns, 10000000U);
+    EXPECT_EQ(statistics.m_delay_total_ns, statistics.m_delay_max_ns);
+}
+
+TEST(ringbuffer_statistics, blocked_time)
+{
+    lts::ringbuffer<std::size_t> rb(1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+    lts::ringbuffer_statistics statistics;
+
+    std::thread consumer {[&rb]() {
+        std::size_t value;
+        for (std::size_t consumed = 0; consumed < 2; ++consumed)
+            EXPECT_EQ(1, rb.read(value));
+    }};
+
+    /* the consumer has to wait for the first element */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(1, rb.write(std::size_t{1}));
+    EXPECT_EQ(1, rb.write(std::size_t{2}));
+    consumer.join();
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_statistics(&statistics));
+    EXPECT_GE(statistics.m_reader_blocked_count, 1U);
+    EXPECT_GE(statistics.m_reader_blocked_ns, 1000000U);
+    EXPECT_EQ(1U, statistics.m_high_water);
+
+    std::cout << static_cast<std::string>(rb) << std::endl;
+}
+
+TEST(ringbuffer_statistics, producer_consumer)
+{
+    lts::ringbuffer<std::size_t> rb(64, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+    lts::ringbuffer_statistics statistics;
+    std::uint64_t writes = 0;
+
+    std::thread producer {[&rb]() {
+        for (std::size_t produced = 0; produced < ITERATIONS; ++produced)
+            ASSERT_EQ(1, rb.write(produced));
+    }};
+    std::thread consumer {[&rb]() {
+        std::size_t value;
+        for (std::size_t consumed = 0; consumed < ITERATIONS; ++consumed) {
+            ASSERT_EQ(1, rb.read(value));
+            ASSERT_EQ(consumed, value);
+        }
+    }};
+
+    producer.join();
+    consumer.join();
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_statistics(&statistics));
+    for (auto bucket : statistics.m_depth_histogram)
+        writes += bucket;
+    EXPECT_EQ(static_cast<std::uint64_t>(ITERATIONS), writes);
+    EXPECT_LE(statistics.m_high_water, rb.capacity());
+    EXPECT_EQ(static_cast<std::uint64_t>(ITERATIONS), statistics.m_delay_count);
+
+    std::cout << static_cast<std::string>(rb) << std::endl;
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
@@ -22,6 +22,8 @@
 #include <thread>
 #include <mutex>
 
+#include <poll.h>
+
 /*===========================================================================*\
  * project header files
 \*===========================================================================*/
@@ -144,6 +146,28 @@ TEST(ringbuffer, 7in_11out_type_##TYPE##_capacity_##CAPACITY##_blocking)
                                                                                              \
         std::cout << static_cast<std::string>(rb) << std::endl;                              \
     }                                                                                        \
+    {                                                                                        \
+        lts::ringbuffer<TYPE> rb(CAPACITY, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);              \
+                                                                                             \
+        std::thread producer {producer_span<decltype(rb),  7>, std::ref(rb)};                \
+        std::thread consumer {consumer_span<decltype(rb), 11>, std::ref(rb)};                \
+                                                                                             \
+        producer.join();                                                                     \
+        consumer.join();                                                                     \
+                                                                                             \
+        std::cout << static_cast<std::string>(rb) << std::endl;                              \
+    }                                                                                        \
+    {                                                                                        \
+        lts::ringbuffer<TYPE> rb(CAPACITY, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);              \
+                                                                                             \
+        std::thread producer {producer_reserve<decltype(rb),  7>, std::ref(rb)};             \
+        std::thread consumer {consumer_peek<decltype(rb), 11>, std::ref(rb)};                \
+                                                                                             \
+        producer.join();                                                                     \
+        consumer.join();                                                                     \
+                                                                                             \
+        std::cout << static_cast<std::string>(rb) << std::endl;                              \
+    }                                                                                        \
 }
 
 #define TEST_7IN_11OUT_NONBLOCKING(TYPE, CAPACITY)                                           \
@@ -171,6 +195,17 @@ TEST(ringbuffer, 7in_11out_type_##TYPE##_capacity_##CAPACITY##_nonblocking)
                                                                                              \
         std::cout << static_cast<std::string>(rb) << std::endl;                              \
     }                                                                                        \
+    {                                                                                        \
+        lts::ringbuffer<TYPE> rb(CAPACITY, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);        \
+                                                                                             \
+        std::thread producer {producer_span<decltype(rb),  7>, std::ref(rb)};                \
+        std::thread consumer {consumer_span<decltype(rb), 11>, std::ref(rb)};                \
+                                                                                             \
+        producer.join();                                                                     \
+        consumer.join();                                                                     \
+                                                                                             \
+        std::cout << static_cast<std::string>(rb) << std::endl;                              \
+    }                                                                                        \
 }
 
 /*===========================================================================*\
@@ -252,6 +287,11 @@ template<typename RB, size_t N> static void producer_Nelements(RB& rb);
 template<typename RB, size_t N> static void consumer_Nelements(RB& rb);
 template<typename RB, size_t N> static void producer_function(RB& rb);
 template<typename RB, size_t N> static void consumer_function(RB& rb);
+template<typename RB, size_t N> static void producer_span(RB& rb);
+template<typename RB, size_t N> static void consumer_span(RB& rb);
+template<typename RB, size_t N> static void producer_reserve(RB& rb);
+template<typename RB, size_t N> static void consumer_peek(RB& rb);
+static bool is_signalled(int fd);
 
 /*===========================================================================*\
  * local object definitions
@@ -341,6 +381,242 @@ TEST(ringbuffer, create_on_heap_class_type)
     delete rb2;
 }
 
+TEST(ringbuffer, power_of_two_capacity_policy)
+{
+    const size_t capacities[][2] = {{1, 1}, {2, 2}, {5, 8}, {64, 64}, {65, 128}, {1000, 1024}};
+
+    for (const auto& c : capacities) {
+        lts::ringbuffer<size_t> rb(c[0], RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, lts::ringbuffer_capacity_policy::POWER_OF_TWO);
+        EXPECT_EQ(c[1], rb.capacity());
+        std::cout << static_cast<std::string>(rb) << std::endl;
+    }
+
+    {
+        lts::ringbuffer<rb_element> rb(65, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, lts::ringbuffer_capacity_policy::POWER_OF_TWO);
+
+        std::thread producer {producer_Nelements<decltype(rb),  7>, std::ref(rb)};
+        std::thread consumer {consumer_Nelements<decltype(rb), 11>, std::ref(rb)};
+
+        producer.join();
+        consumer.join();
+
+        std::cout << static_cast<std::string>(rb) << std::endl;
+    }
+}
+
+TEST(ringbuffer, reserve_commit_peek_release)
+{
+    lts::ringbuffer<size_t> rb(4, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    lts::ringbuffer_span<size_t> span;
+    size_t produced, consumed, dropped;
+    size_t value;
+
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.reserve(1, nullptr));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.commit(1));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.peek(1, &span));
+
+    /* reserve 3 elements, fill them in but publish only 2 of them */
+    EXPECT_EQ(3, rb.reserve(3, &span));
+    EXPECT_EQ(3U, span.size());
+    for (size_t i = 0; i < span.size(); ++i)
+        span[i] = i;
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.commit(4));
+    EXPECT_EQ(2, rb.commit(2));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.commit(1));
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(2U, produced);
+    EXPECT_EQ(0U, consumed);
+
+    /* peeking does not consume elements */
+    EXPECT_EQ(2, rb.peek(8, &span));
+    EXPECT_EQ(0U, span[0]);
+    EXPECT_EQ(1U, span[1]);
+    EXPECT_EQ(1, rb.peek(1, &span));
+    EXPECT_EQ(1, rb.release(1));
+    EXPECT_EQ(1, rb.peek(8, &span));
+    EXPECT_EQ(1U, span[0]);
+    EXPECT_EQ(1, rb.release(1));
+
+    /* reservation wrapping around the end of the buffer is split into two regions */
+    EXPECT_EQ(4, rb.reserve(8, &span));
+    EXPECT_EQ(2U, span.m_first_count);
+    EXPECT_EQ(2U, span.m_second_count);
+    for (size_t i = 0; i < span.size(); ++i)
+        span[i] = 10 + i;
+    EXPECT_EQ(4, rb.commit(4));
+
+    /* refused reservation is not a drop, refused write is */
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.reserve(1, &span));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.write(size_t{0}));
+
+    EXPECT_EQ(4, rb.peek(4, &span));
+    for (size_t i = 0; i < span.size(); ++i)
+        EXPECT_EQ(10 + i, span[i]);
+    EXPECT_EQ(4, rb.release(4));
+
+    /* writing would publish a pending reservation */
+    EXPECT_EQ(1, rb.reserve(1, &span));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.write(size_t{0}));
+    EXPECT_EQ(0, rb.commit(0));
+    EXPECT_EQ(1, rb.write(size_t{0}));
+    EXPECT_EQ(1, rb.read(value));
+
+    /* reading would retire pending peeked elements */
+    EXPECT_EQ(1, rb.write(size_t{20}));
+    EXPECT_EQ(1, rb.peek(1, &span));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT), rb.read(value));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT),
+        rb.read([](size_t*) { return true; }, 1));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INVALID_ARGUMENT),
+        rb.read_span([](size_t*, size_t n1, size_t*, size_t) { return n1; }, 1));
+    EXPECT_EQ(20U, span[0]);
+    EXPECT_EQ(0, rb.release(0));
+    EXPECT_EQ(1, rb.read(value));
+    EXPECT_EQ(20U, value);
+
+    EXPECT_EQ(lts::ringbuffer_status::OK, rb.get_counters(&produced, &consumed, &dropped));
+    EXPECT_EQ(8U, produced);
+    EXPECT_EQ(8U, consumed);
+    EXPECT_EQ(1U, dropped);
+}
+
+TEST(ringbuffer, eventfd_notification)
+{
+    lts::ringbuffer<size_t> rb(2, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    size_t value = 0;
+
+    EXPECT_EQ(-1, rb.notification_fd(lts::ringbuffer_role::CONSUMER));
+    EXPECT_EQ(lts::ringbuffer_status::INVALID_ARGUMENT, rb.enable_notification(lts::ringbuffer_role::NONE));
+    ASSERT_EQ(lts::ringbuffer_status::OK, rb.enable_notification(lts::ringbuffer_role::CONSUMER));
+    ASSERT_EQ(lts::ringbuffer_status::OK, rb.enable_notification(lts::ringbuffer_role::PRODUCER));
+    ASSERT_GE(rb.notification_fd(lts::ringbuffer_role::CONSUMER), 0);
+    ASSERT_GE(rb.notification_fd(lts::ringbuffer_role::PRODUCER), 0);
+
+    EXPECT_FALSE(is_signalled(rb.notification_fd(lts::ringbuffer_role::CONSUMER)));
+    EXPECT_FALSE(is_signalled(rb.notification_fd(lts::ringbuffer_role::PRODUCER)));
+
+    /* empty -> non-empty */
+    EXPECT_EQ(1, rb.write(value));
+    EXPECT_TRUE(is_signalled(rb.notification_fd(lts::ringbuffer_role::CONSUMER)));
+    rb.clear_notification(lts::ringbuffer_role::CONSUMER);
+    EXPECT_FALSE(is_signalled(rb.notification_fd(lts::ringbuffer_role::CONSUMER)));
+
+    /* non-empty -> full is not an edge for anybody */
+    EXPECT_EQ(1, rb.write(value));
+    EXPECT_FALSE(is_signalled(rb.notification_fd(lts::ringbuffer_role::CONSUMER)));
+    EXPECT_FALSE(is_signalled(rb.notification_fd(lts::ringbuffer_role::PRODUCER)));
+
+    /* full -> not-full */
+    EXPECT_EQ(1, rb.read(value));
+    EXPECT_TRUE(is_signalled(rb.notification_fd(lts::ringbuffer_role::PRODUCER)));
+    rb.clear_notification(lts::ringbuffer_role::PRODUCER);
+
+    /* not-full -> empty is not an edge either */
+    EXPECT_EQ(1, rb.read(value));
+    EXPECT_FALSE(is_signalled(rb.notification_fd(lts::ringbuffer_role::PRODUCER)));
+    EXPECT_FALSE(is_signalled(rb.notification_fd(lts::ringbuffer_role::CONSUMER)));
+}
+
+TEST(ringbuffer, eventfd_poll_loop)
+{
+    lts::ringbuffer<size_t> rb(16, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING);
+    ASSERT_EQ(lts::ringbuffer_status::OK, rb.enable_notification(lts::ringbuffer_role::CONSUMER));
+    ASSERT_EQ(lts::ringbuffer_status::OK, rb.enable_notification(lts::ringbuffer_role::PRODUCER));
+
+    std::thread producer {[&rb]() {
+        for (size_t produced = 0; produced < ITERATIONS;) {
+            long status = rb.write(produced);
+            if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                rb.clear_notification(lts::ringbuffer_role::PRODUCER);
+                status = rb.write(produced);
+                if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                    struct pollfd pfd = {rb.notification_fd(lts::ringbuffer_role::PRODUCER), POLLIN, 0};
+                    ASSERT_EQ(1, poll(&pfd, 1, -1));
+                    continue;
+                }
+            }
+            ASSERT_EQ(1, status);
+            produced++;
+        }
+    }};
+
+    std::thread consumer {[&rb]() {
+        size_t value;
+        for (size_t consumed = 0; consumed < ITERATIONS;) {
+            long status = rb.read(value);
+            if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                rb.clear_notification(lts::ringbuffer_role::CONSUMER);
+                status = rb.read(value);
+                if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                    struct pollfd pfd = {rb.notification_fd(lts::ringbuffer_role::CONSUMER), POLLIN, 0};
+                    ASSERT_EQ(1, poll(&pfd, 1, -1));
+                    continue;
+                }
+            }
+            ASSERT_EQ(1, status);
+            ASSERT_EQ(consumed, value);
+            consumed++;
+        }
+    }};
+
+    producer.join();
+    consumer.join();
+
+    std::cout << static_cast<std::string>(rb) << std::endl;
+}
+
+TEST(ringbuffer, wait_any_readable)
+{
+    lts::ringbuffer<size_t> rb1(4, RINGBUFFER_RD_NONBLOCKING_WR_BLOCKING);
+    lts::ringbuffer<size_t> rb2(4, RINGBUFFER_RD_NONBLOCKING_WR_BLOCKING);
+    lts::ringbuffer<size_t>* rbs[] = {&rb1, &rb2};
+    size_t consumed[] = {0, 0};
+    size_t value;
+
+    /* waiters work both with and without the eventfd */
+    ASSERT_EQ(lts::ringbuffer_status::OK, rb1.enable_notification(lts::ringbuffer_role::CONSUMER));
+    ASSERT_EQ(-1, rb2.notification_fd(lts::ringbuffer_role::CONSUMER));
+
+    /* watched for good only where membarrier() is not available */
+    const bool always_watched = rb2.is_watched();
+
+    EXPECT_FALSE(rb1.is_readable());
+    EXPECT_EQ(-1, lts::wait_any_for(std::chrono::milliseconds(1), lts::readable(rb1), lts::readable(rb2)));
+    EXPECT_EQ(always_watched, rb2.is_watched());
+
+    std::thread producer1 {[&rb1]() {
+        for (size_t produced = 0; produced < ITERATIONS; ++produced)
+            ASSERT_EQ(1, rb1.write(produced));
+    }};
+    std::thread producer2 {[&rb2]() {
+        for (size_t produced = 0; produced < ITERATIONS; ++produced) {
+            if ((produced % 100) == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ASSERT_EQ(1, rb2.write(produced));
+        }
+    }};
+
+    /* one consumer thread serves both ringbuffers without polling */
+    while ((consumed[0] < ITERATIONS) || (consumed[1] < ITERATIONS)) {
+        long index = lts::wait_any(lts::readable(rb1), lts::readable(rb2));
+        ASSERT_TRUE((index == 0) || (index == 1));
+        ASSERT_EQ(1, rbs[index]->read(value));
+        ASSERT_EQ(consumed[index], value);
+        consumed[index]++;
+    }
+
+    producer1.join();
+    producer2.join();
+
+    EXPECT_FALSE(rb1.is_readable());
+    EXPECT_FALSE(rb2.is_readable());
+
+    /* the last detach turns the notification path off again */
+    EXPECT_EQ(always_watched, rb1.is_watched());
+    EXPECT_EQ(always_watched, rb2.is_watched());
+}
+
 /*===========================================================================*\
  * tests of blocking semantic of ringbuffer
 \*===========================================================================*/
@@ -595,3 +871,140 @@ static void consumer_function(RB& rb)
     std::cout << "consumed: " << consumed << " wouldblock_cnt: " << wouldblock_cnt << std::endl;
     mutex.unlock();
 }
+
+template<typename RB, size_t N>
+static void producer_span(RB& rb)
+{
+    long status;
+    size_t produced;
+    size_t wouldblock_cnt;
+
+    produced = 0;
+    wouldblock_cnt = 0;
+    while (produced < ITERATIONS) {
+        status = rb.write_span([&produced](typename RB::value_type *first, size_t n1,
+                                           typename RB::value_type *second, size_t n2) -> size_t {
+            for (size_t i = 0; i < n1; ++i)
+                first[i] = produced++;
+            for (size_t i = 0; i < n2; ++i)
+                second[i] = produced++;
+            return n1 + n2;
+        }, std::min<size_t>(N, ITERATIONS - produced));
+        if (status < 0) {
+            if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                wouldblock_cnt++;
+                continue;
+            }
+            else {
+                std::cout << "rb.write_span() failed with code " << status << std::endl;
+                break;
+            }
+        }
+    }
+    mutex.lock();
+    std::cout << "produced: " << produced << " wouldblock_cnt: " << wouldblock_cnt << std::endl;
+    mutex.unlock();
+    EXPECT_EQ(ITERATIONS, produced);
+}
+
+template<typename RB, size_t N>
+static void consumer_span(RB& rb)
+{
+    long status;
+    size_t consumed;
+    size_t wouldblock_cnt;
+
+    consumed = 0;
+    wouldblock_cnt = 0;
+    while (consumed < ITERATIONS) {
+        status = rb.read_span([&consumed](typename RB::value_type *first, size_t n1,
+                                          typename RB::value_type *second, size_t n2) -> size_t {
+            for (size_t i = 0; i < n1; ++i)
+                EXPECT_EQ(first[i], consumed + i);
+            for (size_t i = 0; i < n2; ++i)
+                EXPECT_EQ(second[i], consumed + n1 + i);
+            /* consume only the first region, the rest is left for the next call */
+            return n1;
+        }, N);
+        if (status < 0) {
+            if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+                wouldblock_cnt++;
+                continue;
+            }
+            else {
+                std::cout << "rb.read_span() failed with code " << status << std::endl;
+                break;
+            }
+        }
+        consumed += status;
+    }
+    mutex.lock();
+    std::cout << "consumed: " << consumed << " wouldblock_cnt: " << wouldblock_cnt << std::endl;
+    mutex.unlock();
+    EXPECT_EQ(ITERATIONS, consumed);
+}
+
+template<typename RB, size_t N>
+static void producer_reserve(RB& rb)
+{
+    long status;
+    size_t produced;
+    lts::ringbuffer_span<typename RB::value_type> span;
+
+    produced = 0;
+    while (produced < ITERATIONS) {
+        status = rb.reserve(std::min<size_t>(N, ITERATIONS - produced), &span);
+        if (status < 0) {
+            std::cout << "rb.reserve() failed with code " << status << std::endl;
+            break;
+        }
+        for (size_t i = 0; i < span.size(); ++i)
+            span[i] = produced + i;
+        status = rb.commit(span.size());
+        if (status < 0) {
+            std::cout << "rb.commit() failed with code " << status << std::endl;
+            break;
+        }
+        produced += status;
+    }
+    mutex.lock();
+    std::cout << "produced: " << produced << std::endl;
+    mutex.unlock();
+    EXPECT_EQ(ITERATIONS, produced);
+}
+
+template<typename RB, size_t N>
+static void consumer_peek(RB& rb)
+{
+    long status;
+    size_t consumed;
+    lts::ringbuffer_span<typename RB::value_type> span;
+
+    consumed = 0;
+    while (consumed < ITERATIONS) {
+        status = rb.peek(N, &span);
+        if (status < 0) {
+            std::cout << "rb.peek() failed with code " << status << std::endl;
+            break;
+        }
+        for (size_t i = 0; i < span.size(); ++i)
+            EXPECT_EQ(span[i], consumed + i);
+        status = rb.release(span.size());
+        if (status < 0) {
+            std::cout << "rb.release() failed with code " << status << std::endl;
+            break;
+        }
+        consumed += status;
+    }
+    mutex.lock();
+    std::cout << "consumed: " << consumed << std::endl;
+    mutex.unlock();
+    EXPECT_EQ(ITERATIONS, consumed);
+}
+
+static bool is_signalled(int fd)
+{
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    return (1 == poll(&pfd, 1, 0)) && (pfd.revents & POLLIN);
+}
@@ -6,5 +6,34 @@ set -x
 make clean
 make all
 
-perf stat ./pt -c 1000 -i100000000
+for capacity in 64 1000 1000000
+do
+    perf stat -e cycles,instructions,cache-references,cache-misses ./pt -c ${capacity} -i100000000
+done
 
+for capacity in 1000 1000000
+do
+    perf stat -e cycles,instructions,cache-references,cache-misses ./pt -c ${capacity} -p -i100000000
+done
+
+for batch in 1 16 256 1316
+do
+    perf stat ./pt -c 65536 -b ${batch} -8 -i1000000000
+done
+
+for threads in "1 1" "4 1" "1 4" "4 4"
+do
+    set -- ${threads}
+    perf stat ./pt -c 1024 -m -P $1 -C $2 -i100000000
+done
+
+for spin in 0 100 1000 10000
+do
+    perf stat -e cycles,instructions,context-switches ./pt -c 64 -s ${spin} -i100000000
+done
+
+for batch in 1 16 256
+do
+    perf stat ./pt -c 65536 -b ${batch} -i100000000
+    perf stat ./pt -c 65536 -b ${batch} -r -i100000000
+done
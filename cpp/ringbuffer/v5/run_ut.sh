@@ -3,8 +3,8 @@
 set -e
 set -x
 
-UT_SRC='ringbuffer_base.hpp iringbuffer.hpp oringbuffer.hpp ringbuffer.hpp'
-UT_BIN='ringbuffer_test'
+UT_SRC='ringbuffer_base.hpp iringbuffer.hpp oringbuffer.hpp ringbuffer.hpp mpmc_ringbuffer.hpp shm_ringbuffer.hpp magic_ringbuffer.hpp overwrite_ringbuffer.hpp record_ringbuffer.hpp emplace_ringbuffer.hpp'
+UT_BIN='ringbuffer_test mpmc_ringbuffer_test shm_ringbuffer_test magic_ringbuffer_test overwrite_ringbuffer_test record_ringbuffer_test emplace_ringbuffer_test ringbuffer_statistics_test'
 
 make clean
 make all
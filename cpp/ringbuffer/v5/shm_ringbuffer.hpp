@@ -0,0 +1,612 @@
+/**
+ * @file shm_ringbuffer.hpp
+ *
+ * Definition of single-producer/single-consumer ringbuffer
+ * which connects two processes.
+ * Its header (capacity, flags, counters, semaphores) and storage
+ * live in a shared memory mapping (memfd_create() or shm_open()),
+ * so a second process may attach to it either by file descriptor or by name.
+ * Its non-blocking path is completely lockless.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _SHM_RINGBUFFER_HPP_
+#define _SHM_RINGBUFFER_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <bitset>
+#include <new>
+#include <type_traits>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(DEBUG_RINGBUFFER)
+#include <iostream>
+#endif
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "ringbuffer_base.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define SHM_RINGBUFFER_MAGIC 0x53524231 /* "SRB1" */
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Ringbuffer shared between two processes (one producer and one consumer).
+ *
+ * The creating process either gets an anonymous memfd (no name given),
+ * which it passes to the other process (e.g. by fork() or SCM_RIGHTS),
+ * or a named POSIX shared memory object which the other process opens by name.
+ * The creator unlinks the name when it is destroyed, already attached
+ * processes keep on working.
+ *
+ * Elements are transferred with memcpy(), thus T has to be trivially copyable.
+ * Each side keeps a process local copy of the other side's counter
+ * and refreshes it only when it does not give enough elements.
+ */
+template<typename T>
+class shm_ringbuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>, "shm_ringbuffer requires trivially copyable elements");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared counters have to be lock free");
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "shared flags have to be lock free");
+
+public:
+    typedef T value_type;
+
+    /**
+     * Creates new ringbuffer.
+     *
+     * @param[in] capacity    Max number of elements.
+     * @param[in] flags       Blocking/non-blocking semantics of both sides.
+     * @param[in] name        Name of the POSIX shared memory object (e.g. "/capture")
+     *                        or nullptr to create an anonymous memfd.
+     */
+    explicit shm_ringbuffer(std::size_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags,
+                            const char* name = nullptr) :
+        m_fd{-1},
+        m_name{name ? name : ""},
+        m_is_owner{true},
+        m_size{0},
+        m_header{nullptr},
+        m_buffer{nullptr},
+        m_consumed_cache{0},
+        m_produced_cache{0}
+    {
+        assert(capacity > 0);
+        assert(capacity < LONG_MAX / sizeof(T));
+
+        m_fd = name ? ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600) : ::memfd_create("shm_ringbuffer", MFD_CLOEXEC);
+        if (m_fd < 0)
+            return;
+
+        m_size = sizeof(header) + capacity * sizeof(T);
+        if (::ftruncate(m_fd, static_cast<off_t>(m_size)) < 0) {
+            close();
+            return;
+        }
+
+        if (!map()) {
+            close();
+            return;
+        }
+
+        m_header = new (m_header) header{capacity, flags};
+
+        /* published last, attach() does not look at anything else before it sees the magic */
+        m_header->m_magic.store(SHM_RINGBUFFER_MAGIC, std::memory_order_release);
+
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+        std::cout << to_string() << std::endl;
+#endif
+    }
+
+    /**
+     * Attaches to the ringbuffer created by other process.
+     *
+     * @param[in] fd          File descriptor of the shared memory (it is duplicated).
+     */
+    explicit shm_ringbuffer(int fd) :
+        m_fd{(fd < 0) ? -1 : ::fcntl(fd, F_DUPFD_CLOEXEC, 0)},
+        m_name{},
+        m_is_owner{false},
+        m_size{0},
+        m_header{nullptr},
+        m_buffer{nullptr},
+        m_consumed_cache{0},
+        m_produced_cache{0}
+    {
+        attach();
+    }
+
+    /**
+     * Attaches to the ringbuffer created by other process.
+     *
+     * @param[in] name        Name of the POSIX shared memory object.
+     */
+    explicit shm_ringbuffer(const char* name) :
+        m_fd{::shm_open(name, O_RDWR, 0)},
+        m_name{name},
+        m_is_owner{false},
+        m_size{0},
+        m_header{nullptr},
+        m_buffer{nullptr},
+        m_consumed_cache{0},
+        m_produced_cache{0}
+    {
+        attach();
+    }
+
+    ~shm_ringbuffer()
+    {
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+#endif
+
+        if (m_header && m_is_owner)
+            m_header->~header();
+
+        close();
+    }
+
+    shm_ringbuffer(const shm_ringbuffer&) = delete;
+    shm_ringbuffer(shm_ringbuffer&&) = delete;
+    shm_ringbuffer& operator = (const shm_ringbuffer&) = delete;
+    shm_ringbuffer& operator = (shm_ringbuffer&&) = delete;
+
+    bool is_valid() const
+    {
+        return m_header != nullptr;
+    }
+
+    int fd() const
+    {
+        return m_fd;
+    }
+
+    std::size_t capacity() const
+    {
+        return is_valid() ? m_header->m_capacity : 0;
+    }
+
+    std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags() const
+    {
+        return is_valid() ? std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX>{m_header->m_flags} : std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX>{};
+    }
+
+    long write(const T& data)
+    {
+        return write(&data, 1);
+    }
+
+    template<std::size_t N>
+    long write(const T (&data)[N])
+    {
+        return write(data, N);
+    }
+
+    long write(const T* data, std::size_t count)
+    {
+        std::uint64_t produced;
+        std::size_t free_elements;
+        ringbuffer_status rbs;
+
+        if (!is_valid())
+            return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
+
+        if (0 == count)
+            return 0;
+
+        rbs = acquire_free_elements(count, &produced, &free_elements);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > free_elements)
+            count = free_elements;
+
+        copy_to_buffer(produced, data, count);
+
+        m_header->m_producer.m_produced.store(produced + count, std::memory_order_release);
+        if (!m_header->test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+            m_header->m_reading_semaphore.post(); /* wake up the consumer (if it sleeps) */
+
+        return count;
+    }
+
+    long read(T& data)
+    {
+        return read(&data, 1);
+    }
+
+    template<std::size_t N>
+    long read(T (&data)[N])
+    {
+        return read(data, N);
+    }
+
+    long read(T* data, std::size_t count)
+    {
+        std::uint64_t consumed;
+        std::size_t available_elements;
+        ringbuffer_status rbs;
+
+        if (!is_valid())
+            return static_cast<long>(ringbuffer_status::INTERNAL_ERROR);
+
+        if (0 == count)
+            return 0;
+
+        rbs = acquire_available_elements(count, &consumed, &available_elements);
+        if (rbs != ringbuffer_status::OK)
+            return static_cast<long>(rbs);
+
+        if (count > available_elements)
+            count = available_elements;
+
+        copy_from_buffer(consumed, data, count);
+
+        m_header->m_consumer.m_consumed.store(consumed + count, std::memory_order_release);
+        if (!m_header->test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT))
+            m_header->m_writing_semaphore.post(); /* wake up the producer (if it sleeps) */
+
+        return count;
+    }
+
+    ringbuffer_status get_counters(std::size_t* produced, std::size_t* consumed, std::size_t* dropped) const
+    {
+        if (!is_valid())
+            return ringbuffer_status::INTERNAL_ERROR;
+
+        std::uint64_t l_produced = m_header->m_producer.m_produced.load(std::memory_order_acquire);
+        std::uint64_t l_consumed = m_header->m_consumer.m_consumed.load(std::memory_order_acquire);
+
+        if (l_produced < l_consumed)
+            return ringbuffer_status::INTERNAL_ERROR;
+
+        if ((l_produced - l_consumed) > m_header->m_capacity)
+            return ringbuffer_status::INTERNAL_ERROR;
+
+        if (produced) *produced = l_produced;
+        if (consumed) *consumed = l_consumed;
+
+        if (dropped)
+            *dropped = m_header->m_producer.m_dropped.load(std::memory_order_relaxed);
+
+        return ringbuffer_status::OK;
+    }
+
+    /* Cancellation is visible to the other process as well. */
+    void cancel(ringbuffer_role role)
+    {
+        if (!is_valid())
+            return;
+
+        if (role == ringbuffer_role::PRODUCER) {
+            if (!m_header->test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT)) {
+                m_header->m_producer.m_is_cancelled.store(1U);
+                m_header->m_writing_semaphore.post();
+            }
+        }
+        else
+        if (role == ringbuffer_role::CONSUMER) {
+            if (!m_header->test(RINGBUFFER_NONBLOCKING_READ_SHIFT)) {
+                m_header->m_consumer.m_is_cancelled.store(1U);
+                m_header->m_reading_semaphore.post();
+            }
+        }
+        else {
+            /* do noting */
+        }
+    }
+
+    std::string to_string() const
+    {
+        std::ostringstream stream;
+
+        stream << "shm_ringbuffer@";
+        stream << std::hex << this;
+        stream << " [fd: ";
+        stream << std::dec << m_fd;
+        if (!m_name.empty())
+            stream << ", name: " << m_name;
+        if (!is_valid()) {
+            stream << ", invalid]";
+            return stream.str();
+        }
+        stream << ", capacity: ";
+        stream << std::dec << m_header->m_capacity;
+        stream << ", ";
+        stream << "write policy: ";
+        stream << (m_header->test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT) ? "non_blocking" : "blocking");
+        stream << ", ";
+        stream << "read policy: ";
+        stream << (m_header->test(RINGBUFFER_NONBLOCKING_READ_SHIFT) ? "non_blocking" : "blocking");
+        stream << " [produced: ";
+        stream << std::dec << m_header->m_producer.m_produced.load(std::memory_order_relaxed);
+        stream << ", consumed: ";
+        stream << std::dec << m_header->m_consumer.m_consumed.load(std::memory_order_relaxed);
+        stream << ", dropped: ";
+        stream << std::dec << m_header->m_producer.m_dropped.load(std::memory_order_relaxed);
+        stream << "]]";
+
+        return stream.str();
+    }
+
+    operator std::string () const
+    {
+        return to_string();
+    }
+
+private:
+    /* Placed at the beginning of the mapping, the storage follows it.
+    Only fixed size types are used, so both processes see the same layout. */
+    struct header
+    {
+        explicit header(std::uint64_t capacity, std::bitset<RINGBUFFER_NONBLOCKING_FLAGS_MAX> flags) :
+            m_magic{0},
+            m_element_size{sizeof(T)},
+            m_capacity{capacity},
+            m_mask{is_power_of_two(capacity) ? capacity - 1 : 0},
+            m_flags{static_cast<std::uint32_t>(flags.to_ulong())},
+            m_producer{},
+            m_consumer{},
+            m_writing_semaphore{true, RINGBUFFER_SPIN_COUNT, true, true},
+            m_reading_semaphore{false, RINGBUFFER_SPIN_COUNT, true, true}
+        {
+            m_producer.m_produced.store(0U, std::memory_order_relaxed);
+            m_producer.m_dropped.store(0U, std::memory_order_relaxed);
+            m_producer.m_is_cancelled.store(0U, std::memory_order_relaxed);
+            m_consumer.m_consumed.store(0U, std::memory_order_relaxed);
+            m_consumer.m_is_cancelled.store(0U, std::memory_order_relaxed);
+        }
+
+        bool test(std::size_t shift) const
+        {
+            return (m_flags >> shift) & 1U;
+        }
+
+        std::atomic<std::uint32_t> m_magic; /* SHM_RINGBUFFER_MAGIC once the rest is initialised */
+        std::uint32_t m_element_size;
+        std::uint64_t m_capacity;
+        std::uint64_t m_mask;
+        std::uint32_t m_flags;
+
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::uint64_t> m_produced;
+            std::atomic<std::uint64_t> m_dropped;
+            std::atomic<std::uint32_t> m_is_cancelled;
+        } m_producer;
+
+        struct alignas(CACHELINE_SIZE)
+        {
+            std::atomic<std::uint64_t> m_consumed;
+            std::atomic<std::uint32_t> m_is_cancelled;
+        } m_consumer;
+
+        alignas(CACHELINE_SIZE) futex_binary_semaphore m_writing_semaphore;
+        alignas(CACHELINE_SIZE) futex_binary_semaphore m_reading_semaphore;
+    };
+
+    static_assert((sizeof(header) % alignof(T)) == 0, "storage would be misaligned");
+
+    bool map()
+    {
+        void* addr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (MAP_FAILED == addr)
+            return false;
+
+        m_header = static_cast<header*>(addr);
+        m_buffer = reinterpret_cast<T*>(static_cast<std::uint8_t*>(addr) + sizeof(header));
+
+        return true;
+    }
+
+    void attach()
+    {
+        struct stat st;
+
+        if (m_fd < 0)
+            return;
+
+        if ((::fstat(m_fd, &st) < 0) || (static_cast<std::size_t>(st.st_size) < sizeof(header))) {
+            close();
+            return;
+        }
+
+        m_size = static_cast<std::size_t>(st.st_size);
+        if (!map()) {
+            close();
+            return;
+        }
+
+        if ((m_header->m_magic.load(std::memory_order_acquire) != SHM_RINGBUFFER_MAGIC) ||
+            (m_header->m_element_size != sizeof(T)) ||
+            (m_header->m_capacity == 0) ||
+            (m_header->m_capacity > (m_size - sizeof(header)) / sizeof(T))) {
+            close();
+            return;
+        }
+
+        m_consumed_cache = m_header->m_consumer.m_consumed.load(std::memory_order_acquire);
+        m_produced_cache = m_header->m_producer.m_produced.load(std::memory_order_acquire);
+
+#if defined(DEBUG_RINGBUFFER)
+        std::cout << __PRETTY_FUNCTION__ << std::endl;
+        std::cout << to_string() << std::endl;
+#endif
+    }
+
+    void close()
+    {
+        if (m_header) {
+            ::munmap(m_header, m_size);
+            m_header = nullptr;
+            m_buffer = nullptr;
+        }
+
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+
+        if (m_is_owner && !m_name.empty()) {
+            ::shm_unlink(m_name.c_str());
+            m_is_owner = false;
+        }
+    }
+
+    std::size_t index(std::uint64_t counter) const
+    {
+        if (likely(m_header->m_mask != 0))
+            return counter & m_header->m_mask;
+        else
+            return counter % m_header->m_capacity;
+    }
+
+    void copy_to_buffer(std::uint64_t counter, const T* src, std::size_t count)
+    {
+        std::size_t idx = index(counter);
+        std::size_t n1 = ((idx + count) > m_header->m_capacity) ? (m_header->m_capacity - idx) : count;
+
+        std::memcpy(m_buffer + idx, src, n1 * sizeof(T));
+        std::memcpy(m_buffer, src + n1, (count - n1) * sizeof(T));
+    }
+
+    void copy_from_buffer(std::uint64_t counter, T* dst, std::size_t count) const
+    {
+        std::size_t idx = index(counter);
+        std::size_t n1 = ((idx + count) > m_header->m_capacity) ? (m_header->m_capacity - idx) : count;
+
+        std::memcpy(dst, m_buffer + idx, n1 * sizeof(T));
+        std::memcpy(dst + n1, m_buffer, (count - n1) * sizeof(T));
+    }
+
+    ringbuffer_status acquire_free_elements(std::size_t count, std::uint64_t* produced, std::size_t* free_elements)
+    {
+        const std::uint64_t capacity = m_header->m_capacity;
+
+        *produced = m_header->m_producer.m_produced.load(std::memory_order_relaxed);
+
+        for (;;) {
+            if ((capacity - (*produced - m_consumed_cache)) < count) {
+                m_consumed_cache = m_header->m_consumer.m_consumed.load(std::memory_order_acquire);
+
+                if ((*produced < m_consumed_cache) || ((*produced - m_consumed_cache) > capacity))
+                    return ringbuffer_status::INTERNAL_ERROR;
+            }
+
+            *free_elements = capacity - (*produced - m_consumed_cache);
+            if (*free_elements > 0)
+                break; /* leave the loop if we have room for new data */
+
+            if (m_header->test(RINGBUFFER_NONBLOCKING_WRITE_SHIFT)) {
+                m_header->m_producer.m_dropped++;
+                return ringbuffer_status::WOULD_BLOCK;
+            }
+
+            m_header->m_writing_semaphore.wait(); /* let's wait until consumer will read some data */
+            if (m_header->m_producer.m_is_cancelled.exchange(0U))
+                return ringbuffer_status::OPERATION_CANCELLED;
+        }
+
+        return ringbuffer_status::OK;
+    }
+
+    ringbuffer_status acquire_available_elements(std::size_t count, std::uint64_t* consumed, std::size_t* available_elements)
+    {
+        *consumed = m_header->m_consumer.m_consumed.load(std::memory_order_relaxed);
+
+        for (;;) {
+            if ((m_produced_cache - *consumed) < count) {
+                m_produced_cache = m_header->m_producer.m_produced.load(std::memory_order_acquire);
+
+                if ((m_produced_cache < *consumed) || ((m_produced_cache - *consumed) > m_header->m_capacity))
+                    return ringbuffer_status::INTERNAL_ERROR;
+            }
+
+            *available_elements = m_produced_cache - *consumed;
+            if (*available_elements > 0)
+                break; /* leave the loop if we have elements to be read */
+
+            if (m_header->test(RINGBUFFER_NONBLOCKING_READ_SHIFT))
+                return ringbuffer_status::WOULD_BLOCK;
+
+            m_header->m_reading_semaphore.wait(); /* let's wait until producer will write some data */
+            if (m_header->m_consumer.m_is_cancelled.exchange(0U))
+                return ringbuffer_status::OPERATION_CANCELLED;
+        }
+
+        return ringbuffer_status::OK;
+    }
+
+    int m_fd;
+    std::string m_name;
+    bool m_is_owner;
+    std::size_t m_size;
+    header* m_header;
+    T* m_buffer;
+    std::uint64_t m_consumed_cache; /* process local, used by the producer */
+    std::uint64_t m_produced_cache; /* process local, used by the consumer */
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _SHM_RINGBUFFER_HPP_ */
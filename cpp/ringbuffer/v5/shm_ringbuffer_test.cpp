@@ -0,0 +1,259 @@
+/**
+ * @file shm_ringbuffer_test.cpp
+ *
+ * Test procedures for 'shm_ringbuffer' implementation.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "shm_ringbuffer.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 100000
+#define SHM_NAME "/shm_ringbuffer_test"
+
+#define TEST_CROSS_PROCESS(CAPACITY, N, FLAGS, NAME)                                         \
+TEST(shm_ringbuffer, cross_process_capacity_##CAPACITY##_batch_##N##_##NAME)                 \
+{                                                                                            \
+    lts::shm_ringbuffer<size_t> rb(CAPACITY, FLAGS);                                         \
+    ASSERT_TRUE(rb.is_valid());                                                              \
+                                                                                             \
+    pid_t pid = fork();                                                                      \
+    ASSERT_GE(pid, 0);                                                                       \
+    if (0 == pid)                                                                            \
+        _exit(child_producer<N>(rb.fd()));                                                   \
+                                                                                             \
+    consumer<N>(rb);                                                                         \
+                                                                                             \
+    int wstatus;                                                                             \
+    ASSERT_EQ(pid, waitpid(pid, &wstatus, 0));                                               \
+    EXPECT_TRUE(WIFEXITED(wstatus));                                                         \
+    EXPECT_EQ(EXIT_SUCCESS, WEXITSTATUS(wstatus));                                           \
+                                                                                             \
+    std::cout << static_cast<std::string>(rb) << std::endl;                                  \
+}
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+template<size_t N> static int child_producer(int fd);
+template<size_t N> static void consumer(lts::shm_ringbuffer<size_t>& rb);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(shm_ringbuffer, create)
+{
+    lts::shm_ringbuffer<size_t> rb(5, RINGBUFFER_RD_BLOCKING_WR_NONBLOCKING);
+    ASSERT_TRUE(rb.is_valid());
+    EXPECT_EQ(5U, rb.capacity());
+    EXPECT_EQ(RINGBUFFER_RD_BLOCKING_WR_NONBLOCKING, rb.flags());
+    std::cout << static_cast<std::string>(rb) << std::endl;
+
+    lts::shm_ringbuffer<size_t> attached(rb.fd());
+    ASSERT_TRUE(attached.is_valid());
+    EXPECT_EQ(5U, attached.capacity());
+    EXPECT_EQ(RINGBUFFER_RD_BLOCKING_WR_NONBLOCKING, attached.flags());
+    std::cout << static_cast<std::string>(attached) << std::endl;
+
+    lts::shm_ringbuffer<uint32_t> mismatched(rb.fd());
+    EXPECT_FALSE(mismatched.is_valid());
+
+    lts::shm_ringbuffer<size_t> invalid(-1);
+    EXPECT_FALSE(invalid.is_valid());
+    std::cout << static_cast<std::string>(invalid) << std::endl;
+
+    size_t value = 0;
+    EXPECT_EQ(0U, invalid.capacity());
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INTERNAL_ERROR), invalid.write(value));
+    EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::INTERNAL_ERROR), invalid.read(value));
+    EXPECT_EQ(lts::ringbuffer_status::INTERNAL_ERROR, invalid.get_counters(nullptr, nullptr, nullptr));
+    invalid.cancel(lts::ringbuffer_role::CONSUMER);
+}
+
+TEST(shm_ringbuffer, attach_by_name)
+{
+    {
+        lts::shm_ringbuffer<size_t> rb(4, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, SHM_NAME);
+        ASSERT_TRUE(rb.is_valid());
+
+        lts::shm_ringbuffer<size_t> duplicate(4, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, SHM_NAME);
+        EXPECT_FALSE(duplicate.is_valid());
+
+        lts::shm_ringbuffer<size_t> attached(SHM_NAME);
+        ASSERT_TRUE(attached.is_valid());
+
+        size_t in[] = {0, 1, 2, 3, 4};
+        size_t out[5] = {};
+        size_t produced, consumed, dropped;
+
+        EXPECT_EQ(4, rb.write(in));
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), rb.write(in[4]));
+        EXPECT_EQ(4, attached.read(out));
+        for (size_t i = 0; i < 4; ++i)
+            EXPECT_EQ(i, out[i]);
+        EXPECT_EQ(static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK), attached.read(out[0]));
+
+        EXPECT_EQ(lts::ringbuffer_status::OK, attached.get_counters(&produced, &consumed, &dropped));
+        EXPECT_EQ(4U, produced);
+        EXPECT_EQ(4U, consumed);
+        EXPECT_EQ(1U, dropped);
+    }
+
+    /* the name is removed together with its creator */
+    lts::shm_ringbuffer<size_t> attached(SHM_NAME);
+    EXPECT_FALSE(attached.is_valid());
+}
+
+TEST(shm_ringbuffer, cancel)
+{
+    lts::shm_ringbuffer<size_t> rb(1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING);
+    ASSERT_TRUE(rb.is_valid());
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (0 == pid) {
+        lts::shm_ringbuffer<size_t> attached(rb.fd());
+        size_t value;
+        _exit(static_cast<long>(lts::ringbuffer_status::OPERATION_CANCELLED) == attached.read(value) ?
+            EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    rb.cancel(lts::ringbuffer_role::CONSUMER);
+
+    int wstatus;
+    ASSERT_EQ(pid, waitpid(pid, &wstatus, 0));
+    EXPECT_TRUE(WIFEXITED(wstatus));
+    EXPECT_EQ(EXIT_SUCCESS, WEXITSTATUS(wstatus));
+}
+
+TEST_CROSS_PROCESS(   1,  1, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_CROSS_PROCESS(  64,  7, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+TEST_CROSS_PROCESS(1000, 16, RINGBUFFER_RD_BLOCKING_WR_BLOCKING, blocking)
+
+TEST_CROSS_PROCESS(  64,  7, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+TEST_CROSS_PROCESS(1000, 16, RINGBUFFER_RD_NONBLOCKING_WR_NONBLOCKING, nonblocking)
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+/* Runs in a forked process, thus it does not use gtest assertions
+but reports the outcome with its exit status. */
+template<size_t N>
+static int child_producer(int fd)
+{
+    lts::shm_ringbuffer<size_t> rb(fd);
+    size_t array[N];
+    size_t produced = 0;
+    long status;
+
+    if (!rb.is_valid())
+        return EXIT_FAILURE;
+
+    while (produced < ITERATIONS) {
+        size_t count = std::min<size_t>(N, ITERATIONS - produced);
+        for (size_t i = 0; i < count; ++i)
+            array[i] = produced + i;
+        status = rb.write(array, count);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (status <= 0)
+            return EXIT_FAILURE;
+        produced += status;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+template<size_t N>
+static void consumer(lts::shm_ringbuffer<size_t>& rb)
+{
+    size_t array[N];
+    size_t consumed = 0;
+    long status;
+
+    while (consumed < ITERATIONS) {
+        status = rb.read(array);
+        if (static_cast<long>(lts::ringbuffer_status::WOULD_BLOCK) == status) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_GT(status, 0);
+        for (long i = 0; i < status; ++i)
+            ASSERT_EQ(consumed + i, array[i]);
+        consumed += status;
+    }
+
+    EXPECT_EQ(ITERATIONS, consumed);
+}
@@ -0,0 +1,215 @@
+/**
+ * @file adaptive_spin.hpp
+ *
+ * Spin phase shared by the binary semaphores. A waiter spins for a bounded
+ * number of iterations before it is parked. The bound is either fixed
+ * or adapted from recent waits: it follows the number of iterations
+ * which were actually needed, grows after short parks and shrinks after long ones.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _ADAPTIVE_SPIN_HPP_
+#define _ADAPTIVE_SPIN_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../../utils/futex.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* every that many iterations a spinning thread yields the cpu instead of pausing */
+#if !defined(ADAPTIVE_SPIN_YIELD_INTERVAL)
+#define ADAPTIVE_SPIN_YIELD_INTERVAL 64
+#endif
+
+/* adaptive bound never drops below that many iterations */
+#if !defined(ADAPTIVE_SPIN_MIN)
+#define ADAPTIVE_SPIN_MIN 16
+#endif
+
+/* parks shorter than that would rather have been spun through */
+#if !defined(ADAPTIVE_SPIN_SHORT_WAIT_NS)
+#define ADAPTIVE_SPIN_SHORT_WAIT_NS 50000
+#endif
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+class adaptive_spin
+{
+public:
+    explicit adaptive_spin(unsigned int spin_count = 0, bool adaptive = false) :
+       m_spin_count{spin_count},
+       m_spin_limit{spin_count},
+       m_adaptive{adaptive},
+       m_spun{0},
+       m_parked{0}
+    {
+    }
+
+    ~adaptive_spin() = default;
+
+    adaptive_spin(const adaptive_spin&) = delete;
+    adaptive_spin(adaptive_spin&&) = delete;
+
+    adaptive_spin& operator = (const adaptive_spin&) = delete;
+    adaptive_spin& operator = (adaptive_spin&&) = delete;
+
+    /**
+     * Sets the maximum number of iterations a waiter spins before it is parked.
+     */
+    void set_spin_count(unsigned int spin_count)
+    {
+        m_spin_count.store(spin_count, std::memory_order_relaxed);
+        m_spin_limit.store(spin_count, std::memory_order_relaxed);
+    }
+
+    unsigned int get_spin_count() const
+    {
+        return m_spin_count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Enables/disables adaptation of the bound (within [ADAPTIVE_SPIN_MIN, spin_count]).
+     */
+    void set_adaptive(bool adaptive)
+    {
+        m_adaptive.store(adaptive, std::memory_order_relaxed);
+        m_spin_limit.store(get_spin_count(), std::memory_order_relaxed);
+    }
+
+    bool is_adaptive() const
+    {
+        return m_adaptive.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the bound the next spin phase will use.
+     */
+    unsigned int get_spin_limit() const
+    {
+        return is_adaptive() ? m_spin_limit.load(std::memory_order_relaxed) : get_spin_count();
+    }
+
+    /**
+     * Retrieves number of waits satisfied while spinning and number of waits
+     * which had to park the calling thread.
+     */
+    void get_counters(std::size_t* spun, std::size_t* parked) const
+    {
+        if (spun)
+            *spun = m_spun.load(std::memory_order_relaxed);
+        if (parked)
+            *parked = m_parked.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Spins until 'try_acquire' succeeds or the bound is exhausted.
+     *
+     * @return true if 'try_acquire' succeeded, false if the caller shall park.
+     */
+    template<typename F>
+    bool spin(F&& try_acquire)
+    {
+        const unsigned int limit = get_spin_limit();
+
+        for (unsigned int i = 1; i <= limit; ++i) {
+            if ((i % ADAPTIVE_SPIN_YIELD_INTERVAL) == 0)
+                std::this_thread::yield();
+            else
+                cpu_relax();
+
+            if (try_acquire()) {
+                m_spun.fetch_add(1, std::memory_order_relaxed);
+                if (is_adaptive())
+                    /* moves the bound 1/8 of the way towards twice what was needed */
+                    update_limit(limit - limit / 8 + (2 * i) / 8);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Records that a waiter was parked for 'duration'.
+     */
+    void parked(std::chrono::steady_clock::duration duration)
+    {
+        m_parked.fetch_add(1, std::memory_order_relaxed);
+
+        if (is_adaptive()) {
+            const unsigned int limit = m_spin_limit.load(std::memory_order_relaxed);
+            if (duration < std::chrono::nanoseconds(ADAPTIVE_SPIN_SHORT_WAIT_NS))
+                update_limit(2 * limit);
+            else
+                update_limit(limit / 2);
+        }
+    }
+
+private:
+    void update_limit(unsigned int limit)
+    {
+        const unsigned int spin_count = get_spin_count();
+        limit = std::max<unsigned int>(limit, std::min<unsigned int>(ADAPTIVE_SPIN_MIN, spin_count));
+        m_spin_limit.store(std::min(limit, spin_count), std::memory_order_relaxed);
+    }
+
+    std::atomic<unsigned int> m_spin_count; /* upper bound */
+    std::atomic<unsigned int> m_spin_limit; /* current bound (when adaptive) */
+    std::atomic<bool> m_adaptive;
+    std::atomic<std::size_t> m_spun;
+    std::atomic<std::size_t> m_parked;
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _ADAPTIVE_SPIN_HPP_ */
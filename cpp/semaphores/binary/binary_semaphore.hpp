@@ -25,10 +25,13 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <atomic>
 
 /*===========================================================================*\
  * project header files
 \*===========================================================================*/
+#include "adaptive_spin.hpp"
+#include "../waiter/waiter.hpp"
 
 /*===========================================================================*\
  * preprocessor #define constants and macros
@@ -43,10 +46,12 @@ namespace lts
 class binary_semaphore
 {
 public:
-    explicit binary_semaphore(bool ready = false) :
+    explicit binary_semaphore(bool ready = false, unsigned int spin_count = 0, bool adaptive = false) :
        m_mutex{},
        m_condvar{},
-       m_ready{ready}
+       m_ready{ready},
+       m_spin{spin_count, adaptive},
+       m_waiter_list{}
     {
     }
 
@@ -60,14 +65,43 @@ public:
 
     bool get_value() const
     {
-        bool ready;
+        return m_ready.load(std::memory_order_acquire);
+    }
 
-        do {
-            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
-            ready = m_ready;
-        } while (0);
+    /**
+     * Sets number of iterations wait() spins before it parks the calling thread
+     * (upper bound of it when adaptive).
+     */
+    void set_spin_count(unsigned int spin_count)
+    {
+        m_spin.set_spin_count(spin_count);
+    }
 
-        return ready;
+    unsigned int get_spin_count() const
+    {
+        return m_spin.get_spin_count();
+    }
+
+    /**
+     * Lets the spin bound follow recent wait times.
+     */
+    void set_adaptive(bool adaptive)
+    {
+        m_spin.set_adaptive(adaptive);
+    }
+
+    bool is_adaptive() const
+    {
+        return m_spin.is_adaptive();
+    }
+
+    /**
+     * Retrieves number of waits satisfied while spinning
+     * and number of waits which parked the calling thread.
+     */
+    void get_counters(std::size_t* spun, std::size_t* parked) const
+    {
+        m_spin.get_counters(spun, parked);
     }
 
     /**
@@ -82,11 +116,12 @@ public:
     {
         do {
             std::lock_guard<decltype(m_mutex)> lock(m_mutex);
-            m_ready = true;
+            m_ready.store(true, std::memory_order_seq_cst);
         } while (0);
 
         /* the lock does not need to be held for notification */
         m_condvar.notify_one();
+        m_waiter_list.notify();
     }
 
     /**
@@ -94,19 +129,28 @@ public:
      *
      * If the semaphore is unlocked, then locking proceeds,
      * and the function returns immediately.
-     * If the semaphore is currently locked, then the call blocks
-     * until the semaphore is unlocked (post() is issued).
+     * If the semaphore is currently locked, then the call spins
+     * (if configured so) and then blocks until the semaphore is unlocked (post() is issued).
      *
      * @return none
      */
     void wait()
     {
-        std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+        if (try_wait() || spin())
+            return;
 
-        while (!m_ready)
-            m_condvar.wait(lock);
+        const std::chrono::steady_clock::time_point t1(std::chrono::steady_clock::now());
+
+        do {
+            std::unique_lock<decltype(m_mutex)> lock(m_mutex);
 
-        m_ready = false;
+            while (!m_ready.load(std::memory_order_relaxed))
+                m_condvar.wait(lock);
+
+            m_ready.store(false, std::memory_order_relaxed);
+        } while (0);
+
+        m_spin.parked(std::chrono::steady_clock::now() - t1);
     }
 
     /**
@@ -129,9 +173,15 @@ public:
         const std::chrono::milliseconds timeout(milliseconds);
         std::chrono::milliseconds elapsed(0);
 
+        if (try_wait() || spin())
+            return true;
+
+        /* the timeout covers the spin phase, the park duration does not */
+        const std::chrono::steady_clock::time_point parked_since(std::chrono::steady_clock::now());
+
         std::unique_lock<decltype(m_mutex)> lock(m_mutex);
 
-        while (!m_ready) {
+        while (!m_ready.load(std::memory_order_relaxed)) {
             if (elapsed >= timeout)
                 return false;
 
@@ -142,14 +192,55 @@ public:
             elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1);
         }
 
-        m_ready = false;
+        m_ready.store(false, std::memory_order_relaxed);
+        m_spin.parked(std::chrono::steady_clock::now() - parked_since);
+        return true;
+    }
+
+    /**
+     * Tries to lock the semaphore without blocking.
+     *
+     * @return true if the semaphore was unlocked (and now is locked),
+     *         false otherwise.
+     */
+    bool try_wait()
+    {
+        if (!m_ready.load(std::memory_order_relaxed))
+            return false;
+
+        std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+
+        if (!m_ready.load(std::memory_order_relaxed))
+            return false;
+
+        m_ready.store(false, std::memory_order_relaxed);
         return true;
     }
 
+    /**
+     * Attaches/detaches a waiter notified on every post() (see wait_any()).
+     */
+    void attach_waiter(waiter* w)
+    {
+        m_waiter_list.attach(w);
+    }
+
+    void detach_waiter(waiter* w)
+    {
+        m_waiter_list.detach(w);
+    }
+
 private:
+    bool spin()
+    {
+        return m_spin.spin([this]() { return try_wait(); });
+    }
+
     mutable std::mutex m_mutex;
     std::condition_variable m_condvar;
-    bool m_ready;
+    std::atomic<bool> m_ready; /* written under m_mutex, may be polled without it */
+    adaptive_spin m_spin;
+    waiter_list m_waiter_list; /* multi-waiters (wait_any()) */
 };
 
 } /* end of namespace lts */
@@ -36,6 +36,8 @@
  * preprocessor #define constants and macros
 \*===========================================================================*/
 #define WAIT_TIMEOUT_MSEC 200
+#define SPIN_COUNT 1000U
+#define PING_PONG_ITERATIONS 10000
 
 /*===========================================================================*\
  * local type definitions
@@ -162,6 +164,118 @@ TEST(binary_semaphore, wait_timeout)
     EXPECT_FALSE(sem.wait_timeout(WAIT_TIMEOUT_MSEC));
 }
 
+TEST(binary_semaphore, try_wait)
+{
+    lts::binary_semaphore sem(true);
+
+    EXPECT_TRUE(sem.try_wait());
+    EXPECT_FALSE(sem.try_wait());
+
+    sem.post();
+    sem.post();
+    EXPECT_TRUE(sem.get_value());
+    EXPECT_TRUE(sem.try_wait());
+    EXPECT_FALSE(sem.get_value());
+}
+
+TEST(binary_semaphore, spin_then_park)
+{
+    lts::binary_semaphore ping(false, SPIN_COUNT);
+    lts::binary_semaphore pong(false, SPIN_COUNT, true);
+    std::size_t spun, parked;
+
+    ASSERT_EQ(SPIN_COUNT, ping.get_spin_count());
+    ASSERT_FALSE(ping.is_adaptive());
+    ASSERT_TRUE(pong.is_adaptive());
+
+    std::thread t1 {[](lts::binary_semaphore* ping, lts::binary_semaphore* pong){
+        for (int i = 0; i < PING_PONG_ITERATIONS; ++i) {
+            ping->wait();
+            pong->post();
+        }
+    }, &ping, &pong};
+
+    for (int i = 0; i < PING_PONG_ITERATIONS; ++i) {
+        ping.post();
+        pong.wait();
+    }
+
+    t1.join();
+
+    /* every wait was satisfied right away, while spinning or after being parked */
+    ping.get_counters(&spun, &parked);
+    EXPECT_LE(spun + parked, static_cast<std::size_t>(PING_PONG_ITERATIONS));
+    pong.get_counters(&spun, &parked);
+    EXPECT_LE(spun + parked, static_cast<std::size_t>(PING_PONG_ITERATIONS));
+    std::cout << "pong spun: " << spun << ", parked: " << parked << std::endl;
+
+    ping.set_spin_count(0);
+    EXPECT_EQ(0U, ping.get_spin_count());
+}
+
+TEST(binary_semaphore, parked_counter)
+{
+    lts::binary_semaphore sem(false, SPIN_COUNT, true);
+    std::size_t spun, parked;
+
+    std::thread t1 {[](lts::binary_semaphore* sem){
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 10));
+        sem->post();
+    }, &sem};
+
+    sem.wait();
+    t1.join();
+
+    sem.get_counters(&spun, &parked);
+    EXPECT_EQ(0U, spun);
+    EXPECT_EQ(1U, parked);
+
+    /* an unlocked semaphore is taken without spinning */
+    sem.post();
+    sem.wait();
+    sem.get_counters(&spun, &parked);
+    EXPECT_EQ(0U, spun);
+    EXPECT_EQ(1U, parked);
+}
+
+TEST(adaptive_spin, bound_follows_waits)
+{
+    lts::adaptive_spin spin(SPIN_COUNT);
+    std::size_t spun, parked;
+    unsigned int n = 0;
+
+    /* fixed bound */
+    EXPECT_FALSE(spin.is_adaptive());
+    EXPECT_FALSE(spin.spin([]() { return false; }));
+    spin.parked(std::chrono::seconds(1));
+    EXPECT_EQ(SPIN_COUNT, spin.get_spin_limit());
+
+    spin.set_adaptive(true);
+    EXPECT_EQ(SPIN_COUNT, spin.get_spin_limit());
+
+    /* long parks shrink the bound down to the minimum */
+    for (int i = 0; i < 32; ++i)
+        spin.parked(std::chrono::seconds(1));
+    EXPECT_EQ(static_cast<unsigned int>(ADAPTIVE_SPIN_MIN), spin.get_spin_limit());
+
+    /* short ones grow it back up to the spin count */
+    for (int i = 0; i < 32; ++i)
+        spin.parked(std::chrono::nanoseconds(1));
+    EXPECT_EQ(SPIN_COUNT, spin.get_spin_limit());
+
+    /* quick successes pull it towards twice the number of iterations needed */
+    for (int i = 0; i < 64; ++i) {
+        n = 0;
+        EXPECT_TRUE(spin.spin([&n]() { return ++n == 10; }));
+    }
+    EXPECT_LT(spin.get_spin_limit(), SPIN_COUNT / 4);
+    EXPECT_GE(spin.get_spin_limit(), static_cast<unsigned int>(ADAPTIVE_SPIN_MIN));
+
+    spin.get_counters(&spun, &parked);
+    EXPECT_EQ(64U, spun);
+    EXPECT_EQ(65U, parked);
+}
+
 } // end of anonymous namespace
 
 int main(int argc, char *argv[])
@@ -0,0 +1,254 @@
+/**
+ * @file futex_binary_semaphore.hpp
+ *
+ * Class representing/implementing a binary_semaphore design pattern
+ * on top of a futex word.
+ *
+ * Contrary to lts::binary_semaphore, post() neither takes a lock
+ * nor enters the kernel unless there is a thread sleeping in wait().
+ * Optionally, wait() spins for a bounded (fixed or adaptive) number of iterations
+ * before parking the calling thread.
+ * When created as 'shared' it may be placed in memory shared between processes.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _FUTEX_BINARY_SEMAPHORE_HPP_
+#define _FUTEX_BINARY_SEMAPHORE_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../../utils/futex.hpp"
+#include "adaptive_spin.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+class futex_binary_semaphore
+{
+public:
+    explicit futex_binary_semaphore(bool ready = false, unsigned int spin_count = 0, bool shared = false, bool adaptive = false) :
+       m_state{ready ? READY : NOT_READY},
+       m_spin{spin_count, adaptive},
+       m_shared{shared}
+    {
+    }
+
+    ~futex_binary_semaphore() = default;
+
+    futex_binary_semaphore(const futex_binary_semaphore&) = delete;
+    futex_binary_semaphore(futex_binary_semaphore&&) = delete;
+
+    futex_binary_semaphore& operator = (const futex_binary_semaphore&) = delete;
+    futex_binary_semaphore& operator = (futex_binary_semaphore&&) = delete;
+
+    bool get_value() const
+    {
+        return m_state.load(std::memory_order_acquire) == READY;
+    }
+
+    /**
+     * Sets number of iterations wait() spins before it parks the calling thread
+     * (upper bound of it when adaptive).
+     */
+    void set_spin_count(unsigned int spin_count)
+    {
+        m_spin.set_spin_count(spin_count);
+    }
+
+    unsigned int get_spin_count() const
+    {
+        return m_spin.get_spin_count();
+    }
+
+    /**
+     * Lets the spin bound follow recent wait times.
+     */
+    void set_adaptive(bool adaptive)
+    {
+        m_spin.set_adaptive(adaptive);
+    }
+
+    bool is_adaptive() const
+    {
+        return m_spin.is_adaptive();
+    }
+
+    /**
+     * Retrieves number of waits satisfied while spinning
+     * and number of waits which parked the calling thread.
+     */
+    void get_counters(std::size_t* spun, std::size_t* parked) const
+    {
+        m_spin.get_counters(spun, parked);
+    }
+
+    /**
+     * Unlocks the semaphore.
+     *
+     * If some of the threads were waiting for being notified by a call
+     * to this function then any (but only one) of them will be chosen and woken up.
+     * The wake-up system call is issued only when there is a sleeping thread.
+     *
+     * @return none
+     */
+    void post()
+    {
+        /* Always a read-modify-write: a plain load of READY could be stale
+        (ordered before the caller's preceding stores become visible) while
+        a waiter has just locked the semaphore and is about to sleep. */
+        if (m_state.exchange(READY, std::memory_order_acq_rel) == SLEEPING)
+            futex_wake(&m_state, 1, m_shared);
+    }
+
+    /**
+     * Locks the semaphore.
+     *
+     * If the semaphore is unlocked, then locking proceeds,
+     * and the function returns immediately.
+     * If the semaphore is currently locked, then the call spins
+     * (if configured so) and then blocks until the semaphore is unlocked (post() is issued).
+     *
+     * @return none
+     */
+    void wait()
+    {
+        if (try_wait() || spin())
+            return;
+
+        const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+        /* Having slept once we cannot tell whether there are other sleepers,
+        thus the semaphore is always left in SLEEPING state (instead of NOT_READY)
+        which costs at most one spurious wake-up in post(). */
+        while (m_state.exchange(SLEEPING, std::memory_order_acquire) != READY)
+            futex_wait(&m_state, SLEEPING, nullptr, m_shared);
+
+        m_spin.parked(std::chrono::steady_clock::now() - t1);
+    }
+
+    /**
+     * Locks the semaphore with timeout semantics.
+     *
+     * If the semaphore is unlocked, then locking proceeds,
+     * and the function returns immediately.
+     * If the semaphore is currently locked, then the call blocks
+     * until the semaphore is unlocked (post() is issued)
+     * or limit on the amount of time that the call should block expires.
+     *
+     * @param[in] milliseconds Represents the maximum time to spend waiting.
+     *
+     * @return false when the function returns because timeout has passed,
+     *         true otherwise.
+     */
+    bool wait_timeout(unsigned int milliseconds)
+    {
+        const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+
+        if (try_wait() || spin())
+            return true;
+
+        const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+        while (m_state.exchange(SLEEPING, std::memory_order_acquire) != READY) {
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                return false;
+
+            const std::chrono::nanoseconds remaining = deadline - now;
+            const struct timespec timeout = {
+                static_cast<time_t>(remaining.count() / 1000000000),
+                static_cast<long>(remaining.count() % 1000000000)
+            };
+
+            futex_wait(&m_state, SLEEPING, &timeout, m_shared);
+        }
+
+        m_spin.parked(std::chrono::steady_clock::now() - t1);
+        return true;
+    }
+
+    /**
+     * Tries to lock the semaphore without blocking.
+     *
+     * @return true if the semaphore was unlocked (and now is locked),
+     *         false otherwise.
+     */
+    bool try_wait()
+    {
+        std::uint32_t expected = READY;
+        return m_state.compare_exchange_strong(expected, NOT_READY, std::memory_order_acquire);
+    }
+
+private:
+    bool spin()
+    {
+        return m_spin.spin([this]() {
+            return (m_state.load(std::memory_order_relaxed) == READY) && try_wait();
+        });
+    }
+
+    enum : std::uint32_t
+    {
+        NOT_READY = 0, /* locked, nobody sleeps */
+        READY = 1,     /* unlocked */
+        SLEEPING = 2,  /* locked, there might be sleeping threads */
+    };
+
+    std::atomic<std::uint32_t> m_state;
+    adaptive_spin m_spin;
+    const bool m_shared; /* futex word may be shared between processes */
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _FUTEX_BINARY_SEMAPHORE_HPP_ */
@@ -0,0 +1,248 @@
+/**
+ * @file futex_binary_semaphore_test.cpp
+ *
+ * Test procedures for 'futex_binary_semaphore' type.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "futex_binary_semaphore.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define WAIT_TIMEOUT_MSEC 200
+#define SPIN_COUNT 1000U
+#define PING_PONG_ITERATIONS 10000
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(futex_binary_semaphore, create_on_stack)
+{
+    lts::futex_binary_semaphore sem(false);
+
+    ASSERT_EQ(false, sem.get_value());
+
+    std::thread t1 {[](lts::futex_binary_semaphore* sem){
+        sem->post();
+        sem->wait();
+        sem->post();
+        sem->wait_timeout(WAIT_TIMEOUT_MSEC);
+        sem->post();
+    }, &sem};
+
+    std::thread t2 {[](lts::futex_binary_semaphore& sem){
+        sem.wait();
+        sem.post();
+        sem.wait_timeout(WAIT_TIMEOUT_MSEC);
+        sem.post();
+        sem.wait();
+    }, std::ref(sem)};
+
+    t1.join();
+    t2.join();
+}
+
+TEST(futex_binary_semaphore, create_on_heap)
+{
+    lts::futex_binary_semaphore *sem = new (std::nothrow) lts::futex_binary_semaphore(false);
+
+    ASSERT_EQ(false, sem->get_value());
+
+    std::thread t1 {[](lts::futex_binary_semaphore* sem){
+        sem->post();
+        sem->wait();
+        sem->post();
+        sem->wait_timeout(WAIT_TIMEOUT_MSEC);
+        sem->post();
+    }, sem};
+
+    std::thread t2 {[](lts::futex_binary_semaphore& sem){
+        sem.wait();
+        sem.post();
+        sem.wait_timeout(WAIT_TIMEOUT_MSEC);
+        sem.post();
+        sem.wait();
+    }, std::ref(*sem)};
+
+    t1.join();
+    t2.join();
+
+    delete sem;
+}
+
+TEST(futex_binary_semaphore, wait_interrupted)
+{
+    lts::futex_binary_semaphore sem(false);
+
+    ASSERT_EQ(false, sem.get_value());
+
+    std::thread t1 {[](lts::futex_binary_semaphore* sem){
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 2));
+        sem->post();
+    }, &sem};
+
+    sem.wait();
+
+    t1.join();
+}
+
+TEST(futex_binary_semaphore, wait_timeout_interrupted)
+{
+    lts::futex_binary_semaphore sem(false);
+
+    ASSERT_EQ(false, sem.get_value());
+
+    std::thread t1 {[](lts::futex_binary_semaphore* sem){
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 2));
+        sem->post();
+    }, &sem};
+
+    EXPECT_TRUE(sem.wait_timeout(WAIT_TIMEOUT_MSEC));
+
+    t1.join();
+}
+
+TEST(futex_binary_semaphore, wait_timeout)
+{
+    lts::futex_binary_semaphore sem(false);
+
+    ASSERT_EQ(false, sem.get_value());
+
+    EXPECT_FALSE(sem.wait_timeout(WAIT_TIMEOUT_MSEC));
+}
+
+TEST(futex_binary_semaphore, try_wait)
+{
+    lts::futex_binary_semaphore sem(true);
+
+    ASSERT_EQ(true, sem.get_value());
+
+    EXPECT_TRUE(sem.try_wait());
+    EXPECT_FALSE(sem.try_wait());
+
+    sem.post();
+    sem.post();
+    EXPECT_TRUE(sem.get_value());
+    EXPECT_TRUE(sem.try_wait());
+    EXPECT_FALSE(sem.get_value());
+}
+
+TEST(futex_binary_semaphore, spin_then_park)
+{
+    lts::futex_binary_semaphore sem(false, SPIN_COUNT);
+
+    ASSERT_EQ(SPIN_COUNT, sem.get_spin_count());
+
+    std::thread t1 {[](lts::futex_binary_semaphore* sem){
+        for (int i = 0; i < PING_PONG_ITERATIONS; ++i) {
+            sem->post();
+            std::this_thread::yield();
+        }
+    }, &sem};
+
+    /* consecutive posts may coalesce, so the loop ends on the first timeout */
+    for (int i = 0; i < PING_PONG_ITERATIONS; ++i)
+        if (!sem.wait_timeout(WAIT_TIMEOUT_MSEC / 10))
+            break;
+
+    t1.join();
+
+    sem.set_spin_count(0);
+    EXPECT_EQ(0U, sem.get_spin_count());
+}
+
+TEST(futex_binary_semaphore, parked_counter)
+{
+    lts::futex_binary_semaphore sem(false, SPIN_COUNT, false, true);
+    std::size_t spun, parked;
+
+    ASSERT_TRUE(sem.is_adaptive());
+
+    std::thread t1 {[](lts::futex_binary_semaphore* sem){
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 10));
+        sem->post();
+    }, &sem};
+
+    EXPECT_TRUE(sem.wait_timeout(WAIT_TIMEOUT_MSEC));
+    t1.join();
+
+    sem.get_counters(&spun, &parked);
+    EXPECT_EQ(0U, spun);
+    EXPECT_EQ(1U, parked);
+
+    sem.set_adaptive(false);
+    EXPECT_FALSE(sem.is_adaptive());
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
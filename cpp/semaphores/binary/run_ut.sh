@@ -3,8 +3,8 @@
 set -e
 set -x
 
-UT_SRC='binary_semaphore.hpp'
-UT_BIN='binary_semaphore_test'
+UT_SRC='binary_semaphore.hpp futex_binary_semaphore.hpp adaptive_spin.hpp'
+UT_BIN='binary_semaphore_test futex_binary_semaphore_test'
 
 make clean
 make all
@@ -0,0 +1,252 @@
+/**
+ * @file pt.cpp
+ *
+ * Performance tests for semaphore (ping-pong latency and uncontended throughput).
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+#include <cstdlib>
+#include <cstdint>
+
+extern "C" {
+    #include <unistd.h>
+    #include <getopt.h>
+}
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../../utils/strtointeger.hpp"
+
+#include "semaphore.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define ITERATIONS 10000000
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+static void run_pingpong_test(std::size_t iterations);
+static void run_uncontended_test(std::size_t iterations, std::size_t bulk);
+static void report(const char* name, std::chrono::high_resolution_clock::duration elapsed, std::size_t operations);
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+static inline void pt_usage(const char* progname)
+{
+    std::cerr << "usage: " << progname << " [-p] [-u [-b bulk]] [-i iterations]" << std::endl;
+    std::cerr << " options: " << std::endl;
+    std::cerr << "  -p --pingpong                   : two threads bounce a token over a pair of semaphores" << std::endl;
+    std::cerr << "                                  : (measures wake-up latency)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -u --uncontended                : a single thread posts and takes the semaphore" << std::endl;
+    std::cerr << "                                  : (measures the cost of the fast path)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -b bulk --bulk=bulk             : number of units released by each post(n) (default: 1, requires -u)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "  -i --iterations                 : number of iteration (default: " << ITERATIONS << ")" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << " without -p and -u both tests are run" << std::endl;
+}
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+int main(int argc, char *argv[])
+{
+    bool status;
+    bool pingpong = false;
+    bool uncontended = false;
+    std::size_t bulk = 1;
+    std::size_t iterations = ITERATIONS;
+
+    static struct option long_options[] = {
+        {"pingpong",     no_argument,       0, 'p'},
+        {"uncontended",  no_argument,       0, 'u'},
+        {"bulk",         required_argument, 0, 'b'},
+        {"iterations",   required_argument, 0, 'i'},
+        {0,              0,                 0,  0 }
+    };
+
+    for (;;) {
+        int c = getopt_long(argc, argv, "pub:i:", long_options, 0);
+        if (-1 == c)
+            break;
+
+        switch(c) {
+            case 'p':
+                pingpong = true;
+                break;
+
+            case 'u':
+                uncontended = true;
+                break;
+
+            case 'b':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, bulk));
+                if (!status || (0 == bulk)) {
+                    std::cerr << "error: cannot convert '" << optarg << "' to positive integer" << std::endl;
+                    pt_usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
+            case 'i':
+                status = (lts::strtointeger_conversion_status_e::success == lts::strtointeger(optarg, iterations));
+                if (!status) {
+                    std::cerr << "error: cannot convert '" << optarg << "' to integer" << std::endl;
+                    pt_usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
+            default:
+                pt_usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!pingpong && !uncontended)
+        pingpong = uncontended = true;
+
+    if (pingpong)
+        run_pingpong_test(iterations);
+
+    if (uncontended)
+        run_uncontended_test(iterations, bulk);
+
+    return 0;
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
+static void run_pingpong_test(std::size_t iterations)
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> t1, t2;
+    lts::semaphore ping(0);
+    lts::semaphore pong(0);
+
+    std::cout << "ping-pong test started (round trips: " << iterations << ") ..." << std::endl;
+
+    t1 = std::chrono::high_resolution_clock::now();
+
+    std::thread peer {[&ping, &pong](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; ++i) {
+            ping.wait();
+            pong.post();
+        }
+    }, iterations};
+
+    for (std::size_t i = 0; i < iterations; ++i) {
+        ping.post();
+        pong.wait();
+    }
+
+    peer.join();
+
+    t2 = std::chrono::high_resolution_clock::now();
+
+    report("round trip", t2 - t1, iterations);
+}
+
+static void run_uncontended_test(std::size_t iterations, std::size_t bulk)
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> t1, t2;
+    lts::semaphore sem(0);
+    std::size_t operations = 0;
+
+    std::cout << "uncontended test started (iterations: " << iterations << ", bulk: " << bulk << ") ..." << std::endl;
+
+    /* post()/wait() pairs, the count never drops to zero while waiting */
+    t1 = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        sem.post();
+        sem.wait();
+    }
+    t2 = std::chrono::high_resolution_clock::now();
+    report("post/wait", t2 - t1, 2 * iterations);
+
+    /* every other try_wait() finds the count exhausted */
+    t1 = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        sem.post();
+        operations += sem.try_wait();
+        operations += sem.try_wait();
+    }
+    t2 = std::chrono::high_resolution_clock::now();
+    if (operations != iterations)
+        std::cerr << "error: try_wait() succeeded " << operations << " times instead of " << iterations << std::endl;
+    report("post/try_wait", t2 - t1, 3 * iterations);
+
+    /* bulk release followed by the same number of single acquisitions */
+    t1 = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < iterations; i += bulk) {
+        sem.post(bulk);
+        for (std::size_t n = 0; n < bulk; ++n)
+            sem.wait();
+    }
+    t2 = std::chrono::high_resolution_clock::now();
+    report("post(n)/wait", t2 - t1, iterations);
+}
+
+static void report(const char* name, std::chrono::high_resolution_clock::duration elapsed, std::size_t operations)
+{
+    uint64_t duration = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+    std::cout << name << ": " << duration / 1000000 << "ms";
+    if (operations > 0)
+        std::cout << ", " << duration / operations << "ns/op";
+    if (duration > 0)
+        std::cout << ", " << static_cast<uint64_t>(operations * 1e9 / duration) << " ops/s";
+    std::cout << std::endl;
+}
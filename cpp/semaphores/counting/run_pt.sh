@@ -0,0 +1,14 @@
+#!/bin/bash
+
+set -e
+set -x
+
+make clean
+make all
+
+perf stat -e cycles,instructions,context-switches ./pt -p -i1000000
+
+for bulk in 1 16 256
+do
+    perf stat -e cycles,instructions,context-switches ./pt -u -b ${bulk} -i100000000
+done
@@ -1,7 +1,12 @@
 /**
  * @file semaphore.hpp
  *
- * Class representing/implementing a semaphore design pattern.
+ * Class representing/implementing a (counting) semaphore design pattern
+ * on top of a futex word.
+ *
+ * Uncontended post() and try_wait() are a single atomic operation each,
+ * a thread enters the kernel only to sleep on an exhausted count
+ * or to wake such a sleeper up.
  *
  * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
  *
@@ -21,14 +26,18 @@
 /*===========================================================================*\
  * system header files
 \*===========================================================================*/
-#include <type_traits>
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
 #include <chrono>
+#include <cassert>
+#include <cstdint>
+#include <climits>
 
 /*===========================================================================*\
  * project header files
 \*===========================================================================*/
+#include "../../utils/futex.hpp"
+#include "../../utils/utilities.hpp"
+#include "../waiter/waiter.hpp"
 
 /*===========================================================================*\
  * preprocessor #define constants and macros
@@ -43,11 +52,13 @@ namespace lts
 class semaphore
 {
 public:
+    /* The value is kept in a 32 bit futex word, thus it shall never exceed UINT32_MAX. */
     explicit semaphore(std::size_t count = 0) :
-       m_mutex{},
-       m_condvar{},
-       m_count{count}
+       m_count{static_cast<std::uint32_t>(count)},
+       m_waiters{0},
+       m_waiter_list{}
     {
+        assert(count <= UINT32_MAX);
     }
 
     ~semaphore() = default;
@@ -60,14 +71,7 @@ public:
 
     std::size_t get_value() const
     {
-        std::size_t count;
-
-        do {
-            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
-            count = m_count;
-        } while (0);
-
-        return count;
+        return m_count.load(std::memory_order_relaxed);
     }
 
     /**
@@ -75,18 +79,40 @@ public:
      *
      * If some of the threads were waiting for being notified by a call
      * to this function then any (but only one) of them will be chosen and woken up.
+     * The wake-up system call is issued only when there is a sleeping thread.
      *
      * @return none
      */
     void post()
     {
-        do {
-            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
-            m_count++;
-        } while (0);
+        post(1);
+    }
+
+    /**
+     * Increments the semaphore value by 'n'.
+     *
+     * Up to 'n' of the waiting threads are woken up with a single system call.
+     * The resulting value shall not exceed UINT32_MAX.
+     *
+     * @param[in] n Number of units to release.
+     *
+     * @return none
+     */
+    void post(std::size_t n)
+    {
+        if (n == 0)
+            return;
 
-        /* the lock does not need to be held for notification */
-        m_condvar.notify_one();
+        /* Pairs with the increment of m_waiters in sleep(): either we see the waiter
+        or the waiter sees the new count and does not go to sleep. */
+        const std::uint32_t count = m_count.fetch_add(static_cast<std::uint32_t>(n), std::memory_order_seq_cst);
+        assert(n <= UINT32_MAX - count); /* neither 'n' was truncated nor the value wrapped */
+        UNUSED(count);
+
+        if (m_waiters.load(std::memory_order_seq_cst) > 0)
+            futex_wake(&m_count, (n < INT_MAX) ? static_cast<int>(n) : INT_MAX);
+
+        m_waiter_list.notify();
     }
 
     /**
@@ -101,12 +127,25 @@ public:
      */
     void wait()
     {
-        std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+        while (!try_wait())
+            sleep(nullptr);
+    }
+
+    /**
+     * Decrements the semaphore value without blocking.
+     *
+     * @return true if the semaphore's value was greater than zero (and was decremented),
+     *         false otherwise.
+     */
+    bool try_wait()
+    {
+        std::uint32_t count = m_count.load(std::memory_order_relaxed);
 
-        while (m_count == 0)
-            m_condvar.wait(lock);
+        while (count > 0)
+            if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
 
-        m_count--;
+        return false;
     }
 
     /**
@@ -118,38 +157,79 @@ public:
      * until the semaphore value rises above zero (post() is issued)
      * or limit on the amount of time that the call should block expires.
      *
-     * @param[in] milliseconds Represents the maximum time to spend waiting.
+     * @param[in] timeout Represents the maximum time to spend waiting.
      *
      * @return false when the function returns because timeout has passed,
      *         true otherwise.
      */
-    bool wait_timeout(unsigned int milliseconds)
+    template<typename Rep, typename Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout)
     {
-        const std::chrono::steady_clock::time_point t1(std::chrono::steady_clock::now());
-        const std::chrono::milliseconds timeout(milliseconds);
-        std::chrono::milliseconds elapsed(0);
-
-        std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+        return wait_until(std::chrono::steady_clock::now() + timeout);
+    }
 
-        while (m_count == 0) {
-            if (elapsed >= timeout)
+    /**
+     * Same as wait_for() but the limit is given as an absolute point in time.
+     *
+     * @param[in] deadline Represents the point in time the waiting ends at.
+     *
+     * @return false when the function returns because deadline has passed,
+     *         true otherwise.
+     */
+    template<typename Clock, typename Duration>
+    bool wait_until(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        while (!try_wait()) {
+            const typename Clock::time_point now = Clock::now();
+            if (now >= deadline)
                 return false;
 
-            if (std::cv_status::timeout == m_condvar.wait_for(lock, timeout - elapsed))
-                return false;
+            const std::chrono::nanoseconds remaining =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+            const struct timespec timeout = {
+                static_cast<time_t>(remaining.count() / 1000000000),
+                static_cast<long>(remaining.count() % 1000000000)
+            };
 
-            const std::chrono::steady_clock::time_point t2(std::chrono::steady_clock::now());
-            elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1);
+            sleep(&timeout);
         }
 
-        m_count--;
         return true;
     }
 
+    /**
+     * Same as wait_for() with the timeout given in milliseconds.
+     */
+    bool wait_timeout(unsigned int milliseconds)
+    {
+        return wait_for(std::chrono::milliseconds(milliseconds));
+    }
+
+    /**
+     * Attaches/detaches a waiter notified on every post() (see wait_any()).
+     */
+    void attach_waiter(waiter* w)
+    {
+        m_waiter_list.attach(w);
+    }
+
+    void detach_waiter(waiter* w)
+    {
+        m_waiter_list.detach(w);
+    }
+
 private:
-    mutable std::mutex m_mutex;
-    std::condition_variable m_condvar;
-    std::size_t m_count;
+    void sleep(const struct timespec* timeout)
+    {
+        m_waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (m_count.load(std::memory_order_seq_cst) == 0)
+            futex_wait(&m_count, 0, timeout);
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::uint32_t> m_count;
+    std::atomic<std::uint32_t> m_waiters; /* threads which are about to sleep or sleep in futex_wait() */
+    waiter_list m_waiter_list; /* multi-waiters (wait_any()) */
 };
 
 } /* end of namespace lts */
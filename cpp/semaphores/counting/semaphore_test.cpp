@@ -177,6 +177,105 @@ TEST(semaphore, wait_timeout)
     EXPECT_FALSE(sem.wait_timeout(WAIT_TIMEOUT_MSEC));
 }
 
+TEST(semaphore, try_wait)
+{
+    lts::semaphore sem(2);
+
+    EXPECT_TRUE(sem.try_wait());
+    EXPECT_TRUE(sem.try_wait());
+    EXPECT_FALSE(sem.try_wait());
+    EXPECT_EQ(0U, sem.get_value());
+
+    sem.post();
+    EXPECT_EQ(1U, sem.get_value());
+    EXPECT_TRUE(sem.try_wait());
+}
+
+TEST(semaphore, wait_for_and_wait_until)
+{
+    lts::semaphore sem(1);
+
+    EXPECT_TRUE(sem.wait_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC)));
+
+    const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    EXPECT_FALSE(sem.wait_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4)));
+    EXPECT_GE(std::chrono::steady_clock::now() - t1, std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4));
+
+    EXPECT_FALSE(sem.wait_until(std::chrono::system_clock::now() + std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4)));
+    EXPECT_FALSE(sem.wait_until(std::chrono::steady_clock::now() - std::chrono::milliseconds(1)));
+
+    std::thread t {[](lts::semaphore& sem){
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4));
+        sem.post();
+    }, std::ref(sem)};
+
+    EXPECT_TRUE(sem.wait_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(4 * WAIT_TIMEOUT_MSEC)));
+
+    t.join();
+}
+
+TEST(semaphore, bulk_post)
+{
+    const std::size_t threads = 4;
+    lts::semaphore sem(0);
+    lts::semaphore done(0);
+    std::thread waiters[threads];
+
+    sem.post(0);
+    EXPECT_EQ(0U, sem.get_value());
+
+    for (auto& t : waiters)
+        t = std::thread{[&sem, &done](){
+            sem.wait();
+            done.post();
+        }};
+
+    /* one post(n) releases all the sleepers */
+    std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4));
+    sem.post(threads + 1);
+
+    for (std::size_t i = 0; i < threads; ++i)
+        EXPECT_TRUE(done.wait_timeout(4 * WAIT_TIMEOUT_MSEC));
+
+    for (auto& t : waiters)
+        t.join();
+
+    EXPECT_EQ(1U, sem.get_value());
+
+    /* the value may reach, but not exceed, UINT32_MAX */
+    sem.post(UINT32_MAX - 1);
+    EXPECT_EQ(static_cast<std::size_t>(UINT32_MAX), sem.get_value());
+    EXPECT_TRUE(sem.try_wait());
+    EXPECT_EQ(static_cast<std::size_t>(UINT32_MAX) - 1, sem.get_value());
+}
+
+TEST(semaphore, producer_consumer)
+{
+    const std::size_t iterations = 100000;
+    lts::semaphore items(0);
+    lts::semaphore slots(16);
+    std::size_t consumed = 0;
+
+    std::thread consumer {[&](){
+        for (std::size_t i = 0; i < iterations; ++i) {
+            items.wait();
+            consumed++;
+            slots.post();
+        }
+    }};
+
+    for (std::size_t i = 0; i < iterations; ++i) {
+        slots.wait();
+        items.post();
+    }
+
+    consumer.join();
+
+    EXPECT_EQ(iterations, consumed);
+    EXPECT_EQ(0U, items.get_value());
+    EXPECT_EQ(16U, slots.get_value());
+}
+
 } // end of anonymous namespace
 
 int main(int argc, char *argv[])
@@ -0,0 +1,190 @@
+/**
+ * @file wait_any_test.cpp
+ *
+ * Test procedures for 'wait_any' facility.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "waiter.hpp"
+#include "../counting/semaphore.hpp"
+#include "../binary/binary_semaphore.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define WAIT_TIMEOUT_MSEC 200
+#define ITERATIONS 100000
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(wait_any, ready_right_away)
+{
+    lts::semaphore sem(1);
+    lts::binary_semaphore bsem(true);
+
+    /* the first ready one in the argument order is taken */
+    EXPECT_EQ(0, lts::wait_any(sem, bsem));
+    EXPECT_EQ(1, lts::wait_any(sem, bsem));
+    EXPECT_EQ(0U, sem.get_value());
+    EXPECT_FALSE(bsem.get_value());
+
+    sem.post(2);
+    EXPECT_EQ(0, lts::wait_any(sem));
+    EXPECT_EQ(0, lts::wait_any_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC), sem, bsem));
+}
+
+TEST(wait_any, timeout)
+{
+    lts::semaphore sem(0);
+    lts::binary_semaphore bsem(false);
+
+    const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    EXPECT_EQ(-1, lts::wait_any_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4), sem, bsem));
+    EXPECT_GE(std::chrono::steady_clock::now() - t1, std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4));
+
+    EXPECT_EQ(-1, lts::wait_any_until(std::chrono::system_clock::now() + std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4), sem, bsem));
+    EXPECT_EQ(-1, lts::wait_any_for(std::chrono::milliseconds(-1), sem, bsem));
+}
+
+TEST(wait_any, woken_up_by_any)
+{
+    lts::semaphore sem(0);
+    lts::binary_semaphore bsem(false);
+
+    std::thread t1 {[&sem, &bsem](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4));
+        bsem.post();
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_TIMEOUT_MSEC / 4));
+        sem.post();
+    }};
+
+    EXPECT_EQ(1, lts::wait_any(sem, bsem));
+    EXPECT_EQ(0, lts::wait_any_for(std::chrono::milliseconds(4 * WAIT_TIMEOUT_MSEC), sem, bsem));
+
+    t1.join();
+}
+
+TEST(wait_any, two_producers)
+{
+    lts::semaphore sem1(0);
+    lts::semaphore sem2(0);
+    std::size_t taken[2] = {0, 0};
+
+    std::thread p1 {[&sem1](){
+        for (std::size_t i = 0; i < ITERATIONS; ++i)
+            sem1.post();
+    }};
+    std::thread p2 {[&sem2](){
+        for (std::size_t i = 0; i < ITERATIONS; i += 10)
+            sem2.post(10);
+    }};
+
+    for (std::size_t i = 0; i < 2 * ITERATIONS; ++i) {
+        long index = lts::wait_any(sem1, sem2);
+        ASSERT_TRUE((index == 0) || (index == 1));
+        taken[index]++;
+    }
+
+    p1.join();
+    p2.join();
+
+    EXPECT_EQ(static_cast<std::size_t>(ITERATIONS), taken[0]);
+    EXPECT_EQ(static_cast<std::size_t>(ITERATIONS), taken[1]);
+    EXPECT_EQ(0U, sem1.get_value());
+    EXPECT_EQ(0U, sem2.get_value());
+}
+
+TEST(wait_any, several_waiters)
+{
+    const std::size_t threads = 4;
+    lts::semaphore sem(0);
+    lts::binary_semaphore never(false);
+    std::thread waiters[threads];
+
+    for (auto& t : waiters)
+        t = std::thread{[&sem, &never](){
+            for (std::size_t i = 0; i < ITERATIONS / threads; ++i)
+                EXPECT_EQ(1, lts::wait_any(never, sem));
+        }};
+
+    for (std::size_t i = 0; i < ITERATIONS; ++i)
+        sem.post();
+
+    for (auto& t : waiters)
+        t.join();
+
+    EXPECT_EQ(0U, sem.get_value());
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
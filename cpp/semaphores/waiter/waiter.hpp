@@ -0,0 +1,327 @@
+/**
+ * @file waiter.hpp
+ *
+ * Lets a single thread block on several waitable objects at once
+ * (lts::semaphore, lts::binary_semaphore, ringbuffer readability, ...).
+ *
+ * A waitable provides try_wait(), attach_waiter(waiter*) and detach_waiter(waiter*).
+ * wait_any() attaches one shared waiter to all of them and sleeps on its futex word
+ * until any of them notifies it, so no thread per input and no busy polling is needed.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _WAITER_HPP_
+#define _WAITER_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../../utils/futex.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+class waiter
+{
+public:
+    explicit waiter() :
+       m_epoch{0},
+       m_sleeping{false}
+    {
+    }
+
+    ~waiter() = default;
+
+    waiter(const waiter&) = delete;
+    waiter(waiter&&) = delete;
+
+    waiter& operator = (const waiter&) = delete;
+    waiter& operator = (waiter&&) = delete;
+
+    /**
+     * Returns the current epoch, to be passed to wait() after
+     * the waitables were checked.
+     */
+    std::uint32_t epoch() const
+    {
+        return m_epoch.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Wakes up the thread sleeping in wait() (if any).
+     * The wake-up system call is issued only when there is a sleeping thread.
+     */
+    void notify()
+    {
+        /* Pairs with the store to m_sleeping in wait(): either we see the sleeper
+        or the sleeper sees the new epoch and does not go to sleep. */
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_seq_cst))
+            futex_wake(&m_epoch, 1);
+    }
+
+    /**
+     * Sleeps until notify() is called after 'epoch' was taken
+     * or 'deadline' (if given) passes.
+     *
+     * @return false when the deadline has passed, true otherwise.
+     */
+    bool wait(std::uint32_t epoch, const std::chrono::steady_clock::time_point* deadline = nullptr)
+    {
+        bool status = true;
+
+        m_sleeping.store(true, std::memory_order_seq_cst);
+
+        while (m_epoch.load(std::memory_order_seq_cst) == epoch) {
+            if (nullptr == deadline) {
+                futex_wait(&m_epoch, epoch);
+                continue;
+            }
+
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= *deadline) {
+                status = false;
+                break;
+            }
+
+            const std::chrono::nanoseconds remaining = *deadline - now;
+            const struct timespec timeout = {
+                static_cast<time_t>(remaining.count() / 1000000000),
+                static_cast<long>(remaining.count() % 1000000000)
+            };
+
+            futex_wait(&m_epoch, epoch, &timeout);
+        }
+
+        m_sleeping.store(false, std::memory_order_relaxed);
+
+        return status;
+    }
+
+private:
+    std::atomic<std::uint32_t> m_epoch;
+    std::atomic<bool> m_sleeping; /* set while the owner is (about to be) in wait() */
+};
+
+/**
+ * Set of waiters attached to a single waitable.
+ * notify() costs a single load when nobody is attached.
+ */
+class waiter_list
+{
+public:
+    explicit waiter_list() :
+       m_mutex{},
+       m_waiters{},
+       m_size{0}
+    {
+    }
+
+    ~waiter_list() = default;
+
+    waiter_list(const waiter_list&) = delete;
+    waiter_list(waiter_list&&) = delete;
+
+    waiter_list& operator = (const waiter_list&) = delete;
+    waiter_list& operator = (waiter_list&&) = delete;
+
+    void attach(waiter* w)
+    {
+        attach(w, []() {});
+    }
+
+    void detach(waiter* w)
+    {
+        detach(w, []() {});
+    }
+
+    /**
+     * Same as attach(), 'first' is called (under the lock) when the list was empty,
+     * so the attaches and detaches following it wait until it returns.
+     */
+    template<typename F>
+    void attach(waiter* w, F&& first)
+    {
+        std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+        if (m_waiters.empty())
+            first();
+        m_waiters.push_back(w);
+        m_size.store(m_waiters.size(), std::memory_order_relaxed);
+    }
+
+    /**
+     * Same as detach(), 'last' is called (under the lock) when the list became empty.
+     */
+    template<typename F>
+    void detach(waiter* w, F&& last)
+    {
+        std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+        m_waiters.erase(std::remove(m_waiters.begin(), m_waiters.end(), w), m_waiters.end());
+        m_size.store(m_waiters.size(), std::memory_order_relaxed);
+        if (m_waiters.empty())
+            last();
+    }
+
+    /**
+     * Notifies all attached waiters. To be called after the waitable
+     * has become ready by a seq_cst operation (or behind a seq_cst fence),
+     * so it pairs with the fence in wait_any().
+     */
+    void notify()
+    {
+        if (m_size.load(std::memory_order_seq_cst) == 0)
+            return;
+
+        std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+        for (waiter* w : m_waiters)
+            w->notify();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<waiter*> m_waiters;
+    std::atomic<std::size_t> m_size;
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+namespace detail
+{
+
+template<typename... W>
+inline long try_wait_any(W&... waitables)
+{
+    long index = 0;
+
+    /* left to right, stops at the first success */
+    if (((waitables.try_wait() ? true : (++index, false)) || ...))
+        return index;
+
+    return -1;
+}
+
+template<typename... W>
+inline long wait_any_until(const std::chrono::steady_clock::time_point* deadline, W&... waitables)
+{
+    long index;
+    waiter w;
+
+    if ((index = try_wait_any(waitables...)) >= 0)
+        return index;
+
+    (waitables.attach_waiter(&w), ...);
+
+    for (;;) {
+        const std::uint32_t epoch = w.epoch();
+
+        /* Pairs with the fence in waiter_list::notify(): either we see
+        the waitable ready or its notifier sees us attached. */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if ((index = try_wait_any(waitables...)) >= 0)
+            break;
+
+        if (!w.wait(epoch, deadline)) {
+            index = try_wait_any(waitables...);
+            break;
+        }
+    }
+
+    (waitables.detach_waiter(&w), ...);
+
+    return index;
+}
+
+} /* end of namespace detail */
+
+/**
+ * Blocks until any of the waitables can be taken and takes it
+ * (the first one in the argument order if several are ready).
+ *
+ * @return index of the waitable taken.
+ */
+template<typename... W>
+long wait_any(W&&... waitables)
+{
+    static_assert(sizeof...(W) > 0, "wait_any() needs at least one waitable");
+
+    return detail::wait_any_until(nullptr, waitables...);
+}
+
+/**
+ * Same as wait_any() with timeout semantics.
+ *
+ * @return index of the waitable taken or -1 when the timeout has passed.
+ */
+template<typename Rep, typename Period, typename... W>
+long wait_any_for(const std::chrono::duration<Rep, Period>& timeout, W&&... waitables)
+{
+    static_assert(sizeof...(W) > 0, "wait_any_for() needs at least one waitable");
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+
+    return detail::wait_any_until(&deadline, waitables...);
+}
+
+/**
+ * Same as wait_any_for() but the limit is given as an absolute point in time.
+ */
+template<typename Clock, typename Duration, typename... W>
+long wait_any_until(const std::chrono::time_point<Clock, Duration>& deadline, W&&... waitables)
+{
+    return wait_any_for(deadline - Clock::now(), std::forward<W>(waitables)...);
+}
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _WAITER_HPP_ */
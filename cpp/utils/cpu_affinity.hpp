@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file cpu_affinity.hpp
+ *
+ * Helpers for pinning threads to CPUs or NUMA nodes (without libnuma,
+ * NUMA topology is taken from sysfs).
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+#ifndef _CPU_AFFINITY_HPP_
+#define _CPU_AFFINITY_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#define CPU_AFFINITY_SYSFS_NODE "/sys/devices/system/node/node%d/cpulist"
+
+/*===========================================================================*\
+ * global types definitions
+\*===========================================================================*/
+namespace lts
+{
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Parses kernel's cpu list format (e.g. "0-3,8,10-11") into 'set'.
+ *
+ * @return true on success, false if the list is malformed or empty.
+ */
+static inline bool cpu_list_parse(const char* list, cpu_set_t* set)
+{
+    bool any = false;
+
+    CPU_ZERO(set);
+
+    while (*list != '\0' && *list != '\n') {
+        char* end;
+        const long first = std::strtol(list, &end, 10);
+        long last = first;
+
+        if ((end == list) || (first < 0))
+            return false;
+
+        if (*end == '-') {
+            list = end + 1;
+            last = std::strtol(list, &end, 10);
+            if ((end == list) || (last < first))
+                return false;
+        }
+
+        if (last >= CPU_SETSIZE)
+            return false;
+
+        for (long cpu = first; cpu <= last; ++cpu)
+            CPU_SET(static_cast<int>(cpu), set);
+        any = true;
+
+        if (*end == ',')
+            end++;
+        else if ((*end != '\0') && (*end != '\n'))
+            return false;
+
+        list = end;
+    }
+
+    return any;
+}
+
+/**
+ * Gets the set of CPUs belonging to the given NUMA node.
+ *
+ * @return true on success, false if there is no such node.
+ */
+static inline bool numa_node_cpus(int node, cpu_set_t* set)
+{
+    char path[sizeof(CPU_AFFINITY_SYSFS_NODE) + 16];
+    char list[1024];
+    bool status = false;
+
+    std::snprintf(path, sizeof(path), CPU_AFFINITY_SYSFS_NODE, node);
+
+    FILE* file = std::fopen(path, "r");
+    if (file) {
+        if (std::fgets(list, sizeof(list), file))
+            status = cpu_list_parse(list, set);
+        std::fclose(file);
+    }
+
+    return status;
+}
+
+/**
+ * Restricts 'thread' to run on CPUs from 'set' only.
+ *
+ * @return 0 on success, errno value otherwise.
+ */
+static inline int pin_thread(pthread_t thread, const cpu_set_t& set)
+{
+    return pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global (external linkage) objects declarations
+\*===========================================================================*/
+namespace lts
+{
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations (external linkage)
+\*===========================================================================*/
+namespace lts
+{
+} /* end of namespace lts */
+
+#endif /* _CPU_AFFINITY_HPP_ */
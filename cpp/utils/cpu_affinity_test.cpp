@@ -0,0 +1,138 @@
+/**
+ * @file cpu_affinity_test.cpp
+ *
+ * Test procedures for cpu affinity helpers.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <thread>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "gtest/gtest.h"
+#include "cpu_affinity.hpp"
+
+/*===========================================================================*\
+ * 'using namespace' section
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local type definitions
+\*===========================================================================*/
+namespace
+{
+
+} // end of anonymous namespace
+
+/*===========================================================================*\
+ * global object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function declarations
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local object definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * inline function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * public function definitions
+\*===========================================================================*/
+namespace
+{
+
+TEST(cpu_affinity, cpu_list_parse)
+{
+    cpu_set_t set;
+
+    EXPECT_TRUE(lts::cpu_list_parse("0", &set));
+    EXPECT_EQ(1, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(0, &set));
+
+    EXPECT_TRUE(lts::cpu_list_parse("0-3,8,10-11\n", &set));
+    EXPECT_EQ(7, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(3, &set));
+    EXPECT_FALSE(CPU_ISSET(4, &set));
+    EXPECT_TRUE(CPU_ISSET(8, &set));
+    EXPECT_TRUE(CPU_ISSET(11, &set));
+
+    EXPECT_FALSE(lts::cpu_list_parse("", &set));
+    EXPECT_FALSE(lts::cpu_list_parse("3-1", &set));
+    EXPECT_FALSE(lts::cpu_list_parse("1-", &set));
+    EXPECT_FALSE(lts::cpu_list_parse("a", &set));
+    EXPECT_FALSE(lts::cpu_list_parse("1;2", &set));
+    EXPECT_FALSE(lts::cpu_list_parse("100000", &set));
+}
+
+TEST(cpu_affinity, pin_thread)
+{
+    cpu_set_t set;
+
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set));
+
+    /* node 0 exists wherever sysfs exposes NUMA topology */
+    cpu_set_t node;
+    if (lts::numa_node_cpus(0, &node)) {
+        EXPECT_GT(CPU_COUNT(&node), 0);
+    }
+    EXPECT_FALSE(lts::numa_node_cpus(-1, &node));
+
+    std::thread t {[&set]() {
+        cpu_set_t one, current;
+        int cpu = 0;
+
+        while (!CPU_ISSET(cpu, &set))
+            cpu++;
+
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        EXPECT_EQ(0, lts::pin_thread(pthread_self(), one));
+        ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(current), &current));
+        EXPECT_TRUE(CPU_EQUAL(&one, &current));
+    }};
+
+    t.join();
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/*===========================================================================*\
+ * protected function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * private function definitions
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * local function definitions
+\*===========================================================================*/
@@ -0,0 +1,118 @@
+/* SPDX-License-Identifier: MIT */
+/**
+ * @file futex.hpp
+ *
+ * Thin wrappers around Linux futex(2) system call.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ */
+
+#ifndef _FUTEX_HPP_
+#define _FUTEX_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <ctime>
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() asm volatile("yield" ::: "memory")
+#else
+#define cpu_relax() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+/*===========================================================================*\
+ * global types definitions
+\*===========================================================================*/
+namespace lts
+{
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+    "std::atomic<std::uint32_t> cannot be used as a futex word");
+
+/**
+ * Sleeps as long as '*addr' equals to 'expected' (or until woken up).
+ *
+ * @param[in] addr        Futex word.
+ * @param[in] expected    Value the futex word is expected to hold.
+ * @param[in] timeout     Relative timeout (nullptr means no timeout).
+ * @param[in] shared      True if the futex word may be shared between processes.
+ *
+ * @return 0 when woken up (or the value did not match),
+ *         -ETIMEDOUT when timeout has passed,
+ *         other negative errno value on error.
+ */
+static inline int futex_wait(std::atomic<std::uint32_t>* addr, std::uint32_t expected,
+                             const struct timespec* timeout = nullptr, bool shared = false)
+{
+    long status = ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(addr),
+        shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+
+    if (status == -1) {
+        if ((errno == EAGAIN) || (errno == EINTR))
+            return 0;
+        return -errno;
+    }
+
+    return 0;
+}
+
+/**
+ * Wakes up at most 'count' threads sleeping on the futex word.
+ *
+ * @return number of woken up threads or negative errno value on error.
+ */
+static inline int futex_wake(std::atomic<std::uint32_t>* addr, int count = 1, bool shared = false)
+{
+    long status = ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(addr),
+        shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+
+    return (status == -1) ? -errno : static_cast<int>(status);
+}
+
+static inline int futex_wake_all(std::atomic<std::uint32_t>* addr, bool shared = false)
+{
+    return futex_wake(addr, INT_MAX, shared);
+}
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global (external linkage) objects declarations
+\*===========================================================================*/
+namespace lts
+{
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations (external linkage)
+\*===========================================================================*/
+namespace lts
+{
+} /* end of namespace lts */
+
+#endif /* _FUTEX_HPP_ */
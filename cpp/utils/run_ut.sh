@@ -3,8 +3,8 @@
 set -e
 set -x
 
-UT_SRC='endianness.hpp strtointeger.hpp'
-UT_BIN='endianness_test strtointeger_test'
+UT_SRC='endianness.hpp strtointeger.hpp cpu_affinity.hpp'
+UT_BIN='endianness_test strtointeger_test cpu_affinity_test'
 
 make clean
 make all
@@ -43,6 +43,10 @@
 
 #define __might_be_unused __attribute__((unused))
 
+#ifndef UNUSED
+#define UNUSED(expr) do {(void)(expr);} while(0)
+#endif
+
 /*===========================================================================*\
  * global types definitions
 \*===========================================================================*/
@@ -0,0 +1,679 @@
+/**
+ * @file future.hpp
+ *
+ * Lightweight promise/future pair with continuations.
+ * The shared state is taken from task_pool (no allocation in the steady state),
+ * reference counted by both sides and waited for on a futex.
+ * Continuations attached with then() are handed over to the executor
+ * the producing task was submitted to (see workqueue::submit()).
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _FUTURE_HPP_
+#define _FUTURE_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+#include <cassert>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../utils/futex.hpp"
+#include "task.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Anything tasks can be handed over to (workqueue implements it).
+ */
+class executor
+{
+public:
+    virtual ~executor() = default;
+    virtual void execute(task&& t) = 0;
+};
+
+template<typename T> class future;
+template<typename T> class promise;
+
+namespace detail
+{
+
+struct future_void {};
+
+template<typename T>
+using future_value = std::conditional_t<std::is_void<T>::value, future_void, T>;
+
+template<typename T>
+class future_state
+{
+public:
+    typedef future_value<T> value_type;
+
+    enum : std::uint32_t
+    {
+        PENDING, /* no value, no continuation */
+        CHAINED, /* no value, continuation attached */
+        READY,   /* value is set */
+        BROKEN,  /* promise was destroyed without setting a value */
+    };
+
+    static_assert(alignof(value_type) <= alignof(std::max_align_t), "over-aligned values are not supported");
+
+    static future_state* create(executor* e)
+    {
+        return new (task_pool::allocate(sizeof(future_state))) future_state(e);
+    }
+
+    void acquire()
+    {
+        m_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->~future_state();
+            task_pool::deallocate(this, sizeof(future_state));
+        }
+    }
+
+    executor* get_executor() const
+    {
+        return m_executor;
+    }
+
+    bool is_ready() const
+    {
+        return m_state.load(std::memory_order_acquire) >= READY;
+    }
+
+    /* Returns true when the value is set, false if the promise has been broken. */
+    bool wait(const struct timespec* timeout = nullptr)
+    {
+        std::uint32_t state = m_state.load(std::memory_order_acquire);
+
+        if (state < READY) {
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            while ((state = m_state.load(std::memory_order_seq_cst)) < READY)
+                if (futex_wait(&m_state, state, timeout) == -ETIMEDOUT)
+                    break;
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        return state == READY;
+    }
+
+    template<typename... Args>
+    void set_value(Args&&... args)
+    {
+        new (m_value) value_type{std::forward<Args>(args)...};
+        complete(READY);
+    }
+
+    void set_broken()
+    {
+        complete(BROKEN);
+    }
+
+    value_type& value()
+    {
+        return *reinterpret_cast<value_type*>(m_value);
+    }
+
+    /**
+     * Attaches the (only) continuation. It is run once the state is completed,
+     * on the executor (unless 'run_inline' is set or the promise has been broken)
+     * or right away when the state is completed already.
+     */
+    void set_continuation(task&& t, bool run_inline)
+    {
+        std::uint32_t expected = PENDING;
+
+        m_continuation = std::move(t);
+        m_run_inline = run_inline;
+
+        if (!m_state.compare_exchange_strong(expected, CHAINED, std::memory_order_acq_rel, std::memory_order_acquire))
+            dispatch(expected);
+    }
+
+private:
+    explicit future_state(executor* e) :
+        m_refs{1},
+        m_state{PENDING},
+        m_waiters{0},
+        m_run_inline{false},
+        m_executor{e},
+        m_continuation{}
+    {
+    }
+
+    ~future_state()
+    {
+        if (m_state.load(std::memory_order_relaxed) == READY)
+            value().~value_type();
+    }
+
+    void complete(std::uint32_t state)
+    {
+        /* pairs with m_waiters increment in wait(), as in the semaphore */
+        if (m_state.exchange(state, std::memory_order_seq_cst) == CHAINED)
+            dispatch(state);
+
+        if (m_waiters.load(std::memory_order_seq_cst) > 0)
+            futex_wake_all(&m_state);
+    }
+
+    void dispatch(std::uint32_t state)
+    {
+        task t{std::move(m_continuation)};
+
+        /* a broken chain is unwound in place, the executor may be going away */
+        if (m_run_inline || !m_executor || (state == BROKEN))
+            t();
+        else
+            m_executor->execute(std::move(t));
+    }
+
+    std::atomic<std::uint32_t> m_refs;
+    std::atomic<std::uint32_t> m_state;
+    std::atomic<std::uint32_t> m_waiters;
+    bool m_run_inline;
+    executor* m_executor;
+    task m_continuation;
+    alignas(value_type) unsigned char m_value[sizeof(value_type)];
+};
+
+template<typename F, typename T>
+struct continuation_result
+{
+    typedef std::invoke_result_t<F, T> type;
+};
+
+template<typename F>
+struct continuation_result<F, void>
+{
+    typedef std::invoke_result_t<F> type;
+};
+
+/* Invokes 'f' and stores its result (if any) in 'p'. */
+template<typename R, typename F, typename... Args>
+void fulfil(promise<R>& p, F&& f, Args&&... args)
+{
+    if constexpr (std::is_void<R>::value) {
+        std::invoke(std::forward<F>(f), std::forward<Args>(args)...);
+        p.set_value();
+    }
+    else {
+        p.set_value(std::invoke(std::forward<F>(f), std::forward<Args>(args)...));
+    }
+}
+
+} /* end of namespace detail */
+
+template<typename T>
+class promise
+{
+public:
+    /* Continuations of the associated future will be run on 'e' (inline when nullptr). */
+    explicit promise(executor* e = nullptr) :
+        m_state{detail::future_state<T>::create(e)},
+        m_retrieved{false}
+    {
+    }
+
+    promise(promise&& other) noexcept :
+        m_state{other.m_state},
+        m_retrieved{other.m_retrieved}
+    {
+        other.m_state = nullptr;
+    }
+
+    promise& operator = (promise&& other) noexcept
+    {
+        if (this != &other) {
+            abandon();
+            m_state = other.m_state;
+            m_retrieved = other.m_retrieved;
+            other.m_state = nullptr;
+        }
+
+        return *this;
+    }
+
+    promise(const promise&) = delete;
+    promise& operator = (const promise&) = delete;
+
+    ~promise()
+    {
+        abandon();
+    }
+
+    future<T> get_future()
+    {
+        assert(m_state && !m_retrieved);
+        m_retrieved = true;
+        m_state->acquire();
+        return future<T>{m_state};
+    }
+
+    template<typename... Args>
+    void set_value(Args&&... args)
+    {
+        assert(m_state);
+        m_state->set_value(std::forward<Args>(args)...);
+        m_state->release();
+        m_state = nullptr;
+    }
+
+private:
+    void abandon()
+    {
+        if (m_state) {
+            m_state->set_broken();
+            m_state->release();
+            m_state = nullptr;
+        }
+    }
+
+    detail::future_state<T>* m_state;
+    bool m_retrieved;
+};
+
+template<typename T>
+class future
+{
+public:
+    future() :
+        m_state{nullptr}
+    {
+    }
+
+    future(future&& other) noexcept :
+        m_state{other.m_state}
+    {
+        other.m_state = nullptr;
+    }
+
+    future& operator = (future&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_state)
+                m_state->release();
+            m_state = other.m_state;
+            other.m_state = nullptr;
+        }
+
+        return *this;
+    }
+
+    future(const future&) = delete;
+    future& operator = (const future&) = delete;
+
+    ~future()
+    {
+        if (m_state)
+            m_state->release();
+    }
+
+    bool valid() const
+    {
+        return m_state != nullptr;
+    }
+
+    /* True once the value is set (or the promise has been broken). */
+    bool is_ready() const
+    {
+        return m_state->is_ready();
+    }
+
+    /**
+     * Blocks until the value is set.
+     *
+     * @return true if the value is set, false if the promise has been broken.
+     */
+    bool wait()
+    {
+        return m_state->wait();
+    }
+
+    /**
+     * Same as wait() but gives up after 'timeout'.
+     *
+     * @return true if the value is set, false on timeout or broken promise.
+     */
+    template<typename Rep, typename Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (!m_state->is_ready()) {
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                return false;
+
+            const std::chrono::nanoseconds remaining =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+            const struct timespec ts = {
+                static_cast<time_t>(remaining.count() / 1000000000),
+                static_cast<long>(remaining.count() % 1000000000)
+            };
+
+            m_state->wait(&ts);
+        }
+
+        return m_state->wait();
+    }
+
+    /**
+     * Waits for and takes the value. The future is no longer valid afterwards.
+     * Shall not be called when the promise has been broken.
+     */
+    T get()
+    {
+        detail::future_state<T>* state = m_state;
+        const bool ready = state->wait();
+
+        assert(ready);
+        static_cast<void>(ready);
+
+        m_state = nullptr;
+
+        if constexpr (std::is_void<T>::value) {
+            state->release();
+        }
+        else {
+            T value{std::move(state->value())};
+            state->release();
+            return value;
+        }
+    }
+
+    /**
+     * Attaches 'f' to be run with the value (f() for future<void>) once it is set,
+     * on the executor this future's producer has been submitted to.
+     * The future is no longer valid afterwards.
+     *
+     * @return future of the value returned by 'f'.
+     */
+    template<typename F>
+    future<typename detail::continuation_result<std::decay_t<F>, T>::type> then(F&& f)
+    {
+        typedef typename detail::continuation_result<std::decay_t<F>, T>::type R;
+
+        promise<R> p{m_state->get_executor()};
+        future<R> result = p.get_future();
+
+        chain([](future<T> input, std::decay_t<F> f, promise<R> p) {
+            if (!input.wait())
+                return; /* p is broken as well */
+            if constexpr (std::is_void<T>::value) {
+                input.get();
+                detail::fulfil(p, std::move(f));
+            }
+            else {
+                detail::fulfil(p, std::move(f), input.get());
+            }
+        }, false, std::forward<F>(f), std::move(p));
+
+        return result;
+    }
+
+private:
+    template<typename U> friend class promise;
+    template<typename U> friend class future;
+    template<typename U> friend future<std::vector<U>> when_all(std::vector<future<U>>&& futures);
+    template<typename U> friend future<std::pair<std::size_t, U>> when_any(std::vector<future<U>>&& futures);
+    friend future<void> when_all(std::vector<future<void>>&& futures);
+    friend future<std::size_t> when_any(std::vector<future<void>>&& futures);
+
+    explicit future(detail::future_state<T>* state) :
+        m_state{state}
+    {
+    }
+
+    executor* get_executor() const
+    {
+        return m_state->get_executor();
+    }
+
+    /* Moves this future into continuation 'f' (its first argument) and attaches it. */
+    template<typename F, typename... Args>
+    void chain(F&& f, bool run_inline, Args&&... args)
+    {
+        detail::future_state<T>* state = m_state;
+
+        state->set_continuation(task{std::forward<F>(f), std::move(*this), std::forward<Args>(args)...}, run_inline);
+    }
+
+    detail::future_state<T>* m_state;
+};
+
+namespace detail
+{
+
+template<typename T>
+struct when_all_context
+{
+    explicit when_all_context(std::size_t n, executor* e) :
+        m_remaining{n},
+        m_broken{false},
+        m_values(n),
+        m_promise{e}
+    {
+    }
+
+    /* The last one to arrive completes the batch. */
+    void arrive()
+    {
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (!m_broken.load(std::memory_order_relaxed)) {
+                if constexpr (std::is_void<T>::value)
+                    m_promise.set_value();
+                else
+                    m_promise.set_value(std::move(m_values));
+            }
+            delete this;
+        }
+    }
+
+    std::atomic<std::size_t> m_remaining;
+    std::atomic<bool> m_broken;
+    std::vector<future_value<T>> m_values;
+    promise<std::conditional_t<std::is_void<T>::value, void, std::vector<future_value<T>>>> m_promise;
+};
+
+template<typename T>
+struct when_any_context
+{
+    typedef std::conditional_t<std::is_void<T>::value, std::size_t, std::pair<std::size_t, future_value<T>>> result_type;
+
+    explicit when_any_context(std::size_t n, executor* e) :
+        m_remaining{n},
+        m_won{false},
+        m_promise{e}
+    {
+    }
+
+    /* Whoever is ready first wins, the context goes away with the last one. */
+    template<typename... V>
+    void arrive(bool ready, V&&... value)
+    {
+        bool won = false;
+
+        if (ready && m_won.compare_exchange_strong(won, true, std::memory_order_acq_rel))
+            m_promise.set_value(std::forward<V>(value)...);
+
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    std::atomic<std::size_t> m_remaining;
+    std::atomic<bool> m_won;
+    promise<result_type> m_promise;
+};
+
+} /* end of namespace detail */
+
+/**
+ * Completes once all of 'futures' are ready (with their values in the same order).
+ * The result is broken if any of the promises has been broken.
+ */
+template<typename T>
+future<std::vector<T>> when_all(std::vector<future<T>>&& futures)
+{
+    typedef detail::when_all_context<T> context;
+
+    context* ctx = new context{futures.size(), futures.empty() ? nullptr : futures[0].get_executor()};
+    future<std::vector<T>> result = ctx->m_promise.get_future();
+
+    if (futures.empty()) {
+        ctx->m_promise.set_value();
+        delete ctx;
+        return result;
+    }
+
+    for (std::size_t i = 0; i < futures.size(); ++i)
+        futures[i].chain([](future<T> input, context* ctx, std::size_t i) {
+            if (input.wait())
+                ctx->m_values[i] = input.get();
+            else
+                ctx->m_broken.store(true, std::memory_order_relaxed);
+            ctx->arrive();
+        }, true, ctx, i);
+
+    futures.clear();
+
+    return result;
+}
+
+inline future<void> when_all(std::vector<future<void>>&& futures)
+{
+    typedef detail::when_all_context<void> context;
+
+    context* ctx = new context{futures.size(), futures.empty() ? nullptr : futures[0].get_executor()};
+    future<void> result = ctx->m_promise.get_future();
+
+    if (futures.empty()) {
+        ctx->m_promise.set_value();
+        delete ctx;
+        return result;
+    }
+
+    for (future<void>& f : futures)
+        f.chain([](future<void> input, context* ctx) {
+            if (!input.wait())
+                ctx->m_broken.store(true, std::memory_order_relaxed);
+            ctx->arrive();
+        }, true, ctx);
+
+    futures.clear();
+
+    return result;
+}
+
+/**
+ * Completes as soon as any of 'futures' is ready, with its index and value.
+ * The result is broken if all of the promises have been broken (or 'futures' is empty).
+ */
+template<typename T>
+future<std::pair<std::size_t, T>> when_any(std::vector<future<T>>&& futures)
+{
+    typedef detail::when_any_context<T> context;
+
+    if (futures.empty())
+        return promise<std::pair<std::size_t, T>>{}.get_future();
+
+    context* ctx = new context{futures.size(), futures[0].get_executor()};
+    future<std::pair<std::size_t, T>> result = ctx->m_promise.get_future();
+
+    for (std::size_t i = 0; i < futures.size(); ++i)
+        futures[i].chain([](future<T> input, context* ctx, std::size_t i) {
+            if (input.wait())
+                ctx->arrive(true, i, input.get());
+            else
+                ctx->arrive(false);
+        }, true, ctx, i);
+
+    futures.clear();
+
+    return result;
+}
+
+inline future<std::size_t> when_any(std::vector<future<void>>&& futures)
+{
+    typedef detail::when_any_context<void> context;
+
+    if (futures.empty())
+        return promise<std::size_t>{}.get_future();
+
+    context* ctx = new context{futures.size(), futures[0].get_executor()};
+    future<std::size_t> result = ctx->m_promise.get_future();
+
+    for (std::size_t i = 0; i < futures.size(); ++i)
+        futures[i].chain([](future<void> input, context* ctx, std::size_t i) {
+            if (input.wait())
+                ctx->arrive(true, i);
+            else
+                ctx->arrive(false);
+        }, true, ctx, i);
+
+    futures.clear();
+
+    return result;
+}
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _FUTURE_HPP_ */
@@ -0,0 +1,333 @@
+/**
+ * @file metrics.hpp
+ *
+ * Workqueue instrumentation: log2 latency histograms, per-worker counters
+ * and the snapshot they are merged into on read. Every worker updates
+ * its own cacheline only, so keeping the metrics on costs a few clock
+ * reads and uncontended atomic additions per task.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _METRICS_HPP_
+#define _METRICS_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* bucket 0 counts 0ns, bucket i durations in [2^(i-1), 2^i) ns, the last one everything above */
+#if !defined(METRICS_HISTOGRAM_BUCKETS)
+#define METRICS_HISTOGRAM_BUCKETS 40
+#endif
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+class latency_histogram
+{
+public:
+    static constexpr std::size_t buckets = METRICS_HISTOGRAM_BUCKETS;
+
+    latency_histogram() :
+        m_counts{}
+    {
+    }
+
+    static std::size_t bucket(std::int64_t nanoseconds)
+    {
+        if (nanoseconds <= 0)
+            return 0;
+
+        const std::size_t b = 64 - __builtin_clzll(static_cast<unsigned long long>(nanoseconds));
+
+        return (b < buckets) ? b : buckets - 1;
+    }
+
+    /* Upper bound of the given bucket. */
+    static std::chrono::nanoseconds bound(std::size_t bucket)
+    {
+        return std::chrono::nanoseconds{(bucket == 0) ? 0 : (std::int64_t{1} << bucket)};
+    }
+
+    std::uint64_t operator [] (std::size_t bucket) const
+    {
+        return m_counts[bucket];
+    }
+
+    std::uint64_t count() const
+    {
+        std::uint64_t n = 0;
+
+        for (std::size_t b = 0; b < buckets; ++b)
+            n += m_counts[b];
+
+        return n;
+    }
+
+    /**
+     * @param[in] fraction Value in [0, 1], e.g. 0.99 for the 99th percentile.
+     * @return upper bound of the bucket the percentile falls into
+     *         (so it is accurate within a factor of 2), 0 if the histogram is empty.
+     */
+    std::chrono::nanoseconds percentile(double fraction) const
+    {
+        const std::uint64_t n = count();
+        std::uint64_t seen = 0;
+
+        if (n == 0)
+            return std::chrono::nanoseconds{0};
+
+        const std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(n - 1)) + 1;
+
+        for (std::size_t b = 0; b < buckets; ++b) {
+            seen += m_counts[b];
+            if (seen >= rank)
+                return bound(b);
+        }
+
+        return bound(buckets - 1);
+    }
+
+    void add(std::size_t bucket, std::uint64_t n)
+    {
+        m_counts[bucket] += n;
+    }
+
+private:
+    std::uint64_t m_counts[buckets];
+};
+
+struct worker_metrics
+{
+    std::uint64_t m_tasks = 0; /* tasks run */
+    std::chrono::nanoseconds m_busy{0}; /* time spent running them */
+    std::chrono::nanoseconds m_idle{0}; /* time alive but not running anything */
+
+    /* Busy to (busy + idle) ratio. */
+    double utilisation() const
+    {
+        const double total = static_cast<double>((m_busy + m_idle).count());
+        return (total > 0) ? static_cast<double>(m_busy.count()) / total : 0.0;
+    }
+};
+
+/* Snapshot of the metrics of a workqueue, see workqueue::metrics(). */
+struct workqueue_metrics
+{
+    latency_histogram m_wait; /* from push to start of a task */
+    latency_histogram m_run; /* from start to end of a task */
+    std::vector<worker_metrics> m_workers; /* indexed by worker, retired ones included */
+    std::uint64_t m_completed = 0; /* including tasks run by try_run_one() callers */
+    std::size_t m_depth = 0; /* tasks pushed but not started */
+    std::size_t m_peak_depth = 0; /* approximate, the depth is only sampled (see WORKQUEUE_DEPTH_SAMPLING) */
+    std::chrono::nanoseconds m_elapsed{0}; /* since the workqueue has been created */
+
+    /* Average throughput since the workqueue has been created. */
+    double tasks_per_second() const
+    {
+        return rate(m_completed, m_elapsed);
+    }
+
+    /* Throughput between an 'earlier' snapshot and this one. */
+    double tasks_per_second(const workqueue_metrics& earlier) const
+    {
+        return rate(m_completed - earlier.m_completed, m_elapsed - earlier.m_elapsed);
+    }
+
+    std::string to_string() const
+    {
+        std::ostringstream stream;
+
+        stream << m_completed << " task(s), ";
+        stream << tasks_per_second() << " task(s)/s, ";
+        stream << "depth " << m_depth << " (peak " << m_peak_depth << "), ";
+        stream << "wait p50/p99 " << m_wait.percentile(0.5).count() << "/" << m_wait.percentile(0.99).count() << " ns, ";
+        stream << "run p50/p99 " << m_run.percentile(0.5).count() << "/" << m_run.percentile(0.99).count() << " ns";
+        for (std::size_t i = 0; i < m_workers.size(); ++i)
+            stream << ", #" << i << " " << static_cast<int>(m_workers[i].utilisation() * 100) << "% busy";
+
+        return stream.str();
+    }
+
+    operator std::string () const
+    {
+        return to_string();
+    }
+
+private:
+    static double rate(std::uint64_t tasks, std::chrono::nanoseconds elapsed)
+    {
+        return (elapsed.count() > 0) ? static_cast<double>(tasks) * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+    }
+};
+
+namespace detail
+{
+
+/* Counters of a single worker (or of all the other threads), written with relaxed
+atomics so a concurrent snapshot is never torn, yet they stay on a private cacheline. */
+struct alignas(64) metrics_counters
+{
+    typedef std::chrono::steady_clock clock;
+
+    static std::int64_t now()
+    {
+        return clock::now().time_since_epoch().count();
+    }
+
+    static std::int64_t nanoseconds(std::int64_t ticks)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::duration{ticks}).count();
+    }
+
+    /* Called by the pushing thread, returns number of tasks pushed through these counters before. */
+    std::uint64_t enqueued()
+    {
+        return m_enqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /* Keeps the highest depth of the workqueue sampled by the threads using these counters. */
+    void sampled(std::size_t depth)
+    {
+        if (depth > m_peak_depth.load(std::memory_order_relaxed))
+            m_peak_depth.store(depth, std::memory_order_relaxed);
+    }
+
+    /* Called with the enqueue time of a task which is about to start, returns its start time. */
+    std::int64_t started(std::int64_t enqueued)
+    {
+        const std::int64_t start = now();
+
+        m_started.fetch_add(1, std::memory_order_relaxed);
+
+        if (enqueued != 0)
+            m_wait[latency_histogram::bucket(nanoseconds(start - enqueued))].fetch_add(1, std::memory_order_relaxed);
+        m_running_since.store(start, std::memory_order_relaxed);
+
+        return start;
+    }
+
+    void completed(std::int64_t start)
+    {
+        const std::int64_t run = nanoseconds(now() - start);
+
+        m_run[latency_histogram::bucket(run)].fetch_add(1, std::memory_order_relaxed);
+        m_busy.fetch_add(run, std::memory_order_relaxed);
+        m_tasks.fetch_add(1, std::memory_order_relaxed);
+        m_running_since.store(0, std::memory_order_relaxed);
+    }
+
+    /* Lifetime of the worker owning the counters (slots of an elastic pool are reused). */
+    void born()
+    {
+        m_alive_since.store(now(), std::memory_order_relaxed);
+    }
+
+    void died()
+    {
+        const std::int64_t since = m_alive_since.exchange(0, std::memory_order_relaxed);
+
+        if (since != 0)
+            m_alive.fetch_add(nanoseconds(now() - since), std::memory_order_relaxed);
+    }
+
+    /* Merges these counters into 'snapshot', fills in 'worker' (if given). */
+    void collect(workqueue_metrics* snapshot, worker_metrics* worker, std::int64_t at) const
+    {
+        for (std::size_t b = 0; b < latency_histogram::buckets; ++b) {
+            snapshot->m_wait.add(b, m_wait[b].load(std::memory_order_relaxed));
+            snapshot->m_run.add(b, m_run[b].load(std::memory_order_relaxed));
+        }
+
+        const std::uint64_t tasks = m_tasks.load(std::memory_order_relaxed);
+        snapshot->m_completed += tasks;
+
+        const std::size_t peak = m_peak_depth.load(std::memory_order_relaxed);
+        if (peak > snapshot->m_peak_depth)
+            snapshot->m_peak_depth = peak;
+
+        if (worker) {
+            const std::int64_t running_since = m_running_since.load(std::memory_order_relaxed);
+            const std::int64_t alive_since = m_alive_since.load(std::memory_order_relaxed);
+            std::int64_t busy = m_busy.load(std::memory_order_relaxed);
+            std::int64_t alive = m_alive.load(std::memory_order_relaxed);
+
+            /* the task being run right now counts as well */
+            if ((running_since != 0) && (at > running_since))
+                busy += nanoseconds(at - running_since);
+            if ((alive_since != 0) && (at > alive_since))
+                alive += nanoseconds(at - alive_since);
+
+            worker->m_tasks = tasks;
+            worker->m_busy = std::chrono::nanoseconds{busy};
+            worker->m_idle = std::chrono::nanoseconds{(alive > busy) ? alive - busy : 0};
+        }
+    }
+
+    std::atomic<std::uint64_t> m_wait[latency_histogram::buckets] = {};
+    std::atomic<std::uint64_t> m_run[latency_histogram::buckets] = {};
+    std::atomic<std::uint64_t> m_tasks{0};
+    std::atomic<std::uint64_t> m_enqueued{0}; /* depth is the sum of these ... */
+    std::atomic<std::uint64_t> m_started{0}; /* ... minus the sum of these, over all counters */
+    std::atomic<std::size_t> m_peak_depth{0};
+    std::atomic<std::int64_t> m_busy{0}; /* ns, completed tasks only */
+    std::atomic<std::int64_t> m_running_since{0}; /* clock ticks, 0 when not running a task */
+    std::atomic<std::int64_t> m_alive{0}; /* ns, previous lives of this slot */
+    std::atomic<std::int64_t> m_alive_since{0}; /* clock ticks, 0 when there is no live worker */
+};
+
+} /* end of namespace detail */
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _METRICS_HPP_ */
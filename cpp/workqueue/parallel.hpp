@@ -0,0 +1,267 @@
+/**
+ * @file parallel.hpp
+ *
+ * Data parallel algorithms (parallel_for, parallel_reduce) running on a workqueue.
+ * The range is cut into chunks of 'grain' indices which are then split
+ * recursively in halves: the thread holding a subrange pushes its upper half
+ * and carries on with the lower one, so idle workers (thieves in WORK_STEALING
+ * mode) pick up the biggest pieces first. The calling thread takes part
+ * in the work and only sleeps when there is nothing left it could run.
+ * While helping it may run any task queued on the workqueue, not only
+ * the ones of its own call, on its own stack.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../utils/futex.hpp"
+#include "workqueue.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* with grain == 0 the range is cut into that many chunks per thread (workers and the caller) */
+#if !defined(PARALLEL_CHUNKS_PER_THREAD)
+#define PARALLEL_CHUNKS_PER_THREAD 8
+#endif
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+namespace detail
+{
+
+/* the pending part of the futex word of parallel_chunks */
+static constexpr std::size_t parallel_max_chunks = (std::size_t{1} << 24) - 1;
+
+/* Runs body(chunk) for every chunk in [0, chunks) and returns once all of them are done. */
+template<typename Body>
+class parallel_chunks
+{
+    /* the futex word holds the number of pushed subranges not completed yet in its low bits
+    and an epoch bumped after every push in the high ones, so a sleeping caller sees both */
+    static constexpr std::uint32_t pending_mask = parallel_max_chunks;
+    static constexpr std::uint32_t epoch_unit = 1U << 24;
+
+public:
+    parallel_chunks(workqueue& wq, Body& body) :
+        m_workqueue{wq},
+        m_body{body},
+        m_state{0},
+        m_sleeping{false}
+    {
+    }
+
+    parallel_chunks(const parallel_chunks&) = delete;
+    parallel_chunks& operator = (const parallel_chunks&) = delete;
+
+    /* 'chunks' shall not exceed parallel_max_chunks (see parallel_grain()) */
+    void run(std::size_t chunks)
+    {
+        split(0, chunks);
+        wait();
+    }
+
+private:
+    void split(std::size_t first, std::size_t last)
+    {
+        while (last - first > 1) {
+            const std::size_t middle = first + (last - first) / 2;
+            m_state.fetch_add(1, std::memory_order_relaxed);
+            m_workqueue.push(&parallel_chunks::split_and_finish, this, middle, last);
+            last = middle;
+
+            /* the subrange being split here is not completed yet, so 'this' is still alive */
+            m_state.fetch_add(epoch_unit, std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_seq_cst))
+                futex_wake_all(&m_state);
+        }
+
+        m_body(first);
+    }
+
+    void split_and_finish(std::size_t first, std::size_t last)
+    {
+        split(first, last);
+
+        /* 'this' may be gone as soon as the pending count drops to 0,
+        waking up a stale address is harmless though */
+        std::atomic<std::uint32_t>* state = &m_state;
+        if ((state->fetch_sub(1, std::memory_order_acq_rel) & pending_mask) == 1)
+            futex_wake_all(state);
+    }
+
+    /* Helps by running queued tasks (not necessarily ours, the caller shall be
+    prepared to run any task of the workqueue on its stack) and sleeps only when
+    there is none, until either a subrange is pushed or all of them are completed. */
+    void wait()
+    {
+        std::uint32_t state;
+
+        while (((state = m_state.load(std::memory_order_acquire)) & pending_mask) != 0) {
+            if (m_workqueue.try_run_one())
+                continue;
+
+            /* pairs with split(): either it sees us sleeping or we see its epoch */
+            m_sleeping.store(true, std::memory_order_seq_cst);
+            futex_wait(&m_state, state);
+            m_sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    workqueue& m_workqueue;
+    Body& m_body;
+    std::atomic<std::uint32_t> m_state; /* pending subranges | epoch */
+    std::atomic<bool> m_sleeping; /* the caller is (about to be) parked in wait() */
+};
+
+/* The grain is enlarged if needed, so there are never more than parallel_max_chunks chunks. */
+inline std::size_t parallel_grain(const workqueue& wq, std::size_t size, std::size_t grain)
+{
+    if (0 == grain)
+        grain = std::max<std::size_t>(1, size / (PARALLEL_CHUNKS_PER_THREAD * (wq.threads() + 1)));
+
+    return std::max<std::size_t>(grain, (size + parallel_max_chunks - 1) / parallel_max_chunks);
+}
+
+/* Partial result of a single chunk, on its own cache line(s).
+It also keeps std::vector<bool> (and its shared words) away. */
+template<typename T>
+struct alignas(CACHELINE_SIZE) parallel_partial
+{
+    T m_value;
+};
+
+} /* end of namespace detail */
+
+/**
+ * Calls f(i) for every i in [begin, end) or, if 'f' takes two arguments,
+ * f(chunk_begin, chunk_end) for every chunk of (at most) 'grain' indices.
+ * Returns once all calls are completed. Can be nested (called from within a task).
+ * Meanwhile the caller runs queued tasks (possibly unrelated ones) on its stack.
+ * There are at most 2^24 - 1 chunks, a smaller grain is enlarged accordingly.
+ *
+ * @param[in] wq    Workqueue to run on (may have no workers at all).
+ * @param[in] begin First index.
+ * @param[in] end   One past the last index.
+ * @param[in] grain Number of indices processed by a single chunk (0 picks one).
+ * @param[in] f     Callable invoked concurrently from different threads.
+ */
+template<typename F>
+void parallel_for(workqueue& wq, std::size_t begin, std::size_t end, std::size_t grain, F&& f)
+{
+    if (end <= begin)
+        return;
+
+    grain = detail::parallel_grain(wq, end - begin, grain);
+
+    auto body = [begin, end, grain, &f](std::size_t chunk) {
+        const std::size_t first = begin + chunk * grain;
+        const std::size_t last = std::min(end, first + grain);
+
+        if constexpr (std::is_invocable<F&, std::size_t, std::size_t>::value)
+            f(first, last);
+        else
+            for (std::size_t i = first; i < last; ++i)
+                f(i);
+    };
+
+    detail::parallel_chunks<decltype(body)>{wq, body}.run((end - begin + grain - 1) / grain);
+}
+
+/**
+ * Reduces map(i) over [begin, end) with 'combine'.
+ * Each chunk is folded starting from 'identity', the partial results
+ * are then combined in the order of chunks, so for a given grain the result
+ * does not depend on the number of threads nor on the scheduling.
+ * The caller helps as in parallel_for().
+ *
+ * @return combine(...combine(combine(identity, map(begin)), map(begin + 1))..., map(end - 1))
+ *         (up to the associativity of 'combine').
+ */
+template<typename T, typename Map, typename Combine>
+T parallel_reduce(workqueue& wq, std::size_t begin, std::size_t end, std::size_t grain,
+                  const T& identity, Map&& map, Combine&& combine)
+{
+    if (end <= begin)
+        return identity;
+
+    grain = detail::parallel_grain(wq, end - begin, grain);
+
+    const std::size_t chunks = (end - begin + grain - 1) / grain;
+    std::vector<detail::parallel_partial<T>> partials(chunks, detail::parallel_partial<T>{identity});
+
+    auto body = [begin, end, grain, &partials, &map, &combine](std::size_t chunk) {
+        const std::size_t first = begin + chunk * grain;
+        const std::size_t last = std::min(end, first + grain);
+        T value = partials[chunk].m_value;
+
+        for (std::size_t i = first; i < last; ++i)
+            value = combine(std::move(value), map(i));
+
+        partials[chunk].m_value = std::move(value);
+    };
+
+    detail::parallel_chunks<decltype(body)>{wq, body}.run(chunks);
+
+    T result = identity;
+    for (detail::parallel_partial<T>& partial : partials)
+        result = combine(std::move(result), std::move(partial.m_value));
+
+    return result;
+}
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _PARALLEL_HPP_ */
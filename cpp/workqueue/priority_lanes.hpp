@@ -0,0 +1,260 @@
+/**
+ * @file priority_lanes.hpp
+ *
+ * Fixed number of FIFO lanes served in the order of their priority
+ * (lane 0 first) with protection against starvation: a non-empty lane
+ * which has been passed over 'starvation_limit' times is served next,
+ * regardless of what is waiting in the lanes above it.
+ * Not synchronised, apart from the depth counters which can be read
+ * by any thread at any time.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _PRIORITY_LANES_HPP_
+#define _PRIORITY_LANES_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <cassert>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* initial number of slots of each lane (a power of two), it doubles whenever a lane is full */
+#if !defined(PRIORITY_LANES_INITIAL_CAPACITY)
+#define PRIORITY_LANES_INITIAL_CAPACITY 64
+#endif
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+template<typename T, std::size_t LANES>
+class priority_lanes
+{
+    static_assert(LANES > 0, "there shall be at least one lane");
+    static_assert((PRIORITY_LANES_INITIAL_CAPACITY & (PRIORITY_LANES_INITIAL_CAPACITY - 1)) == 0, "initial capacity shall be a power of two");
+
+public:
+    explicit priority_lanes(unsigned int starvation_limit) :
+        m_lanes{},
+        m_passed{},
+        m_depth{},
+        m_size{0},
+        m_starvation_limit{starvation_limit}
+    {
+        for (std::size_t lane = 0; lane < LANES; ++lane)
+            m_depth[lane].store(0, std::memory_order_relaxed);
+    }
+
+    priority_lanes(const priority_lanes&) = delete;
+    priority_lanes& operator = (const priority_lanes&) = delete;
+
+    /* Number of elements in the given lane. */
+    std::size_t depth(std::size_t lane) const
+    {
+        assert(lane < LANES);
+        return m_depth[lane].load(std::memory_order_relaxed);
+    }
+
+    /* Number of elements in all the lanes. */
+    std::size_t size() const
+    {
+        return m_size.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    void push(std::size_t lane, T&& value)
+    {
+        assert(lane < LANES);
+
+        m_lanes[lane].push(std::move(value));
+        m_depth[lane].store(m_lanes[lane].size(), std::memory_order_relaxed);
+        m_size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Takes the oldest element of the most important non-empty lane
+     * (or of a starving one) among lanes [0, lowest].
+     *
+     * @return false if all of these lanes are empty.
+     */
+    bool pop(T* value, std::size_t lowest = LANES - 1)
+    {
+        std::size_t chosen = LANES;
+
+        assert(lowest < LANES);
+
+        for (std::size_t lane = 0; lane <= lowest; ++lane) {
+            if (m_lanes[lane].empty())
+                continue;
+            if (chosen == LANES) {
+                chosen = lane;
+            }
+            else if (m_passed[lane] >= m_starvation_limit) {
+                chosen = lane;
+                break;
+            }
+        }
+
+        if (chosen == LANES)
+            return false;
+
+        for (std::size_t lane = 0; lane <= lowest; ++lane)
+            if ((lane != chosen) && !m_lanes[lane].empty())
+                m_passed[lane]++;
+        m_passed[chosen] = 0;
+
+        *value = std::move(m_lanes[chosen].front());
+        m_lanes[chosen].pop();
+        m_depth[chosen].store(m_lanes[chosen].size(), std::memory_order_relaxed);
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    /* Moves all the elements out to 'other' (which shall be empty). */
+    void move_to(priority_lanes& other)
+    {
+        assert(other.empty());
+
+        for (std::size_t lane = 0; lane < LANES; ++lane) {
+            m_lanes[lane].swap(other.m_lanes[lane]);
+            other.m_depth[lane].store(other.m_lanes[lane].size(), std::memory_order_relaxed);
+            m_depth[lane].store(0, std::memory_order_relaxed);
+            m_passed[lane] = 0;
+        }
+
+        other.m_size.store(m_size.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+private:
+    /* FIFO in a circular array which only grows, so its storage is reused
+    rather than allocated and freed in chunks as std::queue does. */
+    class lane
+    {
+    public:
+        lane() :
+            m_slots{},
+            m_capacity{0},
+            m_head{0},
+            m_size{0}
+        {
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        void push(T&& value)
+        {
+            if (m_size == m_capacity)
+                grow();
+
+            m_slots[(m_head + m_size) & (m_capacity - 1)] = std::move(value);
+            m_size++;
+        }
+
+        T& front()
+        {
+            return m_slots[m_head];
+        }
+
+        void pop()
+        {
+            m_head = (m_head + 1) & (m_capacity - 1);
+            m_size--;
+        }
+
+        void swap(lane& other)
+        {
+            std::swap(m_slots, other.m_slots);
+            std::swap(m_capacity, other.m_capacity);
+            std::swap(m_head, other.m_head);
+            std::swap(m_size, other.m_size);
+        }
+
+    private:
+        void grow()
+        {
+            const std::size_t capacity = m_capacity ? 2 * m_capacity : PRIORITY_LANES_INITIAL_CAPACITY;
+            std::unique_ptr<T[]> slots{new T[capacity]};
+
+            for (std::size_t i = 0; i < m_size; ++i)
+                slots[i] = std::move(m_slots[(m_head + i) & (m_capacity - 1)]);
+
+            m_slots = std::move(slots);
+            m_capacity = capacity;
+            m_head = 0;
+        }
+
+        std::unique_ptr<T[]> m_slots;
+        std::size_t m_capacity; /* power of two */
+        std::size_t m_head;
+        std::size_t m_size;
+    };
+
+    lane m_lanes[LANES];
+    unsigned int m_passed[LANES]; /* times a non-empty lane has been passed over in a row */
+    std::atomic<std::size_t> m_depth[LANES];
+    std::atomic<std::size_t> m_size;
+    const unsigned int m_starvation_limit;
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _PRIORITY_LANES_HPP_ */
@@ -3,7 +3,7 @@
 set -e
 set -x
 
-UT_SRC='workqueue.hpp work.hpp'
+UT_SRC='workqueue.hpp work_stealing_deque.hpp priority_lanes.hpp task.hpp future.hpp parallel.hpp work.hpp metrics.hpp'
 UT_BIN='workqueue_test'
 
 make clean
@@ -0,0 +1,462 @@
+/**
+ * @file task.hpp
+ *
+ * Move-only, type erased unit of work with small buffer optimisation.
+ * Callables (together with their bound arguments) which fit into the inline
+ * buffer are stored in place, bigger ones go to blocks taken from
+ * a per-thread pool (task_pool), so no allocation happens in the steady state.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _TASK_HPP_
+#define _TASK_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <tuple>       /* for std::tuple, std::apply */
+#include <functional>  /* for std::invoke */
+#include <new>         /* for placement new */
+#include <cstddef>     /* for std::max_align_t */
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+/* size of the inline buffer (with the dispatch pointer a task takes one cacheline) */
+#if !defined(TASK_INLINE_SIZE)
+#define TASK_INLINE_SIZE 48
+#endif
+
+/* size of the blocks kept by task_pool, bigger callables are allocated with new */
+#if !defined(TASK_POOL_BLOCK_SIZE)
+#define TASK_POOL_BLOCK_SIZE 256
+#endif
+
+/* maximum number of free blocks cached by a single thread */
+#if !defined(TASK_POOL_MAX_CACHED)
+#define TASK_POOL_MAX_CACHED 256
+#endif
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+/**
+ * Per-thread pool of fixed size blocks. A block released by a thread
+ * other than its owner is pushed onto the owner's lock-free remote list,
+ * which the owner takes over once its own freelist runs dry. So blocks
+ * flowing from a producer to consumers come back to the producer
+ * and no allocation happens in the steady state.
+ * A pool outlives its thread until all of its blocks are returned.
+ */
+class task_pool
+{
+public:
+    static void* allocate(std::size_t size)
+    {
+        if (size > TASK_POOL_BLOCK_SIZE)
+            return ::operator new(size);
+
+        pool* p = local_pool();
+        block* b = p->take();
+
+        if (nullptr == b)
+            b = p->create();
+
+        return b + 1;
+    }
+
+    static void deallocate(void* ptr, std::size_t size)
+    {
+        if (size > TASK_POOL_BLOCK_SIZE) {
+            ::operator delete(ptr);
+            return;
+        }
+
+        block* b = static_cast<block*>(ptr) - 1;
+
+        if (b->m_owner == local_pool())
+            b->m_owner->give_back(b);
+        else
+            b->m_owner->give_back_remote(b);
+    }
+
+    /* Number of free blocks cached by the calling thread (returned remotely ones not included). */
+    static std::size_t cached()
+    {
+        return local_pool()->m_cached;
+    }
+
+private:
+    struct pool;
+
+    /* header preceding the user's part of each block */
+    struct alignas(std::max_align_t) block
+    {
+        pool* m_owner;
+        block* m_next;
+    };
+
+    struct pool
+    {
+        /* Owner only, returns nullptr if there is no free block. */
+        block* take()
+        {
+            if (nullptr == m_head) {
+                /* take over what the other threads have returned so far */
+                block* b = m_remote.exchange(nullptr, std::memory_order_acquire);
+                while (b) {
+                    block* next = b->m_next;
+                    give_back(b);
+                    b = next;
+                }
+            }
+
+            block* b = m_head;
+            if (b) {
+                m_head = b->m_next;
+                m_cached--;
+            }
+
+            return b;
+        }
+
+        /* Owner only. */
+        block* create()
+        {
+            block* b = static_cast<block*>(::operator new(sizeof(block) + TASK_POOL_BLOCK_SIZE));
+
+            b->m_owner = this;
+            m_blocks.fetch_add(1, std::memory_order_relaxed);
+
+            return b;
+        }
+
+        /* Owner only. */
+        void give_back(block* b)
+        {
+            if (m_cached < TASK_POOL_MAX_CACHED) {
+                b->m_next = m_head;
+                m_head = b;
+                m_cached++;
+            }
+            else {
+                destroy(b);
+            }
+        }
+
+        /* Any other thread. Once the owner is gone the block is simply freed. */
+        void give_back_remote(block* b)
+        {
+            block* head = m_remote.load(std::memory_order_relaxed);
+
+            do {
+                if (head == closed()) {
+                    destroy(b);
+                    return;
+                }
+                b->m_next = head;
+            } while (!m_remote.compare_exchange_weak(head, b, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        /* Called when the owner thread exits. */
+        void close()
+        {
+            block* remote = m_remote.exchange(closed(), std::memory_order_acquire);
+
+            destroy_all(m_head);
+            destroy_all(remote);
+            m_head = nullptr;
+            m_cached = 0;
+
+            release();
+        }
+
+        static block* closed()
+        {
+            return reinterpret_cast<block*>(std::uintptr_t{1});
+        }
+
+        static void destroy_all(block* b)
+        {
+            while (b) {
+                block* next = b->m_next;
+                destroy(b);
+                b = next;
+            }
+        }
+
+        static void destroy(block* b)
+        {
+            pool* owner = b->m_owner;
+
+            ::operator delete(b);
+            owner->release();
+        }
+
+        void release()
+        {
+            if (m_blocks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        block* m_head = nullptr; /* owner only */
+        std::size_t m_cached = 0; /* owner only */
+        std::atomic<block*> m_remote{nullptr}; /* returned by other threads, closed() once the owner is gone */
+        std::atomic<std::size_t> m_blocks{1}; /* live blocks, plus one for the owner thread */
+    };
+
+    struct pool_holder
+    {
+        ~pool_holder()
+        {
+            m_pool->close();
+        }
+
+        pool* m_pool = new pool;
+    };
+
+    static pool* local_pool()
+    {
+        static thread_local pool_holder holder;
+        return holder.m_pool;
+    }
+};
+
+class task
+{
+public:
+    task() :
+        m_ops{nullptr},
+        m_stamp{0}
+    {
+    }
+
+    /**
+     * Binds 'f' with 'args' (both are decay-copied or moved, as std::thread does).
+     * The task can be run once, the callable receives its arguments as rvalues.
+     */
+    template<typename F, typename... Args,
+             typename = std::enable_if_t<!std::is_same<std::decay_t<F>, task>::value>>
+    explicit task(F&& f, Args&&... args) :
+        m_ops{nullptr},
+        m_stamp{0}
+    {
+        typedef bound<std::decay_t<F>, std::decay_t<Args>...> callable;
+
+        if constexpr (fits_inline<callable>()) {
+            new (m_buffer) callable{std::forward<F>(f), std::forward<Args>(args)...};
+            m_ops = &inline_ops<callable>::s_ops;
+        }
+        else {
+            void* p = task_pool::allocate(sizeof(callable));
+            *reinterpret_cast<callable**>(m_buffer) = new (p) callable{std::forward<F>(f), std::forward<Args>(args)...};
+            m_ops = &pooled_ops<callable>::s_ops;
+        }
+    }
+
+    task(task&& other) :
+        m_ops{other.m_ops},
+        m_stamp{other.m_stamp}
+    {
+        if (m_ops) {
+            m_ops->move(m_buffer, other.m_buffer);
+            other.m_ops = nullptr;
+        }
+    }
+
+    task& operator = (task&& other)
+    {
+        if (this != &other) {
+            reset();
+            if (other.m_ops) {
+                m_ops = other.m_ops;
+                m_ops->move(m_buffer, other.m_buffer);
+                other.m_ops = nullptr;
+            }
+            m_stamp = other.m_stamp;
+        }
+
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator = (const task&) = delete;
+
+    ~task()
+    {
+        reset();
+    }
+
+    explicit operator bool() const
+    {
+        return m_ops != nullptr;
+    }
+
+    /* True if the callable lives in the inline buffer. */
+    bool is_inline() const
+    {
+        return m_ops && m_ops->m_inline;
+    }
+
+    void operator () ()
+    {
+        m_ops->invoke(m_buffer);
+    }
+
+    /* Opaque value travelling with the task (workqueue keeps the enqueue time there). */
+    std::int64_t stamp() const
+    {
+        return m_stamp;
+    }
+
+    void set_stamp(std::int64_t stamp)
+    {
+        m_stamp = stamp;
+    }
+
+    void reset()
+    {
+        if (m_ops) {
+            m_ops->destroy(m_buffer);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    template<typename F, typename... Args>
+    struct bound
+    {
+        template<typename G, typename... A>
+        explicit bound(G&& g, A&&... a) :
+            m_function{std::forward<G>(g)},
+            m_args{std::forward<A>(a)...}
+        {
+        }
+
+        void operator () ()
+        {
+            std::apply([this](Args&... args) {
+                std::invoke(std::move(m_function), std::move(args)...);
+            }, m_args);
+        }
+
+        F m_function;
+        std::tuple<Args...> m_args;
+    };
+
+    struct ops
+    {
+        void (*invoke)(void* buffer);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* buffer);
+        bool m_inline;
+    };
+
+    template<typename C>
+    static constexpr bool fits_inline()
+    {
+        return (sizeof(C) <= TASK_INLINE_SIZE) &&
+               (alignof(C) <= alignof(std::max_align_t)) &&
+               std::is_nothrow_move_constructible<C>::value;
+    }
+
+    template<typename C>
+    struct inline_ops
+    {
+        static void invoke(void* buffer)
+        {
+            (*static_cast<C*>(buffer))();
+        }
+
+        static void move(void* dst, void* src)
+        {
+            new (dst) C{std::move(*static_cast<C*>(src))};
+            static_cast<C*>(src)->~C();
+        }
+
+        static void destroy(void* buffer)
+        {
+            static_cast<C*>(buffer)->~C();
+        }
+
+        static constexpr ops s_ops = {invoke, move, destroy, true};
+    };
+
+    template<typename C>
+    struct pooled_ops
+    {
+        static_assert(alignof(C) <= alignof(std::max_align_t), "over-aligned callables are not supported");
+
+        static void invoke(void* buffer)
+        {
+            (**static_cast<C**>(buffer))();
+        }
+
+        static void move(void* dst, void* src)
+        {
+            *static_cast<C**>(dst) = *static_cast<C**>(src);
+        }
+
+        static void destroy(void* buffer)
+        {
+            C* c = *static_cast<C**>(buffer);
+            c->~C();
+            task_pool::deallocate(c, sizeof(C));
+        }
+
+        static constexpr ops s_ops = {invoke, move, destroy, false};
+    };
+
+    alignas(std::max_align_t) unsigned char m_buffer[TASK_INLINE_SIZE];
+    const ops* m_ops;
+    std::int64_t m_stamp; /* takes what would otherwise be padding */
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _TASK_HPP_ */
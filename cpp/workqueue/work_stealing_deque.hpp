@@ -0,0 +1,235 @@
+/**
+ * @file work_stealing_deque.hpp
+ *
+ * Chase-Lev work stealing deque (as formalised for C11 atomics by Le, Pop,
+ * Cohen and Zappa Nardelli). The owner pushes and pops at the bottom (LIFO),
+ * any other thread steals from the top (FIFO). The circular array grows
+ * on demand; retired arrays are kept until the deque is destroyed
+ * as a thief might still be reading from them.
+ *
+ * @author Lukasz Wiecaszek <lukasz.wiecaszek@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ */
+
+#ifndef _WORK_STEALING_DEQUE_HPP_
+#define _WORK_STEALING_DEQUE_HPP_
+
+/*===========================================================================*\
+ * system header files
+\*===========================================================================*/
+#include <atomic>
+#include <vector>
+#include <type_traits>
+#include <cstdint>
+#include <cassert>
+
+/*===========================================================================*\
+ * project header files
+\*===========================================================================*/
+#include "../utils/power_of_two.hpp"
+
+/*===========================================================================*\
+ * preprocessor #define constants and macros
+\*===========================================================================*/
+#if !defined(CACHELINE_SIZE)
+#define CACHELINE_SIZE 64
+#endif
+
+/*===========================================================================*\
+ * global type definitions
+\*===========================================================================*/
+namespace lts
+{
+
+template<typename T>
+class work_stealing_deque
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+        "work_stealing_deque elements are read concurrently, thus shall be trivially copyable");
+
+public:
+    explicit work_stealing_deque(std::size_t capacity = 256) :
+        m_top{0},
+        m_bottom{0},
+        m_array{nullptr},
+        m_retired{}
+    {
+        assert(is_power_of_two(capacity));
+        m_array.store(new circular_array(capacity), std::memory_order_relaxed);
+    }
+
+    ~work_stealing_deque()
+    {
+        delete m_array.load(std::memory_order_relaxed);
+        for (circular_array* a : m_retired)
+            delete a;
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque(work_stealing_deque&&) = delete;
+    work_stealing_deque& operator = (const work_stealing_deque&) = delete;
+    work_stealing_deque& operator = (work_stealing_deque&&) = delete;
+
+    /* Approximate number of elements (exact when called by the owner with no thieves around). */
+    std::size_t size() const
+    {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = m_top.load(std::memory_order_relaxed);
+
+        return (b > t) ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    std::size_t capacity() const
+    {
+        return m_array.load(std::memory_order_relaxed)->m_capacity;
+    }
+
+    /* Owner only. */
+    void push(T value)
+    {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = m_top.load(std::memory_order_acquire);
+        circular_array* a = m_array.load(std::memory_order_relaxed);
+
+        if (b - t > static_cast<std::int64_t>(a->m_capacity) - 1)
+            a = grow(a, b, t);
+
+        a->put(b, value);
+        m_bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /* Owner only. Takes the most recently pushed element. */
+    bool pop(T* value)
+    {
+        const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        circular_array* a = m_array.load(std::memory_order_relaxed);
+
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = m_top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            /* empty */
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        *value = a->get(b);
+
+        if (t == b) {
+            /* the last one, race against thieves */
+            const bool won = m_top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    /* Any thread. Takes the oldest element. May fail spuriously when racing with others. */
+    bool steal(T* value)
+    {
+        std::int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+            return false;
+
+        circular_array* a = m_array.load(std::memory_order_acquire);
+        *value = a->get(t);
+
+        return m_top.compare_exchange_strong(t, t + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    struct circular_array
+    {
+        explicit circular_array(std::size_t capacity) :
+            m_capacity{capacity},
+            m_mask{capacity - 1},
+            m_slots{new std::atomic<T>[capacity]}
+        {
+        }
+
+        ~circular_array()
+        {
+            delete [] m_slots;
+        }
+
+        T get(std::int64_t i) const
+        {
+            return m_slots[static_cast<std::size_t>(i) & m_mask].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, T value)
+        {
+            m_slots[static_cast<std::size_t>(i) & m_mask].store(value, std::memory_order_relaxed);
+        }
+
+        const std::size_t m_capacity;
+        const std::size_t m_mask;
+        std::atomic<T>* m_slots;
+    };
+
+    circular_array* grow(circular_array* a, std::int64_t b, std::int64_t t)
+    {
+        circular_array* bigger = new circular_array(2 * a->m_capacity);
+
+        for (std::int64_t i = t; i < b; ++i)
+            bigger->put(i, a->get(i));
+
+        m_retired.push_back(a);
+        m_array.store(bigger, std::memory_order_release);
+
+        return bigger;
+    }
+
+    alignas(CACHELINE_SIZE) std::atomic<std::int64_t> m_top;    /* thieves side */
+    alignas(CACHELINE_SIZE) std::atomic<std::int64_t> m_bottom; /* owner side */
+    std::atomic<circular_array*> m_array;
+    std::vector<circular_array*> m_retired; /* owner only */
+};
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * inline function/variable definitions
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * global object declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+/*===========================================================================*\
+ * function forward declarations
+\*===========================================================================*/
+namespace lts
+{
+
+} /* end of namespace lts */
+
+#endif /* _WORK_STEALING_DEQUE_HPP_ */
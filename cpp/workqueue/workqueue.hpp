@@ -21,12 +21,16 @@
 /*===========================================================================*\
  * system header files
 \*===========================================================================*/
-#include <queue>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <atomic>
 #include <string>
 #include <sstream>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cstdint>
 
 #if defined(DEBUG_WORKQUEUE)
 #include <iostream>
@@ -36,11 +40,32 @@
  * project header files
 \*===========================================================================*/
 #include "../semaphores/counting/semaphore.hpp"
+#include "../utils/cpu_affinity.hpp"
+#include "work_stealing_deque.hpp"
+#include "priority_lanes.hpp"
+#include "task.hpp"
+#include "future.hpp"
+#include "metrics.hpp"
 #include "work.hpp"
 
 /*===========================================================================*\
  * preprocessor #define constants and macros
 \*===========================================================================*/
+/* number of sweeps over all victims an idle worker makes before it is parked */
+#if !defined(WORKQUEUE_STEAL_ROUNDS)
+#define WORKQUEUE_STEAL_ROUNDS 2
+#endif
+
+/* number of times queued work of lower priority (or queued behind a worker's
+own deque) may be passed over before it is served anyway */
+#if !defined(WORKQUEUE_STARVATION_LIMIT)
+#define WORKQUEUE_STARVATION_LIMIT 16
+#endif
+
+/* with metrics, every that many pushes a thread samples the depth for the peak one */
+#if !defined(WORKQUEUE_DEPTH_SAMPLING)
+#define WORKQUEUE_DEPTH_SAMPLING 64
+#endif
 
 /*===========================================================================*\
  * global type definitions
@@ -48,33 +73,107 @@
 namespace lts
 {
 
-class workqueue
+enum class workqueue_mode
+{
+    SHARED_FIFO,   /* single queue shared by all workers */
+    WORK_STEALING, /* per worker deques, LIFO local pop, randomized stealing */
+};
+
+enum class workqueue_priority
+{
+    HIGH,   /* latency critical, served first (and by reserved workers) */
+    NORMAL, /* default */
+    LOW,    /* bulk work */
+};
+
+enum class workqueue_pinning
+{
+    NONE,      /* workers run wherever the scheduler puts them */
+    CPU,       /* worker is pinned to a single cpu */
+    NUMA_NODE, /* worker is pinned to all cpus of a NUMA node */
+};
+
+/**
+ * Optional tuning of a workqueue. With m_max_threads above the number of threads
+ * the pool is elastic: whenever all (unreserved) workers have been busy with work
+ * still queued for at least m_grow_latency, another worker is started (up to
+ * m_max_threads). Workers started that way, as well as the ones beyond the initial
+ * number of threads, exit after m_idle_timeout without any work.
+ * Saturation is noticed when work is pushed or started, there is no timer thread:
+ * a probing worker is started then, which joins the pool only if it is still
+ * saturated after m_grow_latency (and otherwise exits right away).
+ * With m_metrics set, the workqueue keeps the statistics returned by metrics().
+ */
+struct workqueue_options
+{
+    std::size_t m_max_threads = 0;
+    std::chrono::microseconds m_grow_latency{1000};
+    std::chrono::milliseconds m_idle_timeout{1000};
+    workqueue_pinning m_pinning = workqueue_pinning::NONE;
+    std::vector<int> m_pin_ids; /* cpus or nodes, worker i takes m_pin_ids[i % m_pin_ids.size()] */
+    bool m_metrics = false;
+};
+
+class workqueue : public executor
 {
 public:
-    explicit workqueue(const std::string& idstr, std::size_t threads = 1) :
+    static constexpr std::size_t priorities = 3;
+
+    /**
+     * @param[in] idstr    Name of the workqueue.
+     * @param[in] threads  Number of worker threads.
+     * @param[in] mode     How work is distributed among the workers.
+     * @param[in] reserved Number of workers which run HIGH priority work only
+     *                     (at least one worker is always left for the rest).
+     * @param[in] options  Elastic pool, cpu pinning and metrics settings.
+     */
+    explicit workqueue(const std::string& idstr, std::size_t threads = 1,
+                       workqueue_mode mode = workqueue_mode::SHARED_FIFO, std::size_t reserved = 0,
+                       const workqueue_options& options = workqueue_options{}) :
         m_idstring{idstr},
         m_threads{threads},
+        m_max_threads{(options.m_max_threads > threads) ? options.m_max_threads : threads},
+        m_reserved{(reserved < threads) ? reserved : ((threads > 0) ? threads - 1 : 0)},
+        m_mode{mode},
+        m_options{options},
         m_queue{},
+        m_stealing_queue{(mode == workqueue_mode::WORK_STEALING) ? new (std::nothrow) stealing_queue(m_max_threads) : nullptr},
         m_worker_threads{nullptr},
+        m_counters{options.m_metrics ? new (std::nothrow) detail::metrics_counters[m_max_threads + 1] : nullptr},
+        m_created{detail::metrics_counters::now()},
+        m_grow_mutex{},
+        m_grow_condvar{},
+        m_live{0},
+        m_busy{0},
+        m_starved_since{0},
+        m_probing{false},
+        m_stopping{false},
         m_is_valid{false}
     {
-        std::size_t created_workers = 0;
+        bool pinned = true;
 
 #if defined(DEBUG_WORKQUEUE)
         std::cout << __PRETTY_FUNCTION__ << std::endl;
 #endif
-        m_worker_threads = new (std::nothrow) worker_thread_ptr[m_threads];
-        if (m_threads > 0) {
+        m_worker_threads = new (std::nothrow) worker_thread_ptr[m_max_threads]();
+        if (m_worker_threads) {
             for (std::size_t i = 0; i < m_threads; ++i) {
-                std::ostringstream idstr;
-                idstr << "worker #" << i;
-                m_worker_threads[i] = new (std::nothrow) worker_thread(&m_queue, idstr.str());
-                if (m_worker_threads[i])
-                    created_workers++;
+                if (m_counters)
+                    m_counters[i].born();
+                m_worker_threads[i] = new (std::nothrow) worker_thread(this, i, worker_idstring(i));
+                if (m_worker_threads[i]) {
+                    m_live.fetch_add(1, std::memory_order_relaxed);
+                    pinned = pin(m_worker_threads[i], i) && pinned;
+                }
+                else if (m_counters) {
+                    m_counters[i].died();
+                }
             }
         }
 
-        m_is_valid = (created_workers == m_threads);
+        m_is_valid = (m_live.load(std::memory_order_relaxed) == m_threads) && pinned &&
+            ((mode != workqueue_mode::WORK_STEALING) || m_stealing_queue) &&
+            (!options.m_metrics || m_counters);
     }
 
     ~workqueue()
@@ -82,25 +181,40 @@ public:
 #if defined(DEBUG_WORKQUEUE)
         std::cout << __PRETTY_FUNCTION__ << std::endl;
 #endif
+        if (!m_worker_threads)
+            return;
+
+        /* no more workers are started from now on */
+        m_grow_mutex.lock();
+        m_stopping = true;
+        m_grow_mutex.unlock();
+        m_grow_condvar.notify_all(); /* a probing worker does not wait any longer */
+
         /* cancel all worker threads */
-        for (std::size_t i = 0; i < m_threads; ++i)
-            m_worker_threads[i]->cancel();
+        for (std::size_t i = 0; i < m_max_threads; ++i)
+            if (m_worker_threads[i])
+                m_worker_threads[i]->cancel();
 
 #if defined(DEBUG_WORKQUEUE)
         std::cout << "all worker threads cancelled" << std::endl;
 #endif
 
         /* now flush the queue and notify all threads so they can be woken up */
-        m_queue.flush(m_threads);
+        if (m_stealing_queue)
+            m_stealing_queue->flush(m_max_threads);
+        else
+            m_queue.flush(m_max_threads);
 
 #if defined(DEBUG_WORKQUEUE)
         std::cout << "queue flushed and all worker threads notified" << std::endl;
 #endif
 
-        /* join and delete all asynchronous threads */
-        for (std::size_t i = 0; i < m_threads; ++i) {
-            m_worker_threads[i]->join();
-            delete m_worker_threads[i];
+        /* join and delete all asynchronous threads (including retired ones) */
+        for (std::size_t i = 0; i < m_max_threads; ++i) {
+            if (m_worker_threads[i]) {
+                m_worker_threads[i]->join();
+                delete m_worker_threads[i];
+            }
         }
 
         delete [] m_worker_threads;
@@ -120,9 +234,162 @@ public:
         return m_is_valid;
     }
 
-    void push_work(const work_base_sptr& work)
+    workqueue_mode mode() const
+    {
+        return m_mode;
+    }
+
+    /* Number of workers the pool is created with (and never shrinks below). */
+    std::size_t threads() const
+    {
+        return m_threads;
+    }
+
+    /* Number of workers the pool may grow to. */
+    std::size_t max_threads() const
+    {
+        return m_max_threads;
+    }
+
+    /* Number of workers currently running. */
+    std::size_t live_threads() const
+    {
+        return m_live.load(std::memory_order_relaxed);
+    }
+
+    std::size_t reserved() const
+    {
+        return m_reserved;
+    }
+
+    /* Number of queued (not started yet) tasks of the given priority. */
+    std::size_t depth(workqueue_priority priority) const
+    {
+        return m_stealing_queue ? m_stealing_queue->depth(lane(priority)) : m_queue.depth(lane(priority));
+    }
+
+    /**
+     * Queues 'work' for execution. In WORK_STEALING mode NORMAL priority work
+     * pushed from one of the workers goes to its own deque.
+     */
+    void push_work(const work_base_sptr& work, workqueue_priority priority = workqueue_priority::NORMAL)
+    {
+        push(priority, &work_base::run, work);
+    }
+
+    /**
+     * Queues f(args...) for execution. Both 'f' and 'args' are forwarded
+     * into a task, which (when small enough) does not allocate at all.
+     */
+    template<typename F, typename... Args,
+             typename = std::enable_if_t<!std::is_same<std::decay_t<F>, workqueue_priority>::value>>
+    void push(F&& f, Args&&... args)
+    {
+        push(workqueue_priority::NORMAL, task{std::forward<F>(f), std::forward<Args>(args)...});
+    }
+
+    template<typename F, typename... Args>
+    void push(workqueue_priority priority, F&& f, Args&&... args)
+    {
+        push(priority, task{std::forward<F>(f), std::forward<Args>(args)...});
+    }
+
+    void push(task&& t)
+    {
+        push(workqueue_priority::NORMAL, std::move(t));
+    }
+
+    void push(workqueue_priority priority, task&& t)
+    {
+        if (m_counters)
+            enqueued(t);
+
+        if (m_stealing_queue)
+            m_stealing_queue->push(lane(priority), std::move(t));
+        else
+            m_queue.push(lane(priority), std::move(t));
+
+        if (elastic())
+            maybe_grow();
+    }
+
+    /**
+     * Same as push() but the result of f(args...) is delivered through the returned future.
+     * Continuations attached to it with then() are pushed back to this workqueue.
+     * If the workqueue is destroyed before f is run the future's promise is broken.
+     */
+    template<typename F, typename... Args,
+             typename = std::enable_if_t<!std::is_same<std::decay_t<F>, workqueue_priority>::value>>
+    future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> submit(F&& f, Args&&... args)
+    {
+        return submit(workqueue_priority::NORMAL, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template<typename F, typename... Args>
+    future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> submit(workqueue_priority priority, F&& f, Args&&... args)
+    {
+        typedef std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...> R;
+
+        promise<R> p{this};
+        future<R> result = p.get_future();
+
+        push(priority, [](promise<R> p, std::decay_t<F> f, std::decay_t<Args>... args) {
+            detail::fulfil(p, std::move(f), std::move(args)...);
+        }, std::move(p), std::forward<F>(f), std::forward<Args>(args)...);
+
+        return result;
+    }
+
+    void execute(task&& t) override
+    {
+        push(std::move(t));
+    }
+
+    /**
+     * Runs one of the queued tasks in the calling thread, if there is any.
+     * Lets a thread waiting for its work to complete help instead of blocking.
+     * A worker of this workqueue takes its own (most recently pushed) work first.
+     *
+     * @return true if a task has been run, false otherwise.
+     */
+    bool try_run_one()
     {
-        m_queue.push_work(work);
+        task t = m_stealing_queue ? m_stealing_queue->try_fetch_work() : m_queue.try_fetch_work();
+
+        if (!t)
+            return false;
+
+        /* the last set of counters is shared by all threads from outside of the pool */
+        run(t, m_max_threads);
+
+        return true;
+    }
+
+    /**
+     * Merges per-worker counters into a snapshot. Counters are read one by one
+     * while the workers keep running, so the snapshot is consistent only
+     * approximately. All zeros unless enabled with workqueue_options::m_metrics.
+     */
+    workqueue_metrics metrics() const
+    {
+        workqueue_metrics snapshot;
+
+        if (!m_counters)
+            return snapshot;
+
+        const std::int64_t now = detail::metrics_counters::now();
+
+        snapshot.m_workers.resize(m_max_threads);
+        for (std::size_t i = 0; i < m_max_threads; ++i)
+            m_counters[i].collect(&snapshot, &snapshot.m_workers[i], now);
+        m_counters[m_max_threads].collect(&snapshot, nullptr, now);
+
+        snapshot.m_depth = pending();
+        if (snapshot.m_depth > snapshot.m_peak_depth)
+            snapshot.m_peak_depth = snapshot.m_depth;
+        snapshot.m_elapsed = std::chrono::nanoseconds{detail::metrics_counters::nanoseconds(now - m_created)};
+
+        return snapshot;
     }
 
     std::string to_string() const
@@ -135,7 +402,12 @@ public:
         stream << m_idstring;
         stream << ", ";
         stream << std::dec << m_threads;
+        if (elastic())
+            stream << ".." << m_max_threads;
         stream << " thread(s) in a pool";
+        if (m_reserved > 0)
+            stream << " (" << m_reserved << " reserved)";
+        stream << ((m_mode == workqueue_mode::WORK_STEALING) ? ", work stealing" : ", shared fifo");
         stream << "]";
 
         return stream.str();
@@ -147,13 +419,20 @@ public:
     }
 
 private:
+    static std::size_t lane(workqueue_priority priority)
+    {
+        return static_cast<std::size_t>(priority);
+    }
+
+    /* All the priority lanes, shared by all workers. */
     class queue
     {
     public:
         explicit queue() :
             m_mutex(),
             m_semaphore(),
-            m_fifo()
+            m_high_semaphore(),
+            m_lanes(WORKQUEUE_STARVATION_LIMIT)
         {
         }
 
@@ -161,53 +440,380 @@ private:
 
         void flush(const std::size_t threads)
         {
+            priority_lanes<task, priorities> dropped(WORKQUEUE_STARVATION_LIMIT);
+
             m_mutex.lock();
-            while (!m_fifo.empty())
-                m_fifo.pop();
+            m_lanes.move_to(dropped);
             m_mutex.unlock();
 
-            for (std::size_t i = 0; i < threads; ++i)
-                m_semaphore.post();
+            /* dropped tasks are destroyed outside of the lock, they may break promises */
+            m_semaphore.post(threads);
+            m_high_semaphore.post(threads);
         }
 
-        void push_work(const work_base_sptr& work)
+        std::size_t depth(std::size_t lane) const
+        {
+            return m_lanes.depth(lane);
+        }
+
+        void push(std::size_t lane, task&& t)
         {
             m_mutex.lock();
-            m_fifo.push(work);
+            m_lanes.push(lane, std::move(t));
             m_mutex.unlock();
 
+            /* every task has a token in m_semaphore, HIGH ones also in m_high_semaphore,
+            so there are never less tokens than tasks for either kind of workers */
             m_semaphore.post();
+            if (lane == 0)
+                m_high_semaphore.post();
         }
 
-        work_base_sptr fetch_work()
+        /* Reserved workers take HIGH priority work only. May return empty task,
+        in particular when there has been no work for 'timeout' (0 waits forever). */
+        task fetch_work(bool reserved, std::chrono::milliseconds timeout)
         {
-            work_base_sptr work;
+            semaphore& sem = reserved ? m_high_semaphore : m_semaphore;
+            task t;
 
-            m_semaphore.wait();
+            if (timeout.count() == 0)
+                sem.wait();
+            else if (!sem.wait_for(timeout))
+                return t;
 
             m_mutex.lock();
-            if (!m_fifo.empty()) {
-                work = m_fifo.front();
-                m_fifo.pop();
-            }
+            m_lanes.pop(&t, reserved ? 0 : priorities - 1);
+            m_mutex.unlock();
+
+            return t;
+        }
+
+        task try_fetch_work()
+        {
+            task t;
+
+            if (!m_semaphore.try_wait())
+                return t;
+
+            m_mutex.lock();
+            m_lanes.pop(&t);
             m_mutex.unlock();
 
-            return work;
+            return t;
         }
 
     private:
-        std::mutex m_mutex; // protects access to m_queue
+        std::mutex m_mutex; // protects access to m_lanes
         semaphore m_semaphore; // blocks threads trying to fetch from empty queue
-        std::queue<work_base_sptr> m_fifo;
+        semaphore m_high_semaphore; // blocks reserved threads until there is HIGH priority work
+        priority_lanes<task, priorities> m_lanes;
+    };
+
+    class stealing_queue
+    {
+    public:
+        explicit stealing_queue(std::size_t workers) :
+            m_workers{workers},
+            m_deques{new work_stealing_deque<task*>[workers > 0 ? workers : 1]},
+            m_mutex{},
+            m_injected{WORKQUEUE_STARVATION_LIMIT},
+            m_semaphore{},
+            m_sleepers{0},
+            m_high_semaphore{},
+            m_high_sleepers{0},
+            m_flushed{false}
+        {
+        }
+
+        ~stealing_queue()
+        {
+            discard();
+        }
+
+        void flush(const std::size_t threads)
+        {
+            m_flushed.store(true, std::memory_order_seq_cst);
+            m_semaphore.post(threads);
+            m_high_semaphore.post(threads);
+        }
+
+        /* NORMAL lane includes (approximately) what is queued in the deques. */
+        std::size_t depth(std::size_t lane) const
+        {
+            std::size_t depth = m_injected.depth(lane);
+
+            if (lane == workqueue::lane(workqueue_priority::NORMAL))
+                for (std::size_t i = 0; i < m_workers; ++i)
+                    depth += m_deques[i].size();
+
+            return depth;
+        }
+
+        void push(std::size_t lane, task&& t)
+        {
+            /* deques hold pointers only, tasks themselves live in pooled blocks */
+            task* item = new (task_pool::allocate(sizeof(task))) task{std::move(t)};
+
+            if ((s_worker.m_owner == this) && (lane == workqueue::lane(workqueue_priority::NORMAL))) {
+                m_deques[s_worker.m_index].push(item);
+            }
+            else {
+                std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+                m_injected.push(lane, std::move(item));
+            }
+
+            /* HIGH priority work is offered to reserved workers first */
+            if ((lane == 0) && wake_one(m_high_sleepers, m_high_semaphore))
+                return;
+
+            wake_one(m_sleepers, m_semaphore);
+        }
+
+        /* Called by worker 'index' only, returns empty work once flushed
+        or after being parked for 'timeout' (0 waits forever). */
+        task fetch_work(std::size_t index, bool reserved, std::chrono::milliseconds timeout)
+        {
+            task* item = nullptr;
+
+            /* reserved workers have no deque of their own, their pushes are injected */
+            s_worker.m_owner = reserved ? nullptr : this;
+            s_worker.m_index = index;
+
+            while (!m_flushed.load(std::memory_order_relaxed)) {
+                if (take_high(index, &item, reserved) ||
+                    (!reserved && (take_local(index, &item) || take_injected(&item) || steal(index, &item)))) {
+                    task t{std::move(*item)};
+                    release(item);
+                    return t;
+                }
+
+                if (!park(reserved, timeout))
+                    break;
+            }
+
+            return task{};
+        }
+
+        /* Any thread, never blocks. */
+        task try_fetch_work()
+        {
+            const bool owner = (s_worker.m_owner == this);
+            const std::size_t index = owner ? s_worker.m_index : m_workers;
+            task* item = nullptr;
+
+            if (take_high(index, &item, false) || (owner && m_deques[index].pop(&item)) || take_injected(&item) || steal(index, &item)) {
+                task t{std::move(*item)};
+                release(item);
+                return t;
+            }
+
+            return task{};
+        }
+
+    private:
+        bool take_injected(task** item)
+        {
+            if (m_injected.empty())
+                return false;
+
+            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+
+            return m_injected.pop(item);
+        }
+
+        /* Checked before anything else, when there is HIGH priority work waiting.
+        Other workers pop from all the lanes, so starving ones get their turn,
+        and after WORKQUEUE_STARVATION_LIMIT takes in a row they look at the deques
+        (own one, then the others) first, so NORMAL work pushed by workers is not starved either. */
+        bool take_high(std::size_t index, task** item, bool reserved)
+        {
+            if (m_injected.depth(0) == 0) {
+                s_worker.m_high_takes = 0;
+                return false;
+            }
+
+            if (!reserved && (++s_worker.m_high_takes > WORKQUEUE_STARVATION_LIMIT)) {
+                s_worker.m_high_takes = 0;
+                if (((index < m_workers) && m_deques[index].pop(item)) || sweep(index, item))
+                    return true;
+            }
+
+            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+
+            return m_injected.pop(item, reserved ? 0 : priorities - 1);
+        }
+
+        /* Own deque first, but every now and then injected work is given a chance. */
+        bool take_local(std::size_t index, task** item)
+        {
+            if (++s_worker.m_local_pops >= WORKQUEUE_STARVATION_LIMIT) {
+                s_worker.m_local_pops = 0;
+                if (take_injected(item))
+                    return true;
+            }
+
+            return m_deques[index].pop(item);
+        }
+
+        /* Sweeps all other deques, checking injected work after every sweep. */
+        bool steal(std::size_t index, task** item)
+        {
+            for (unsigned int round = 0; round < WORKQUEUE_STEAL_ROUNDS; ++round) {
+                if (sweep(index, item) || take_injected(item))
+                    return true;
+
+                std::this_thread::yield();
+            }
+
+            return false;
+        }
+
+        /* Single sweep over all other deques starting from a random victim. */
+        bool sweep(std::size_t index, task** item)
+        {
+            const std::size_t first = (m_workers > 0) ? next_random() % m_workers : 0;
+
+            for (std::size_t i = 0; i < m_workers; ++i) {
+                const std::size_t victim = (first + i) % m_workers;
+                if ((victim != index) && m_deques[victim].steal(item))
+                    return true;
+            }
+
+            return false;
+        }
+
+        bool has_work(bool reserved) const
+        {
+            if (reserved)
+                return m_injected.depth(0) > 0;
+
+            if (!m_injected.empty())
+                return true;
+
+            for (std::size_t i = 0; i < m_workers; ++i)
+                if (!m_deques[i].empty())
+                    return true;
+
+            return false;
+        }
+
+        /* A sleeper is announced before the final check for work, a pusher claims
+        one announced sleeper per post(), so no wake-up is lost and none is wasted.
+        Returns false if woken up by the timeout rather than by a pusher. */
+        bool park(bool reserved, std::chrono::milliseconds timeout)
+        {
+            std::atomic<std::size_t>& sleepers = reserved ? m_high_sleepers : m_sleepers;
+            semaphore& sem = reserved ? m_high_semaphore : m_semaphore;
+
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+
+            /* Pairs with the fence in wake_one(): has_work() loads are not seq_cst,
+            so without it they could be satisfied before the announcement is visible. */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (has_work(reserved) || m_flushed.load(std::memory_order_seq_cst)) {
+                if (unannounce(sleepers))
+                    return true;
+                /* somebody has already claimed us, consume that post() */
+            }
+            else if (timeout.count() > 0) {
+                if (sem.wait_for(timeout))
+                    return true;
+                if (unannounce(sleepers))
+                    return false;
+                /* claimed just after the timeout, the post() is on its way */
+            }
+
+            sem.wait();
+
+            return true;
+        }
+
+        static bool unannounce(std::atomic<std::size_t>& sleepers)
+        {
+            std::size_t n = sleepers.load(std::memory_order_relaxed);
+
+            while (n > 0)
+                if (sleepers.compare_exchange_weak(n, n - 1, std::memory_order_relaxed))
+                    return true;
+
+            return false;
+        }
+
+        static bool wake_one(std::atomic<std::size_t>& sleepers, semaphore& sem)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            std::size_t n = sleepers.load(std::memory_order_relaxed);
+            while (n > 0)
+                if (sleepers.compare_exchange_weak(n, n - 1, std::memory_order_relaxed)) {
+                    sem.post();
+                    return true;
+                }
+
+            return false;
+        }
+
+        static void release(task* item)
+        {
+            item->~task();
+            task_pool::deallocate(item, sizeof(task));
+        }
+
+        void discard()
+        {
+            task* item = nullptr;
+
+            for (std::size_t i = 0; i < m_workers; ++i)
+                while (m_deques[i].steal(&item))
+                    release(item);
+
+            while (take_injected(&item))
+                release(item);
+        }
+
+        /* xorshift, per thread */
+        static std::uint32_t next_random()
+        {
+            std::uint32_t x = s_worker.m_random;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            return s_worker.m_random = x;
+        }
+
+        struct worker_context
+        {
+            const stealing_queue* m_owner;
+            std::size_t m_index;
+            std::uint32_t m_random;
+            unsigned int m_local_pops;
+            unsigned int m_high_takes; /* in a row, while HIGH priority work kept waiting */
+        };
+
+        static inline thread_local worker_context s_worker{nullptr, 0, 2463534242U, 0, 0};
+
+        const std::size_t m_workers;
+        std::unique_ptr<work_stealing_deque<task*>[]> m_deques;
+        std::mutex m_mutex; // protects access to m_injected (apart from its depth counters)
+        priority_lanes<task*, priorities> m_injected; // work pushed from outside of the pool and not NORMAL priority work
+        semaphore m_semaphore; // parks idle workers
+        std::atomic<std::size_t> m_sleepers; // parked (or about to be) workers not claimed by a pusher yet
+        semaphore m_high_semaphore; // parks idle reserved workers
+        std::atomic<std::size_t> m_high_sleepers; // same as m_sleepers, for reserved workers
+        std::atomic<bool> m_flushed;
     };
 
     class worker_thread
     {
     public:
-        worker_thread(queue* q, const std::string& idstr) :
-            m_queue(q),
+        worker_thread(workqueue* wq, std::size_t index, const std::string& idstr, bool probing = false) :
+            m_workqueue(wq),
+            m_index(index),
             m_idstring(idstr),
+            m_probing(probing),
             m_running(true),
+            m_exited(false),
             m_thread(&worker_thread::worker, this)
         {
 #if defined(DEBUG_WORKQUEUE)
@@ -232,39 +838,339 @@ private:
             m_thread.join();
         }
 
+        /* True once the worker has retired (the thread still has to be joined). */
+        bool exited() const
+        {
+            return m_exited.load(std::memory_order_acquire);
+        }
+
+        std::thread::native_handle_type native_handle()
+        {
+            return m_thread.native_handle();
+        }
+
     private:
-        void worker() const
+        void worker()
         {
+            std::chrono::steady_clock::time_point idle_since = std::chrono::steady_clock::now();
+
 #if defined(DEBUG_WORKQUEUE)
             std::cout << __PRETTY_FUNCTION__ << ": started: " << m_idstring << std::endl;
 #endif
+            s_current = current_worker{m_workqueue, m_index};
+
+            if (m_probing && !m_workqueue->admit(m_index)) {
+                m_exited.store(true, std::memory_order_release);
+                return;
+            }
+
             while (m_running)
             {
-                const work_base_sptr work = m_queue->fetch_work();
-                if (work)
-                    work->run();
+                task t = m_workqueue->fetch_work(m_index);
+                if (t) {
+                    m_workqueue->run(t, m_index);
+                    idle_since = std::chrono::steady_clock::now();
+                }
+                else if (m_workqueue->retire(m_index, idle_since)) {
+                    break;
+                }
             }
 
 #if defined(DEBUG_WORKQUEUE)
             std::cout << __PRETTY_FUNCTION__ << ": completed: " << m_idstring << std::endl;
 #endif
+            m_exited.store(true, std::memory_order_release);
        }
 
     private:
-        queue* m_queue;
+        workqueue* m_workqueue;
+        std::size_t m_index;
         std::string m_idstring;
+        const bool m_probing; // started by probe(), see admit()
         std::atomic<bool> m_running;
+        std::atomic<bool> m_exited;
         std::thread m_thread;
     };
 
     typedef worker_thread* worker_thread_ptr;
 
+    /* Set by a worker thread for its whole life. */
+    struct current_worker
+    {
+        const workqueue* m_workqueue;
+        std::size_t m_index;
+    };
+
+    static inline thread_local current_worker s_current{nullptr, 0};
+
+    static std::string worker_idstring(std::size_t index)
+    {
+        std::ostringstream idstr;
+        idstr << "worker #" << index;
+        return idstr.str();
+    }
+
+    bool elastic() const
+    {
+        return m_max_threads > m_threads;
+    }
+
+    task fetch_work(std::size_t index)
+    {
+        const bool reserved = (index < m_reserved);
+        const std::chrono::milliseconds timeout = elastic() ? m_options.m_idle_timeout : std::chrono::milliseconds{0};
+
+        return m_stealing_queue ? m_stealing_queue->fetch_work(index, reserved, timeout) : m_queue.fetch_work(reserved, timeout);
+    }
+
+    /* Runs 't' on behalf of worker 'index' (m_max_threads for other threads). */
+    void run(task& t, std::size_t index)
+    {
+        const bool busy = elastic() && (index < m_max_threads);
+        std::int64_t start = 0;
+
+        if (busy) {
+            m_busy.fetch_add(1, std::memory_order_relaxed);
+            maybe_grow();
+        }
+
+        if (m_counters)
+            start = m_counters[index].started(t.stamp());
+
+        t();
+
+        if (m_counters)
+            m_counters[index].completed(start);
+
+        if (busy)
+            m_busy.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /* Counted by the pushing thread in its own counters, so there is no shared counter
+    on the hot path. The peak cannot be recovered from per-thread counters, thus
+    the depth is sampled every WORKQUEUE_DEPTH_SAMPLING pushes of a thread (and by metrics()). */
+    void enqueued(task& t)
+    {
+        detail::metrics_counters& counters = m_counters[metrics_slot()];
+
+        t.set_stamp(detail::metrics_counters::now());
+
+        if ((counters.enqueued() % WORKQUEUE_DEPTH_SAMPLING) == 0)
+            counters.sampled(pending());
+    }
+
+    /* Tasks pushed but not started yet, merged from all counters. Started ones are read
+    first, so a task pushed and started in between counts as pending rather than
+    turning the difference negative. */
+    std::size_t pending() const
+    {
+        std::uint64_t started = 0;
+        std::uint64_t enqueued = 0;
+
+        for (std::size_t i = 0; i <= m_max_threads; ++i)
+            started += m_counters[i].m_started.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i <= m_max_threads; ++i)
+            enqueued += m_counters[i].m_enqueued.load(std::memory_order_relaxed);
+
+        return (enqueued > started) ? static_cast<std::size_t>(enqueued - started) : 0;
+    }
+
+    /* Counters of the calling thread, workers have their own ones, all other threads share the last one. */
+    std::size_t metrics_slot() const
+    {
+        return (s_current.m_workqueue == this) ? s_current.m_index : m_max_threads;
+    }
+
+    std::size_t queued() const
+    {
+        std::size_t n = 0;
+
+        for (std::size_t lane = 0; lane < priorities; ++lane)
+            n += m_stealing_queue ? m_stealing_queue->depth(lane) : m_queue.depth(lane);
+
+        return n;
+    }
+
+    /* Starts another worker once the pool has been saturated for m_grow_latency. */
+    void maybe_grow()
+    {
+        typedef std::chrono::steady_clock clock;
+
+        if (m_live.load(std::memory_order_relaxed) >= m_max_threads)
+            return;
+
+        if (!saturated()) {
+            if (m_starved_since.load(std::memory_order_relaxed) != 0)
+                m_starved_since.store(0, std::memory_order_relaxed);
+            return;
+        }
+
+        const std::int64_t now = clock::now().time_since_epoch().count();
+        const std::int64_t latency = std::chrono::duration_cast<clock::duration>(m_options.m_grow_latency).count();
+        std::int64_t since = m_starved_since.load(std::memory_order_relaxed);
+
+        if (since == 0) {
+            if (!m_starved_since.compare_exchange_strong(since, now, std::memory_order_relaxed))
+                return;
+            since = now;
+        }
+
+        if (now - since < latency) {
+            /* nothing may happen until then, so somebody has to look again */
+            probe();
+            return;
+        }
+
+        /* the next worker (if still needed) has to wait for another period */
+        if (m_starved_since.compare_exchange_strong(since, now, std::memory_order_relaxed))
+            grow();
+    }
+
+    /* All unreserved workers are busy and there is work waiting.
+    Reserved workers are counted as busy, they do not help with the backlog anyway. */
+    bool saturated() const
+    {
+        return (m_busy.load(std::memory_order_relaxed) + m_reserved >= m_live.load(std::memory_order_relaxed)) &&
+            (queued() > 0);
+    }
+
+    /* Starts a probing worker, unless there is one already. */
+    void probe()
+    {
+        if (m_probing.load(std::memory_order_relaxed) || m_probing.exchange(true, std::memory_order_relaxed))
+            return;
+
+        if (!grow(true))
+            m_probing.store(false, std::memory_order_relaxed);
+    }
+
+    /* Called by a probing worker, waits for m_grow_latency
+    and tells whether it shall join the pool (which is then still saturated). */
+    bool admit(std::size_t index)
+    {
+        typedef std::chrono::steady_clock clock;
+
+        std::unique_lock<decltype(m_grow_mutex)> lock(m_grow_mutex);
+        bool admitted = false;
+
+        m_grow_condvar.wait_for(lock, m_options.m_grow_latency, [this]() { return m_stopping; });
+
+        if (!m_stopping && saturated() && (m_live.load(std::memory_order_relaxed) < m_max_threads)) {
+            m_live.fetch_add(1, std::memory_order_relaxed);
+            if (m_counters)
+                m_counters[index].born();
+            /* the next worker (if still needed) has to wait for another period */
+            m_starved_since.store(clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+            admitted = true;
+        }
+
+        m_probing.store(false, std::memory_order_relaxed);
+
+        return admitted;
+    }
+
+    /* Starts a worker in a free slot, a probing one is not counted as live until admitted. */
+    bool grow(bool probing = false)
+    {
+        std::lock_guard<decltype(m_grow_mutex)> lock(m_grow_mutex);
+
+        if (m_stopping || (m_live.load(std::memory_order_relaxed) >= m_max_threads))
+            return false;
+
+        /* reserved workers never retire, so their slots are never free */
+        for (std::size_t i = m_reserved; i < m_max_threads; ++i) {
+            worker_thread_ptr& slot = m_worker_threads[i];
+
+            if (slot && !slot->exited())
+                continue;
+
+            if (slot) {
+                slot->join();
+                delete slot;
+            }
+
+            if (!probing) {
+                m_live.fetch_add(1, std::memory_order_relaxed);
+                if (m_counters)
+                    m_counters[i].born();
+            }
+            slot = new (std::nothrow) worker_thread(this, i, worker_idstring(i), probing);
+            if (!slot) {
+                if (!probing) {
+                    if (m_counters)
+                        m_counters[i].died();
+                    m_live.fetch_sub(1, std::memory_order_relaxed);
+                }
+                return false;
+            }
+
+            pin(slot, i);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /* Called by an idle worker, true if it shall exit. */
+    bool retire(std::size_t index, std::chrono::steady_clock::time_point idle_since)
+    {
+        if (!elastic() || (index < m_reserved) ||
+            (std::chrono::steady_clock::now() - idle_since < m_options.m_idle_timeout))
+            return false;
+
+        std::size_t live = m_live.load(std::memory_order_relaxed);
+        while (live > m_threads)
+            if (m_live.compare_exchange_weak(live, live - 1, std::memory_order_relaxed)) {
+                if (m_counters)
+                    m_counters[index].died();
+                return true;
+            }
+
+        return false;
+    }
+
+    bool pin(worker_thread* worker, std::size_t index) const
+    {
+        cpu_set_t set;
+
+        if ((m_options.m_pinning == workqueue_pinning::NONE) || m_options.m_pin_ids.empty())
+            return true;
+
+        const int id = m_options.m_pin_ids[index % m_options.m_pin_ids.size()];
+
+        if (m_options.m_pinning == workqueue_pinning::CPU) {
+            if ((id < 0) || (id >= CPU_SETSIZE))
+                return false;
+            CPU_ZERO(&set);
+            CPU_SET(id, &set);
+        }
+        else if (!numa_node_cpus(id, &set)) {
+            return false;
+        }
+
+        return pin_thread(worker->native_handle(), set) == 0;
+    }
 
 private:
     std::string m_idstring;
     std::size_t m_threads;
+    std::size_t m_max_threads;
+    std::size_t m_reserved;
+    workqueue_mode m_mode;
+    const workqueue_options m_options;
     queue m_queue;
+    std::unique_ptr<stealing_queue> m_stealing_queue;
     worker_thread_ptr* m_worker_threads;
+    std::unique_ptr<detail::metrics_counters[]> m_counters; // one set per worker slot plus one for other threads, null unless enabled
+    const std::int64_t m_created; // steady clock ticks
+    std::mutex m_grow_mutex; // serialises starting (and reaping) of workers
+    std::condition_variable m_grow_condvar; // a probing worker waits on it, see admit()
+    std::atomic<std::size_t> m_live; // running workers
+    std::atomic<std::size_t> m_busy; // workers running a task (elastic pool only)
+    std::atomic<std::int64_t> m_starved_since; // steady clock ticks, 0 if the pool is not saturated
+    std::atomic<bool> m_probing; // a probing worker has been started and not admitted (or dismissed) yet
+    bool m_stopping; // protected by m_grow_mutex
     bool m_is_valid;
 };
 
@@ -18,16 +18,32 @@
 /*===========================================================================*\
  * system header files
 \*===========================================================================*/
+#include <iostream>
 #include <thread>
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <new>
+#include <cstdlib>
+
+#include <sys/resource.h>
 
 /*===========================================================================*\
  * project header files
 \*===========================================================================*/
 #include "gtest/gtest.h"
 #include "workqueue.hpp"
+#include "work_stealing_deque.hpp"
+#include "task.hpp"
+#include "future.hpp"
+#include "parallel.hpp"
+#include "priority_lanes.hpp"
+#include "metrics.hpp"
 
 /*===========================================================================*\
  * 'using namespace' section
@@ -36,6 +52,31 @@
 /*===========================================================================*\
  * preprocessor #define constants and macros
 \*===========================================================================*/
+#define DEQUE_ITERATIONS 100000
+#define FAN_OUT_DEPTH 12
+#define SCALING_TASKS 100000
+#define PARALLEL_SIZE 100003
+#define ALLOCATION_BATCHES 2000
+#define ALLOCATION_BATCH_SIZE 50 /* blocks in flight (two per task) stay below TASK_POOL_MAX_CACHED */
+
+#define TEST_PUSH_WORK_STEALING(WORKERS, SLEEP_MSEC, NAME)                                   \
+TEST(workqueue, push_work_##NAME##_##WORKERS##_workers_work_stealing)                        \
+{                                                                                            \
+    const int tasks = 10;                                                                    \
+    completion cmpl(tasks);                                                                  \
+    const std::size_t sleep_time_msec = SLEEP_MSEC;                                          \
+                                                                                             \
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(),       \
+        WORKERS, lts::workqueue_mode::WORK_STEALING);                                        \
+    ASSERT_TRUE(wq.is_valid());                                                              \
+    std::cout << (std::string)wq << std::endl;                                               \
+                                                                                             \
+    for (int i = 0; i < tasks; ++i)                                                          \
+        wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(                \
+            test_function, i, i, sleep_time_msec, cmpl));                                    \
+                                                                                             \
+    EXPECT_EQ(WORKERS > 0, cmpl.wait_timeout(tasks * sleep_time_msec + 1000));               \
+}
 
 /*===========================================================================*\
  * local type definitions
@@ -43,6 +84,19 @@
 namespace
 {
 
+/* Counts its live instances, so leaked or doubly destroyed tasks show up. */
+struct counted
+{
+    counted() { s_alive++; }
+    counted(const counted&) { s_alive++; }
+    counted(counted&&) noexcept { s_alive++; }
+    ~counted() { s_alive--; }
+
+    static int s_alive;
+};
+
+int counted::s_alive = 0;
+
 class completion
 {
 public:
@@ -123,10 +177,16 @@ private:
  * local function declarations
 \*===========================================================================*/
 static int test_function(int a, int b, std::size_t sleep_time_msec, completion& cmpl);
+static void fan_out(lts::workqueue& wq, int depth, std::atomic<std::size_t>& executed, completion& cmpl);
+static void count_task(std::atomic<std::size_t>& executed, completion& cmpl);
+static double tasks_per_second(std::size_t threads, lts::workqueue_mode mode);
+static std::size_t allocations_in_steady_state(lts::workqueue_mode mode);
+static double cpu_seconds();
 
 /*===========================================================================*\
  * local object definitions
 \*===========================================================================*/
+static std::atomic<std::size_t> allocations{0}; /* calls of the replaced operator new */
 
 /*===========================================================================*\
  * inline function definitions
@@ -135,6 +195,32 @@ static int test_function(int a, int b, std::size_t sleep_time_msec, completion&
 /*===========================================================================*\
  * public function definitions
 \*===========================================================================*/
+void* operator new(std::size_t size)
+{
+    void* p = std::malloc(size ? size : 1);
+
+    if (nullptr == p)
+        std::abort();
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    return p;
+}
+
+/* the replaced operator new gets its memory from malloc() */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#pragma GCC diagnostic pop
+
 namespace
 {
 
@@ -167,122 +253,996 @@ TEST(workqueue, create_and_destroy)
 
 TEST(workqueue, push_work_no_sleep_0_workers)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 0;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 0);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_FALSE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_FALSE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
 }
 
 TEST(workqueue, push_work_no_sleep_1_worker)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 0;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_TRUE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_TRUE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
 }
 
 TEST(workqueue, push_work_no_sleep_2_workers)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 0;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_TRUE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_TRUE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
 }
 
 TEST(workqueue, push_work_no_sleep_3_workers)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 0;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 3);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_TRUE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_TRUE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
 }
 
 TEST(workqueue, push_work_with_sleep_0_workers)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 100;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 0);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_FALSE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_FALSE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
 }
 
 TEST(workqueue, push_work_with_sleep_1_worker)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 100;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_TRUE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_TRUE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
 }
 
 TEST(workqueue, push_work_with_sleep_2_workers)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 100;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_TRUE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_TRUE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
 }
 
 TEST(workqueue, push_work_with_sleep_3_workers)
 {
-    completion cmpl(10);
+    const int tasks = 10;
+    completion cmpl(tasks);
     const std::size_t sleep_time_msec = 100;
 
     lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 3);
     ASSERT_TRUE(wq.is_valid());
     std::cout << (std::string)wq << std::endl;
 
-    for (int i = 0; i < cmpl.count(); ++i)
+    for (int i = 0; i < tasks; ++i)
         wq.push_work(std::make_shared<lts::work<int, int, int, completion&>>(test_function, i, i, sleep_time_msec, cmpl));
 
-    EXPECT_TRUE(cmpl.wait_timeout(cmpl.count() * sleep_time_msec + 1000));
+    EXPECT_TRUE(cmpl.wait_timeout(tasks * sleep_time_msec + 1000));
+}
+
+TEST_PUSH_WORK_STEALING(0, 0, no_sleep)
+TEST_PUSH_WORK_STEALING(1, 0, no_sleep)
+TEST_PUSH_WORK_STEALING(3, 0, no_sleep)
+TEST_PUSH_WORK_STEALING(1, 100, with_sleep)
+TEST_PUSH_WORK_STEALING(3, 100, with_sleep)
+
+TEST(work_stealing_deque, push_pop_steal)
+{
+    lts::work_stealing_deque<int> deque(4);
+    int value = -1;
+
+    EXPECT_TRUE(deque.empty());
+    EXPECT_FALSE(deque.pop(&value));
+    EXPECT_FALSE(deque.steal(&value));
+
+    /* grows beyond the initial capacity */
+    for (int i = 0; i < 10; ++i)
+        deque.push(i);
+    EXPECT_EQ(10U, deque.size());
+    EXPECT_EQ(16U, deque.capacity());
+
+    /* the owner takes the newest, thieves the oldest elements */
+    EXPECT_TRUE(deque.pop(&value));
+    EXPECT_EQ(9, value);
+    EXPECT_TRUE(deque.steal(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(deque.pop(&value));
+    EXPECT_EQ(8, value);
+    EXPECT_TRUE(deque.steal(&value));
+    EXPECT_EQ(1, value);
+
+    for (int i = 7; i >= 2; --i) {
+        EXPECT_TRUE(deque.pop(&value));
+        EXPECT_EQ(i, value);
+    }
+
+    EXPECT_TRUE(deque.empty());
+    EXPECT_FALSE(deque.pop(&value));
+}
+
+TEST(work_stealing_deque, owner_and_thieves)
+{
+    lts::work_stealing_deque<int> deque(8);
+    std::vector<std::atomic<int>> seen(DEQUE_ITERATIONS);
+    std::atomic<bool> done{false};
+    std::size_t duplicates = 0;
+    std::size_t missing = 0;
+
+    for (auto& s : seen)
+        s.store(0, std::memory_order_relaxed);
+
+    auto thief = [&deque, &seen, &done]() {
+        int value;
+        while (!done.load(std::memory_order_acquire) || !deque.empty()) {
+            if (deque.steal(&value))
+                seen[value].fetch_add(1, std::memory_order_relaxed);
+            else
+                std::this_thread::yield();
+        }
+    };
+
+    std::thread t1 {thief};
+    std::thread t2 {thief};
+
+    /* the owner pops every other element, so pop races with steal on the last one */
+    int value;
+    for (int i = 0; i < DEQUE_ITERATIONS; ++i) {
+        deque.push(i);
+        if ((i & 1) && deque.pop(&value))
+            seen[value].fetch_add(1, std::memory_order_relaxed);
+    }
+    while (deque.pop(&value))
+        seen[value].fetch_add(1, std::memory_order_relaxed);
+    done.store(true, std::memory_order_release);
+
+    t1.join();
+    t2.join();
+
+    for (auto& s : seen) {
+        const int n = s.load(std::memory_order_relaxed);
+        duplicates += (n > 1);
+        missing += (n == 0);
+    }
+
+    EXPECT_EQ(0U, duplicates);
+    EXPECT_EQ(0U, missing);
+}
+
+TEST(task, inline_and_pooled)
+{
+    int result = 0;
+    std::array<char, 2 * TASK_INLINE_SIZE> big{};
+
+    lts::task empty;
+    EXPECT_FALSE(empty);
+
+    /* a function pointer with a couple of arguments is stored in place */
+    lts::task t1{[](int& r, int a, int b) { r = a + b; }, std::ref(result), 1, 2};
+    ASSERT_TRUE(t1);
+    EXPECT_TRUE(t1.is_inline());
+    t1();
+    EXPECT_EQ(3, result);
+
+    /* a callable bigger than the inline buffer goes to the pool
+    (blocks returned by other threads are taken over first, so they do not interfere) */
+    lts::task_pool::deallocate(lts::task_pool::allocate(1), 1);
+    const std::size_t cached = lts::task_pool::cached();
+    {
+        lts::task t2{[big](int& r) { r = static_cast<int>(big.size()); }, std::ref(result)};
+        EXPECT_FALSE(t2.is_inline());
+        EXPECT_EQ(cached - 1, lts::task_pool::cached());
+        t2();
+        EXPECT_EQ(static_cast<int>(big.size()), result);
+    }
+    EXPECT_EQ(cached, lts::task_pool::cached());
+
+    /* and the block is reused by the next one */
+    lts::task t3{[big]() {}};
+    EXPECT_EQ(cached - 1, lts::task_pool::cached());
+}
+
+TEST(task, move_only_arguments)
+{
+    int result = 0;
+
+    lts::task t1{[](std::unique_ptr<int> p, int& r) { r = *p; }, std::make_unique<int>(42), std::ref(result)};
+    lts::task t2{std::move(t1)};
+    EXPECT_FALSE(t1);
+    ASSERT_TRUE(t2);
+
+    t1 = std::move(t2);
+    EXPECT_FALSE(t2);
+    t1();
+    EXPECT_EQ(42, result);
+}
+
+TEST(task, destroys_bound_state)
+{
+    {
+        std::array<char, 2 * TASK_INLINE_SIZE> big{};
+        lts::task t1{[](const counted&) {}, counted{}};
+        lts::task t2{[big](const counted&) {}, counted{}};
+        EXPECT_EQ(2, counted::s_alive);
+
+        lts::task t3{std::move(t1)};
+        t2 = std::move(t3);
+        EXPECT_EQ(1, counted::s_alive);
+
+        t2();
+        EXPECT_EQ(1, counted::s_alive);
+    }
+
+    EXPECT_EQ(0, counted::s_alive);
+}
+
+TEST(workqueue, push_callables)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+    std::array<char, 2 * TASK_INLINE_SIZE> big{};
+
+    for (lts::workqueue_mode mode : modes) {
+        const int tasks = 30;
+        std::atomic<int> sum{0};
+        completion cmpl(tasks);
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2, mode);
+        ASSERT_TRUE(wq.is_valid());
+
+        for (int i = 0; i < tasks / 3; ++i) {
+            wq.push(test_function, i, i, 0, std::ref(cmpl));
+            wq.push([&sum, &cmpl](std::unique_ptr<int> p) { sum += *p; cmpl.done(); }, std::make_unique<int>(i));
+            wq.push([&sum, &cmpl, big]() { sum += static_cast<int>(big.size()); cmpl.done(); });
+        }
+
+        EXPECT_TRUE(cmpl.wait_timeout(1000));
+        EXPECT_EQ(45 + 10 * static_cast<int>(big.size()), sum.load());
+    }
+}
+
+TEST(future, promise_and_future)
+{
+    lts::promise<int> p;
+    lts::future<int> f = p.get_future();
+
+    EXPECT_TRUE(f.valid());
+    EXPECT_FALSE(f.is_ready());
+    EXPECT_FALSE(f.wait_for(std::chrono::milliseconds(10)));
+
+    p.set_value(7);
+    EXPECT_TRUE(f.is_ready());
+    EXPECT_EQ(7, f.get());
+    EXPECT_FALSE(f.valid());
+
+    /* a promise destroyed without a value breaks the future */
+    lts::future<std::string> broken = lts::promise<std::string>{}.get_future();
+    EXPECT_TRUE(broken.is_ready());
+    EXPECT_FALSE(broken.wait());
+
+    /* and the whole chain of continuations */
+    lts::future<int> chained;
+    {
+        lts::promise<int> q;
+        chained = q.get_future().then([](int v) { return v + 1; });
+    }
+    EXPECT_FALSE(chained.wait());
+}
+
+TEST(workqueue, submit)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+
+    for (lts::workqueue_mode mode : modes) {
+        std::atomic<int> calls{0};
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2, mode);
+        ASSERT_TRUE(wq.is_valid());
+
+        lts::future<int> sum = wq.submit([](int a, int b) { return a + b; }, 20, 22);
+        lts::future<void> done = wq.submit([&calls]() { calls++; });
+        lts::future<std::unique_ptr<int>> ptr = wq.submit([](int v) { return std::make_unique<int>(v); }, 5);
+
+        EXPECT_EQ(42, sum.get());
+        done.get();
+        EXPECT_EQ(1, calls.load());
+        EXPECT_EQ(5, *ptr.get());
+    }
+}
+
+TEST(workqueue, then_runs_on_the_pool)
+{
+    const std::thread::id caller = std::this_thread::get_id();
+
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(),
+        2, lts::workqueue_mode::WORK_STEALING);
+    ASSERT_TRUE(wq.is_valid());
+
+    lts::future<std::string> f = wq.submit([]() { return 6; })
+        .then([](int v) { return v * 7; })
+        .then([caller](int v) {
+            EXPECT_NE(caller, std::this_thread::get_id());
+            return std::to_string(v);
+        });
+    EXPECT_EQ("42", f.get());
+
+    /* continuation attached to a future which is ready already */
+    lts::future<int> ready = wq.submit([]() { return 1; });
+    ready.wait();
+    EXPECT_EQ(2, ready.then([](int v) { return v + 1; }).get());
+
+    lts::future<void> v = wq.submit([]() {}).then([]() {});
+    EXPECT_TRUE(v.wait());
+}
+
+TEST(workqueue, when_all_and_when_any)
+{
+    const int tasks = 64;
+    std::vector<lts::future<int>> futures;
+    std::vector<lts::future<void>> voids;
+
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(),
+        3, lts::workqueue_mode::WORK_STEALING);
+    ASSERT_TRUE(wq.is_valid());
+
+    /* fan-out / fan-in without blocking any worker */
+    for (int i = 0; i < tasks; ++i)
+        futures.push_back(wq.submit([](int v) { return v * v; }, i));
+
+    lts::future<long> total = lts::when_all(std::move(futures)).then([](std::vector<int> squares) {
+        long sum = 0;
+        for (std::size_t i = 0; i < squares.size(); ++i) {
+            EXPECT_EQ(static_cast<int>(i * i), squares[i]);
+            sum += squares[i];
+        }
+        return sum;
+    });
+    EXPECT_EQ(static_cast<long>((tasks - 1) * tasks * (2 * tasks - 1) / 6), total.get());
+
+    for (int i = 0; i < tasks; ++i)
+        voids.push_back(wq.submit([]() {}));
+    EXPECT_TRUE(lts::when_all(std::move(voids)).wait());
+    EXPECT_TRUE(lts::when_all(std::vector<lts::future<int>>{}).get().empty());
+
+    /* the only one which ever completes wins */
+    lts::promise<int> never;
+    futures.clear();
+    futures.push_back(never.get_future());
+    futures.push_back(wq.submit([]() { return 11; }));
+    const std::pair<std::size_t, int> any = lts::when_any(std::move(futures)).get();
+    EXPECT_EQ(1U, any.first);
+    EXPECT_EQ(11, any.second);
+
+    voids.clear();
+    voids.push_back(lts::promise<void>{}.get_future());
+    voids.push_back(wq.submit([]() {}));
+    EXPECT_EQ(1U, lts::when_any(std::move(voids)).get());
+
+    /* broken promises propagate through when_all */
+    futures.clear();
+    futures.push_back(lts::promise<int>{}.get_future());
+    futures.push_back(wq.submit([]() { return 1; }));
+    EXPECT_FALSE(lts::when_all(std::move(futures)).wait());
+}
+
+TEST(parallel, parallel_for_visits_every_index_once)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+    const std::size_t threads[] = {0, 1, 3};
+    const std::size_t grains[] = {0, 1, 7, 1000, 2 * PARALLEL_SIZE};
+
+    for (lts::workqueue_mode mode : modes)
+        for (std::size_t n : threads) {
+            lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), n, mode);
+            ASSERT_TRUE(wq.is_valid());
+
+            for (std::size_t grain : grains) {
+                std::vector<std::atomic<int>> visits(PARALLEL_SIZE);
+                std::size_t wrong = 0;
+
+                for (auto& v : visits)
+                    v.store(0, std::memory_order_relaxed);
+
+                lts::parallel_for(wq, 1, PARALLEL_SIZE, grain, [&visits](std::size_t i) {
+                    visits[i].fetch_add(1, std::memory_order_relaxed);
+                });
+
+                for (std::size_t i = 0; i < PARALLEL_SIZE; ++i)
+                    wrong += (visits[i].load(std::memory_order_relaxed) != (i > 0 ? 1 : 0));
+                EXPECT_EQ(0U, wrong) << "threads " << n << ", grain " << grain;
+            }
+        }
+}
+
+TEST(parallel, parallel_for_chunks_and_nesting)
+{
+    const std::size_t rows = 64;
+    const std::size_t columns = 1000;
+    std::vector<std::atomic<std::size_t>> sums(rows);
+    std::atomic<std::size_t> chunks{0};
+
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(),
+        3, lts::workqueue_mode::WORK_STEALING);
+    ASSERT_TRUE(wq.is_valid());
+
+    /* chunked form, no chunk is bigger than the grain */
+    lts::parallel_for(wq, 0, 1000, 64, [&chunks](std::size_t first, std::size_t last) {
+        EXPECT_LE(last - first, 64U);
+        chunks++;
+    });
+    EXPECT_EQ(16U, chunks.load());
+
+    /* empty range */
+    lts::parallel_for(wq, 5, 5, 1, [](std::size_t) { ADD_FAILURE(); });
+
+    /* too small a grain is enlarged, so the chunks do not overflow the pending count */
+    const std::size_t huge = 3 * lts::detail::parallel_max_chunks + 1;
+    EXPECT_EQ(4U, lts::detail::parallel_grain(wq, huge, 1));
+    EXPECT_LE((huge + 3) / 4, lts::detail::parallel_max_chunks);
+    EXPECT_EQ(64U, lts::detail::parallel_grain(wq, 1000, 64));
+
+    /* a parallel_for per row, run from within the workers */
+    lts::parallel_for(wq, 0, rows, 1, [&wq, &sums](std::size_t row) {
+        sums[row] = lts::parallel_reduce(wq, 0, columns, 10, std::size_t{0},
+            [row](std::size_t column) { return row * column; },
+            [](std::size_t a, std::size_t b) { return a + b; });
+    });
+
+    for (std::size_t row = 0; row < rows; ++row)
+        EXPECT_EQ(row * columns * (columns - 1) / 2, sums[row].load());
+}
+
+TEST(parallel, parallel_reduce_is_deterministic)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+    std::string expected;
+
+    for (int i = 0; i < 500; ++i)
+        expected += static_cast<char>('a' + i % 26);
+
+    for (lts::workqueue_mode mode : modes)
+        for (std::size_t n = 0; n < 4; ++n) {
+            lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), n, mode);
+            ASSERT_TRUE(wq.is_valid());
+
+            /* string concatenation is not commutative, so the order has to be kept */
+            EXPECT_EQ(expected, lts::parallel_reduce(wq, 0, 500, 3, std::string{},
+                [](std::size_t i) { return std::string(1, static_cast<char>('a' + i % 26)); },
+                [](std::string a, const std::string& b) { return a + b; }));
+
+            EXPECT_EQ(PARALLEL_SIZE * (PARALLEL_SIZE - 1.0) / 2, lts::parallel_reduce(wq, 0, PARALLEL_SIZE, 0, 0.0,
+                [](std::size_t i) { return static_cast<double>(i); },
+                [](double a, double b) { return a + b; }));
+
+            /* each chunk writes its own partial, even for bool */
+            EXPECT_TRUE(lts::parallel_reduce(wq, 0, PARALLEL_SIZE, 1, false,
+                [](std::size_t i) { return i == PARALLEL_SIZE - 1; },
+                [](bool a, bool b) { return a || b; }));
+
+            EXPECT_EQ(42, lts::parallel_reduce(wq, 3, 3, 0, 42,
+                [](std::size_t) { return 0; },
+                [](int a, int b) { return a + b; }));
+        }
+}
+
+TEST(priority_lanes, order_and_starvation)
+{
+    lts::priority_lanes<int, 3> lanes(2);
+    lts::priority_lanes<int, 3> dropped(2);
+    int value = -1;
+
+    EXPECT_TRUE(lanes.empty());
+    EXPECT_FALSE(lanes.pop(&value));
+
+    lanes.push(2, 20);
+    lanes.push(2, 21);
+    lanes.push(0, 0);
+    lanes.push(0, 1);
+    lanes.push(0, 2);
+    lanes.push(0, 3);
+    lanes.push(1, 10);
+    EXPECT_EQ(4U, lanes.depth(0));
+    EXPECT_EQ(1U, lanes.depth(1));
+    EXPECT_EQ(2U, lanes.depth(2));
+    EXPECT_EQ(7U, lanes.size());
+
+    /* restricted to the first lane */
+    EXPECT_TRUE(lanes.pop(&value, 0));
+    EXPECT_EQ(0, value);
+
+    /* lanes 1 and 2 are passed over twice, then served (the upper one first) */
+    const int expected[] = {1, 2, 10, 20, 3, 21};
+    for (int e : expected) {
+        EXPECT_TRUE(lanes.pop(&value));
+        EXPECT_EQ(e, value);
+    }
+    EXPECT_TRUE(lanes.empty());
+
+    lanes.push(1, 11);
+    lanes.move_to(dropped);
+    EXPECT_TRUE(lanes.empty());
+    EXPECT_EQ(0U, lanes.depth(1));
+    EXPECT_EQ(1U, dropped.depth(1));
+    EXPECT_TRUE(dropped.pop(&value));
+    EXPECT_EQ(11, value);
+}
+
+TEST(workqueue, priorities)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+    const int high_tasks = 3 * WORKQUEUE_STARVATION_LIMIT;
+
+    for (lts::workqueue_mode mode : modes) {
+        completion gate(1);
+        completion cmpl(high_tasks + 2);
+        std::mutex mutex;
+        std::vector<char> order;
+
+        auto record = [&mutex, &order, &cmpl](char c) {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(c);
+            cmpl.done();
+        };
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1, mode);
+        ASSERT_TRUE(wq.is_valid());
+
+        /* keep the only worker busy until everything is queued */
+        wq.push([&gate]() { gate.wait(); });
+        while (wq.depth(lts::workqueue_priority::NORMAL) > 0)
+            std::this_thread::yield();
+
+        wq.push(lts::workqueue_priority::LOW, record, 'L');
+        wq.push(record, 'N');
+        for (int i = 0; i < high_tasks; ++i)
+            wq.push(lts::workqueue_priority::HIGH, record, 'H');
+
+        EXPECT_EQ(static_cast<std::size_t>(high_tasks), wq.depth(lts::workqueue_priority::HIGH));
+        EXPECT_EQ(1U, wq.depth(lts::workqueue_priority::NORMAL));
+        EXPECT_EQ(1U, wq.depth(lts::workqueue_priority::LOW));
+
+        gate.done();
+        EXPECT_TRUE(cmpl.wait_timeout(1000));
+        EXPECT_EQ(0U, wq.depth(lts::workqueue_priority::HIGH));
+
+        /* high priority work goes first, but lower ones are not starved */
+        ASSERT_EQ(static_cast<std::size_t>(high_tasks + 2), order.size());
+        EXPECT_EQ('H', order.front());
+        EXPECT_EQ('H', order.back());
+        const std::size_t normal = std::find(order.begin(), order.end(), 'N') - order.begin();
+        const std::size_t low = std::find(order.begin(), order.end(), 'L') - order.begin();
+        EXPECT_EQ(static_cast<std::size_t>(WORKQUEUE_STARVATION_LIMIT), normal);
+        EXPECT_EQ(static_cast<std::size_t>(WORKQUEUE_STARVATION_LIMIT + 1), low);
+    }
+}
+
+TEST(workqueue, priorities_work_stealing)
+{
+    const int high_tasks = 3 * WORKQUEUE_STARVATION_LIMIT;
+    completion cmpl(high_tasks + 1);
+    std::mutex mutex;
+    std::vector<char> order;
+
+    auto record = [&mutex, &order, &cmpl](char c) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(c);
+        cmpl.done();
+    };
+
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1,
+        lts::workqueue_mode::WORK_STEALING);
+    ASSERT_TRUE(wq.is_valid());
+
+    /* NORMAL work pushed by the worker goes to its own deque, HIGH one is injected */
+    wq.push([&wq, &record]() {
+        wq.push(record, 'N');
+        for (int i = 0; i < high_tasks; ++i)
+            wq.push(lts::workqueue_priority::HIGH, record, 'H');
+    });
+
+    EXPECT_TRUE(cmpl.wait_timeout(1000));
+
+    /* the deque is not starved by a stream of high priority work */
+    ASSERT_EQ(static_cast<std::size_t>(high_tasks + 1), order.size());
+    EXPECT_EQ('H', order.front());
+    const std::size_t normal = std::find(order.begin(), order.end(), 'N') - order.begin();
+    EXPECT_GE(normal, static_cast<std::size_t>(WORKQUEUE_STARVATION_LIMIT));
+    EXPECT_LE(normal, static_cast<std::size_t>(2 * WORKQUEUE_STARVATION_LIMIT));
+}
+
+TEST(workqueue, reserved_workers)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+
+    for (lts::workqueue_mode mode : modes) {
+        completion gate(1);
+        completion high(1);
+        completion normal(1);
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2, mode, 1);
+        ASSERT_TRUE(wq.is_valid());
+        EXPECT_EQ(1U, wq.reserved());
+        std::cout << (std::string)wq << std::endl;
+
+        /* the only unreserved worker is busy ... */
+        wq.push([&gate]() { gate.wait(); });
+        while (wq.depth(lts::workqueue_priority::NORMAL) > 0)
+            std::this_thread::yield();
+
+        /* ... but high priority work still gets through */
+        lts::future<int> f = wq.submit(lts::workqueue_priority::HIGH, [&high]() { high.done(); return 1; });
+        EXPECT_TRUE(high.wait_timeout(1000));
+        EXPECT_EQ(1, f.get());
+
+        /* while the rest has to wait */
+        wq.push([&normal]() { normal.done(); });
+        EXPECT_FALSE(normal.wait_timeout(50));
+        EXPECT_EQ(1U, wq.depth(lts::workqueue_priority::NORMAL));
+
+        gate.done();
+        EXPECT_TRUE(normal.wait_timeout(1000));
+    }
+
+    /* at least one worker is left unreserved */
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2,
+        lts::workqueue_mode::SHARED_FIFO, 5);
+    EXPECT_EQ(1U, wq.reserved());
+}
+
+TEST(workqueue, elastic_pool)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+
+    lts::workqueue_options options;
+    options.m_max_threads = 3;
+    options.m_grow_latency = std::chrono::microseconds{0};
+    options.m_idle_timeout = std::chrono::milliseconds{50};
+
+    for (lts::workqueue_mode mode : modes) {
+        const std::size_t tasks = 4;
+        std::atomic<std::size_t> started{0};
+        std::atomic<bool> gate{false};
+        completion cmpl(tasks);
+        completion again(1);
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1, mode, 0, options);
+        ASSERT_TRUE(wq.is_valid());
+        EXPECT_EQ(3U, wq.max_threads());
+        EXPECT_EQ(1U, wq.live_threads());
+        std::cout << (std::string)wq << std::endl;
+
+        /* every blocked task makes room for another worker, up to the maximum */
+        for (std::size_t i = 0; i < tasks; ++i) {
+            wq.push([&started, &gate, &cmpl]() {
+                started++;
+                while (!gate.load())
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                cmpl.done();
+            });
+            for (int n = 0; (n < 1000) && (started.load() < std::min<std::size_t>(i + 1, 3)); ++n)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        EXPECT_EQ(3U, started.load());
+        EXPECT_EQ(3U, wq.live_threads());
+        EXPECT_EQ(1U, wq.depth(lts::workqueue_priority::NORMAL));
+
+        gate.store(true);
+        EXPECT_TRUE(cmpl.wait_timeout(1000));
+
+        /* idle workers retire, down to the initial number */
+        for (int n = 0; (n < 1000) && (wq.live_threads() > 1); ++n)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        EXPECT_EQ(1U, wq.live_threads());
+
+        /* and the pool still runs work */
+        wq.push([&again]() { again.done(); });
+        EXPECT_TRUE(again.wait_timeout(1000));
+    }
+}
+
+TEST(workqueue, elastic_pool_grows_while_saturated)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+
+    lts::workqueue_options options;
+    options.m_max_threads = 4;
+    options.m_grow_latency = std::chrono::milliseconds{1};
+    options.m_idle_timeout = std::chrono::milliseconds{50};
+
+    for (lts::workqueue_mode mode : modes) {
+        const std::size_t tasks = 8;
+        std::atomic<bool> gate{false};
+        completion cmpl(tasks);
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1, mode, 0, options);
+        ASSERT_TRUE(wq.is_valid());
+
+        /* a burst and nothing else afterwards, the pool keeps on growing anyway */
+        for (std::size_t i = 0; i < tasks; ++i)
+            wq.push([&gate, &cmpl]() {
+                while (!gate.load())
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                cmpl.done();
+            });
+
+        for (int n = 0; (n < 1000) && (wq.live_threads() < 4); ++n)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        EXPECT_EQ(4U, wq.live_threads());
+
+        gate.store(true);
+        EXPECT_TRUE(cmpl.wait_timeout(1000));
+    }
+}
+
+TEST(workqueue, idle_pool_parks)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+
+    for (lts::workqueue_mode mode : modes) {
+        completion cmpl(1);
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2, mode);
+        ASSERT_TRUE(wq.is_valid());
+
+        /* let the workers go through their first park() */
+        wq.push([&cmpl]() { cmpl.done(); });
+        EXPECT_TRUE(cmpl.wait_timeout(1000));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        const double before = cpu_seconds();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        const double idle = cpu_seconds() - before;
+
+        /* spinning workers would burn about a second here */
+        EXPECT_LT(idle, 0.1) << "mode " << static_cast<int>(mode);
+    }
+}
+
+TEST(workqueue, pinning)
+{
+    cpu_set_t allowed, node;
+    int cpu = 0;
+
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+    while (!CPU_ISSET(cpu, &allowed))
+        cpu++;
+
+    auto affinity = []() {
+        cpu_set_t set;
+        pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+        return set;
+    };
+
+    lts::workqueue_options options;
+    options.m_pinning = lts::workqueue_pinning::CPU;
+    options.m_pin_ids = {cpu};
+
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(),
+        2, lts::workqueue_mode::SHARED_FIFO, 0, options);
+    ASSERT_TRUE(wq.is_valid());
+
+    cpu_set_t set = wq.submit(affinity).get();
+    EXPECT_EQ(1, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(cpu, &set));
+
+    if (lts::numa_node_cpus(0, &node)) {
+        options.m_pinning = lts::workqueue_pinning::NUMA_NODE;
+        options.m_pin_ids = {0};
+
+        lts::workqueue numa(::testing::UnitTest::GetInstance()->current_test_info()->name(),
+            1, lts::workqueue_mode::WORK_STEALING, 0, options);
+        ASSERT_TRUE(numa.is_valid());
+
+        set = numa.submit(affinity).get();
+        EXPECT_TRUE(CPU_EQUAL(&node, &set));
+    }
+
+    /* a cpu which does not exist makes the workqueue invalid */
+    options.m_pinning = lts::workqueue_pinning::CPU;
+    options.m_pin_ids = {-1};
+    lts::workqueue invalid(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1,
+        lts::workqueue_mode::SHARED_FIFO, 0, options);
+    EXPECT_FALSE(invalid.is_valid());
+}
+
+TEST(latency_histogram, buckets_and_percentiles)
+{
+    lts::workqueue_metrics snapshot;
+    lts::latency_histogram& h = snapshot.m_run;
+
+    EXPECT_EQ(0U, lts::latency_histogram::bucket(0));
+    EXPECT_EQ(1U, lts::latency_histogram::bucket(1));
+    EXPECT_EQ(2U, lts::latency_histogram::bucket(2));
+    EXPECT_EQ(2U, lts::latency_histogram::bucket(3));
+    EXPECT_EQ(11U, lts::latency_histogram::bucket(1024));
+    EXPECT_EQ(lts::latency_histogram::buckets - 1, lts::latency_histogram::bucket(INT64_MAX));
+    EXPECT_EQ(0, h.percentile(0.5).count());
+
+    /* 90 fast (~100ns) and 10 slow (~1ms) ones */
+    h.add(lts::latency_histogram::bucket(100), 90);
+    h.add(lts::latency_histogram::bucket(1000000), 10);
+    EXPECT_EQ(100U, h.count());
+    EXPECT_EQ(128, h.percentile(0.5).count());
+    EXPECT_EQ(128, h.percentile(0.9).count());
+    EXPECT_EQ(1 << 20, h.percentile(0.99).count());
+    EXPECT_EQ(1 << 20, h.percentile(1.0).count());
+}
+
+TEST(workqueue, metrics)
+{
+    const lts::workqueue_mode modes[] = {lts::workqueue_mode::SHARED_FIFO, lts::workqueue_mode::WORK_STEALING};
+    const std::size_t tasks = 20;
+
+    lts::workqueue_options options;
+    options.m_metrics = true;
+
+    for (lts::workqueue_mode mode : modes) {
+        completion cmpl(tasks);
+
+        lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 2, mode, 0, options);
+        ASSERT_TRUE(wq.is_valid());
+
+        for (std::size_t i = 0; i < tasks; ++i)
+            wq.push([&cmpl]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                cmpl.done();
+            });
+        EXPECT_TRUE(cmpl.wait_timeout(1000));
+
+        /* a task is accounted for once it returns */
+        lts::workqueue_metrics snapshot = wq.metrics();
+        for (int n = 0; (n < 1000) && (snapshot.m_completed < tasks); ++n) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            snapshot = wq.metrics();
+        }
+        std::cout << (std::string)snapshot << std::endl;
+
+        EXPECT_EQ(tasks, snapshot.m_completed);
+        EXPECT_EQ(tasks, snapshot.m_wait.count());
+        EXPECT_EQ(tasks, snapshot.m_run.count());
+        EXPECT_GE(snapshot.m_run.percentile(0.5), std::chrono::milliseconds(1));
+        EXPECT_EQ(0U, snapshot.m_depth);
+        EXPECT_GE(snapshot.m_peak_depth, 1U);
+        EXPECT_GT(snapshot.tasks_per_second(), 0.0);
+
+        ASSERT_EQ(2U, snapshot.m_workers.size());
+        EXPECT_EQ(tasks, snapshot.m_workers[0].m_tasks + snapshot.m_workers[1].m_tasks);
+        for (const lts::worker_metrics& worker : snapshot.m_workers) {
+            EXPECT_GE(worker.utilisation(), 0.0);
+            EXPECT_LE(worker.utilisation(), 1.0);
+        }
+        EXPECT_GE(snapshot.m_workers[0].m_busy + snapshot.m_workers[1].m_busy, tasks * std::chrono::milliseconds(1));
+
+        /* nothing has been run since then */
+        lts::workqueue_metrics later = wq.metrics();
+        EXPECT_EQ(0.0, later.tasks_per_second(snapshot));
+        EXPECT_GE(later.m_elapsed, snapshot.m_elapsed);
+
+        /* the depth is merged from per-thread counters on read */
+        std::atomic<bool> gate{false};
+        completion queued(2 + tasks);
+        for (int i = 0; i < 2; ++i)
+            wq.push([&gate, &queued]() {
+                while (!gate.load())
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                queued.done();
+            });
+        for (int n = 0; (n < 1000) && (wq.metrics().m_depth > 0); ++n)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (std::size_t i = 0; i < tasks; ++i)
+            wq.push([&queued]() { queued.done(); });
+
+        later = wq.metrics();
+        EXPECT_EQ(tasks, later.m_depth);
+        EXPECT_GE(later.m_peak_depth, tasks);
+
+        gate.store(true);
+        EXPECT_TRUE(queued.wait_timeout(1000));
+    }
+
+    /* disabled by default */
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(), 1);
+    wq.submit([]() { return 0; }).get();
+    EXPECT_EQ(0U, wq.metrics().m_completed);
+    EXPECT_TRUE(wq.metrics().m_workers.empty());
+}
+
+TEST(workqueue, fan_out_work_stealing)
+{
+    const std::size_t tasks = (1U << (FAN_OUT_DEPTH + 1)) - 1;
+    std::atomic<std::size_t> executed{0};
+    completion cmpl(tasks);
+
+    lts::workqueue wq(::testing::UnitTest::GetInstance()->current_test_info()->name(),
+        4, lts::workqueue_mode::WORK_STEALING);
+    ASSERT_TRUE(wq.is_valid());
+
+    /* every task pushes its two children from a worker thread */
+    wq.push_work(std::make_shared<lts::work<lts::workqueue&, int, std::atomic<std::size_t>&, completion&>>(
+        fan_out, wq, FAN_OUT_DEPTH, executed, cmpl));
+
+    EXPECT_TRUE(cmpl.wait_timeout(10000));
+    EXPECT_EQ(tasks, executed.load());
+}
+
+TEST(workqueue, no_allocations_in_steady_state)
+{
+    /* pooled tasks and future states pushed from a non-worker thread
+    come back to its pool, the queues reuse their storage */
+    EXPECT_EQ(0U, allocations_in_steady_state(lts::workqueue_mode::SHARED_FIFO));
+    EXPECT_EQ(0U, allocations_in_steady_state(lts::workqueue_mode::WORK_STEALING));
+}
+
+TEST(workqueue, scaling_benchmark)
+{
+    const std::size_t threads[] = {1, 2, 4, 8};
+
+    for (std::size_t n : threads) {
+        const double fifo = tasks_per_second(n, lts::workqueue_mode::SHARED_FIFO);
+        const double stealing = tasks_per_second(n, lts::workqueue_mode::WORK_STEALING);
+
+        std::cout << n << " worker(s): shared fifo " << static_cast<std::size_t>(fifo)
+                  << " tasks/s, work stealing " << static_cast<std::size_t>(stealing)
+                  << " tasks/s" << std::endl;
+    }
 }
 
 } // end of anonymous namespace
@@ -313,3 +1273,97 @@ static int test_function(int a, int b, std::size_t sleep_time_msec, completion&
 
     return a + b;
 }
+
+/* Each task at depth > 0 pushes two children, from within a worker thread. */
+static void fan_out(lts::workqueue& wq, int depth, std::atomic<std::size_t>& executed, completion& cmpl)
+{
+    if (depth > 0)
+        for (int i = 0; i < 2; ++i)
+            wq.push_work(std::make_shared<lts::work<lts::workqueue&, int, std::atomic<std::size_t>&, completion&>>(
+                fan_out, wq, depth - 1, executed, cmpl));
+
+    executed.fetch_add(1, std::memory_order_relaxed);
+    cmpl.done();
+}
+
+static void count_task(std::atomic<std::size_t>& executed, completion& cmpl)
+{
+    if (executed.fetch_add(1, std::memory_order_relaxed) + 1 == SCALING_TASKS)
+        cmpl.done();
+}
+
+/* Throughput of tiny tasks pushed from a worker, as a divide and conquer job would do it. */
+static double tasks_per_second(std::size_t threads, lts::workqueue_mode mode)
+{
+    std::atomic<std::size_t> executed{0};
+    completion cmpl(1);
+
+    lts::workqueue wq("scaling", threads, mode);
+    if (!wq.is_valid())
+        return 0.0;
+
+    const std::chrono::steady_clock::time_point t1(std::chrono::steady_clock::now());
+
+    wq.push([&wq, &executed, &cmpl]() {
+        for (std::size_t i = 0; i < SCALING_TASKS; ++i)
+            wq.push(count_task, std::ref(executed), std::ref(cmpl));
+    });
+
+    cmpl.wait();
+
+    const std::chrono::steady_clock::time_point t2(std::chrono::steady_clock::now());
+    const std::chrono::duration<double> elapsed(t2 - t1);
+
+    return SCALING_TASKS / elapsed.count();
+}
+
+/* Calls of operator new made by pushing and submitting ALLOCATION_BATCHES batches of work,
+after the same has been done once to warm the pools and queues up. */
+static std::size_t allocations_in_steady_state(lts::workqueue_mode mode)
+{
+    std::array<char, 2 * TASK_INLINE_SIZE> big{};
+    std::atomic<std::size_t> executed{0};
+    std::vector<lts::future<int>> futures;
+    std::size_t before = 0;
+
+    lts::workqueue wq("allocations", 1, mode);
+    if (!wq.is_valid())
+        return SIZE_MAX;
+
+    futures.reserve(ALLOCATION_BATCH_SIZE);
+
+    for (int round = 0; round < 2; ++round) {
+        if (round == 1)
+            before = allocations.load(std::memory_order_relaxed);
+
+        for (std::size_t batch = 0; batch < ALLOCATION_BATCHES; ++batch) {
+            executed.store(0, std::memory_order_relaxed);
+
+            for (std::size_t i = 0; i < ALLOCATION_BATCH_SIZE; ++i)
+                wq.push([big, &executed]() { executed.fetch_add(big.size() / big.size(), std::memory_order_relaxed); });
+            for (std::size_t i = 0; i < ALLOCATION_BATCH_SIZE; ++i)
+                futures.push_back(wq.submit([]() { return 1; }));
+
+            for (lts::future<int>& f : futures)
+                f.get();
+            futures.clear();
+
+            while (executed.load(std::memory_order_relaxed) < ALLOCATION_BATCH_SIZE)
+                std::this_thread::yield();
+        }
+    }
+
+    return allocations.load(std::memory_order_relaxed) - before;
+}
+
+/* user and system time consumed so far by the whole process */
+static double cpu_seconds()
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}